@@ -1,28 +1,174 @@
-#ifndef CODEC_H
-#define CODEC_H
-#include <stddef.h>
-#include <stdint.h>
-
-#define DIF_MAGIC_GRAY  0xD1FFu
-#define DIF_MAGIC_COLOR 0xD3FFu
-#define DIF_OK               0
-#define DIF_ERR_IO            1
-#define DIF_ERR_FORMAT        2
-#define DIF_ERR_ALLOC         3
-#define DIF_ERR_UNIMPLEMENTED 10
-
-int pnmtodif(const char *chemin_image_pnm, const char *chemin_dif);
-int diftopnm(const char *chemin_dif, const char *chemin_image_pnm);
-int diftopnm_raw(const char *chemin_dif, const char *chemin_image_pnm);
-
-typedef struct {
-    uint16_t largeur;
-    uint16_t hauteur;
-    uint8_t type; 
-    unsigned char *donnees; 
-} ImagePNM;
-unsigned char replier_delta(int delta);
-int deplier_delta(unsigned char y);
-int lire_pnm(const char *chemin, ImagePNM *out);
-void liberer_pnm(ImagePNM *img);                                
+#ifndef CODEC_H
+#define CODEC_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define DIF_MAGIC_GRAY  0xD1FFu
+#define DIF_MAGIC_COLOR 0xD3FFu
+/* Variante étendue : bandes indépendantes avec table des positions */
+#define DIF_MAGIC_GRAY_EXT  0xE1FFu
+#define DIF_MAGIC_COLOR_EXT 0xE3FFu
+/* Séquence d'images de mêmes dimensions, chacune prédite par la précédente */
+#define DIF_MAGIC_SEQUENCE  0xE5FFu
+/* Modes de codage (octet d'options de l'en-tête étendu) */
+#define DIF_MODE_MED        0x01u   /* prédicteur 2D MED (gauche, haut, haut-gauche) */
+#define DIF_MODE_DECORRELATION 0x02u /* couleur : G, R - G, B - G avant prédiction */
+#define DIF_MODE_PLAGES     0x04u   /* plages de deltas nuls codées par leur longueur */
+#define DIF_MODE_HUFFMAN    0x08u   /* codes de Huffman de l'image au lieu des 4 niveaux */
+#define DIF_MODE_SANS_PERTE 0x10u   /* échantillons entiers, sans réduction d'amplitude */
+#define DIF_OK               0
+#define DIF_ERR_IO            1
+#define DIF_ERR_FORMAT        2
+#define DIF_ERR_ALLOC         3
+#define DIF_ERR_TAILLE        4   /* tampon de sortie fourni trop petit */
+#define DIF_ERR_UNIMPLEMENTED 10
+
+/* Chemin "-" : entrée ou sortie standard, lue en flux sans en connaître la
+ * taille ; vers un tube, un fichier étendu est encodé en mémoire puis écrit
+ * d'un bloc (sa table des positions précède les bandes) */
+int pnmtodif(const char *chemin_image_pnm, const char *chemin_dif);
+int diftopnm(const char *chemin_dif, const char *chemin_image_pnm);
+int diftopnm_raw(const char *chemin_dif, const char *chemin_image_pnm);
+/* Image reconstruite et image différentielle en un seul décodage */
+int diftopnm_et_raw(const char *chemin_dif, const char *chemin_image_pnm,
+                    const char *chemin_image_raw);
+/* Vignette réduite d'un facteur 2, 4 ou 8 : chaque pixel est la moyenne
+ * d'un bloc de facteur x facteur pixels (blocs tronqués aux bords), calculée
+ * au fil du décodage sans construire l'image en taille réelle */
+int diftopnm_vignette(const char *chemin_dif, const char *chemin_image_pnm, int facteur);
+
+/* Options d'encodage et de décodage */
+typedef struct {
+    int nb_threads;      /* 0 = nombre de coeurs */
+    int hauteur_bande;   /* > 0 : encodage en bandes de N lignes (fichier étendu) */
+    int quantificateur_fixe; /* 1 : table {1, 2, 4, 8} au lieu de la table
+                                adaptée à l'histogramme de l'image */
+    unsigned int modes;  /* DIF_MODE_* : imposent le fichier étendu */
+    int intervalle_cles; /* séquences : une image intra au moins toutes les N
+                            images (0 = 32) */
+} OptionsDIF;
+void options_dif_defaut(OptionsDIF *options);
+int pnmtodif_options(const char *chemin_image_pnm, const char *chemin_dif,
+                     const OptionsDIF *options);
+int diftopnm_options(const char *chemin_dif, const char *chemin_image_pnm,
+                     const OptionsDIF *options);
+
+/* Tampon de sortie des fonctions en mémoire.
+ * donnees == NULL : alloué par la bibliothèque (reallouer, sinon realloc,
+ * qui est alors renseigné pour réutiliser le tampon aux appels suivants).
+ * donnees != NULL : tampon de `capacite` octets, agrandi par reallouer s'il
+ * est fourni, sinon DIF_ERR_TAILLE s'il ne suffit pas.
+ * donnees et capacite sont mis à jour même en cas d'erreur ; la libération
+ * reste à la charge de l'appelant. */
+typedef struct {
+    unsigned char *donnees;
+    size_t taille;       /* octets produits */
+    size_t capacite;
+    void *(*reallouer)(void *contexte, void *ancien, size_t taille);
+    void *contexte;
+} TamponDIF;
+
+/* Image brute en mémoire : pixels entrelacés, `pas` octets entre deux
+ * lignes (0 = lignes contiguës).
+ * Avec `plans` (couleur seulement), trois plans R, G, B à la suite : `pas`
+ * sépare deux lignes d'un plan (0 = largeur), le plan k commence à
+ * k * hauteur * pas.
+ * Avec `valeur_max` de 256 à 65535, échantillons uint16 dans l'ordre natif
+ * (pas pair, images entrelacées seulement). */
+typedef struct {
+    int largeur;
+    int hauteur;
+    int nb_canaux;       /* 1 ou 3 */
+    size_t pas;
+    int plans;           /* 0 = entrelacé, 1 = plans séparés */
+    int valeur_max;      /* 0 ou 255 : octets ; 256 à 65535 : 16 bits */
+} FormatImageDIF;
+
+/* options == NULL : options par défaut */
+int dif_encode_mem(const unsigned char *pixels, const FormatImageDIF *format,
+                   TamponDIF *sortie, const OptionsDIF *options);
+int dif_info_mem(const unsigned char *donnees, size_t taille, FormatImageDIF *format);
+/* format->pas et format->plans en entrée, dimensions en sortie */
+int dif_decode_mem(const unsigned char *donnees, size_t taille, FormatImageDIF *format,
+                   TamponDIF *sortie, const OptionsDIF *options);
+/* Décodage du rectangle (x, y, largeur, hauteur) seulement, mêmes
+ * conventions. Fichier étendu : seules les bandes qui le couvrent sont lues
+ * et décodées (la table des positions des bandes sert d'index, une entrée
+ * toutes les hauteur_bande lignes) ; fichier classique : décodage jusqu'à
+ * sa dernière ligne. */
+int dif_decode_region(const unsigned char *donnees, size_t taille, int x, int y, int largeur,
+                      int hauteur, FormatImageDIF *format, TamponDIF *sortie,
+                      const OptionsDIF *options);
+/* Décodage de la vignette (voir diftopnm_vignette), mêmes conventions ;
+ * format reçoit les dimensions de la vignette */
+int dif_decode_vignette(const unsigned char *donnees, size_t taille, int facteur,
+                        FormatImageDIF *format, TamponDIF *sortie, const OptionsDIF *options);
+
+/* Contexte réutilisable : pool de threads, tables et zones de travail
+ * conservés d'une image à l'autre (aucune allocation une fois chauffé).
+ * Un contexte ne sert qu'à une image à la fois. */
+typedef struct dif_context dif_context;
+dif_context *dif_context_creer(const OptionsDIF *options);
+void dif_context_detruire(dif_context *contexte);
+int dif_encode_mem_ctx(dif_context *contexte, const unsigned char *pixels,
+                       const FormatImageDIF *format, TamponDIF *sortie);
+int dif_decode_mem_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                       FormatImageDIF *format, TamponDIF *sortie);
+int dif_decode_region_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                          int x, int y, int largeur, int hauteur,
+                          FormatImageDIF *format, TamponDIF *sortie);
+int dif_decode_vignette_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                            int facteur, FormatImageDIF *format, TamponDIF *sortie);
+int pnmtodif_ctx(dif_context *contexte, const char *chemin_image_pnm, const char *chemin_dif);
+int diftopnm_ctx(dif_context *contexte, const char *chemin_dif, const char *chemin_image_pnm);
+int diftopnm_raw_ctx(dif_context *contexte, const char *chemin_dif, const char *chemin_image_pnm);
+int diftopnm_et_raw_ctx(dif_context *contexte, const char *chemin_dif, const char *chemin_image_pnm,
+                        const char *chemin_image_raw);
+int diftopnm_vignette_ctx(dif_context *contexte, const char *chemin_dif, const char *chemin_image_pnm,
+                          int facteur);
+
+/* Séquences DIF : images de mêmes dimensions et type, chacune codée comme
+ * un fichier étendu, prédite par l'échantillon co-localisé de l'image
+ * précédente quand l'estimation le préfère au prédicteur intra ; une table
+ * des positions des images permet d'en décoder une sans lire les autres
+ * (depuis la dernière image intra qui la précède). Le décodage lit le
+ * fichier par une seule projection. */
+int pnmtodif_sequence(const char *const *chemins_images, int nb_images, const char *chemin_dif);
+int pnmtodif_sequence_ctx(dif_context *contexte, const char *const *chemins_images, int nb_images,
+                          const char *chemin_dif);
+/* Toutes les images, vers `motif` : chemin avec un seul %d (largeur et 0
+ * permis, autres % doublés) remplacé par le numéro de l'image, depuis 0 */
+int diftopnm_sequence(const char *chemin_dif, const char *motif_pnm);
+int diftopnm_sequence_ctx(dif_context *contexte, const char *chemin_dif, const char *motif_pnm);
+/* Image `index` seulement */
+int diftopnm_image_sequence_ctx(dif_context *contexte, const char *chemin_dif, int index,
+                                const char *chemin_pnm);
+/* En mémoire, mêmes conventions que dif_encode_mem et dif_decode_mem ;
+ * décodées dans l'ordre, les images d'une séquence ne coûtent chacune qu'un
+ * décodage (le contexte garde la dernière, tant que les données ne changent pas) */
+int dif_info_sequence(const unsigned char *donnees, size_t taille, FormatImageDIF *format,
+                      int *nb_images);
+int dif_encode_sequence(const unsigned char *const *images, int nb_images, const FormatImageDIF *format,
+                        TamponDIF *sortie, const OptionsDIF *options);
+int dif_encode_sequence_ctx(dif_context *contexte, const unsigned char *const *images, int nb_images,
+                            const FormatImageDIF *format, TamponDIF *sortie);
+int dif_decode_sequence(const unsigned char *donnees, size_t taille, int index, FormatImageDIF *format,
+                        TamponDIF *sortie, const OptionsDIF *options);
+int dif_decode_sequence_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                            int index, FormatImageDIF *format, TamponDIF *sortie);
+
+typedef struct {
+    uint16_t largeur;
+    uint16_t hauteur;
+    uint8_t type; 
+    unsigned char *donnees; 
+    uint16_t valeur_max;  /* au-delà de 255 : donnees contient des uint16 natifs */
+} ImagePNM;
+unsigned char replier_delta(int delta);
+int deplier_delta(unsigned char y);
+int lire_pnm(const char *chemin, ImagePNM *out);
+/* PNM (binaire ou ASCII), PAM, BMP non compressé ou TGA reconnu à son
+ * contenu ; DIF_ERR_UNIMPLEMENTED pour un autre format */
+int lire_image(const char *chemin, ImagePNM *out);
+void liberer_pnm(ImagePNM *img);                                
 #endif
\ No newline at end of file
@@ -1,814 +1,3951 @@
-#include "../include/codec.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-#include <sys/stat.h>
-
-/* Structure pour la gestion des flux binaires */
-typedef struct {
-    unsigned char *buffer;
-    size_t taille;
-    size_t position;
-    unsigned char accumulateur;
-    int bits_accumules;
-} FluxBits;
-
-/* Fonction pour limiter une valeur entre 0 et 255 */
-static unsigned char limiter_octet(int valeur){
-    if (valeur < 0)   return 0;
-    if (valeur > 255) return 255;
-    return (unsigned char)valeur;
-}
-
-/* Lecture d'un bit depuis le flux */
-static int lire_un_bit(FluxBits *flux, int *bit){
-    if (flux->bits_accumules == 0) {
-        if (flux->position >= flux->taille) return 0;
-        flux->accumulateur = flux->buffer[flux->position++];
-        flux->bits_accumules = 8;
-    }
-    *bit = (flux->accumulateur >> 7) & 1;
-    flux->accumulateur <<= 1;
-    flux->bits_accumules--;
-    return 1;
-}
-
-/* Lecture de n bits depuis le flux */
-static int lire_n_bits(FluxBits *flux, int nombre, unsigned int *valeur){
-    *valeur = 0;
-    for (int i = 0, bit; i < nombre; i++) {
-        if (!lire_un_bit(flux, &bit)) return 0;
-        *valeur = (*valeur << 1) | bit;
-    }
-    return 1;
-}
-
-/* Repliement pair/impair d'un delta */
-unsigned char replier_delta(int delta) {
-    return (delta < 0) ? (unsigned char)(-2 * delta - 1)
-                       : (unsigned char)(2 * delta);
-}
-
-/* Dépliement pair/impair d'une valeur */
-int deplier_delta(unsigned char y) {
-    return (y & 1) ? -((int)y + 1) / 2 : (int)y / 2;
-}
-
-/* Ignorer les commentaires dans un fichier PNM */
-static void ignorer_commentaires(FILE *fichier){
-    int caractere;
-    while ((caractere = fgetc(fichier)) != EOF) {
-        if (caractere == '#')
-            while ((caractere = fgetc(fichier)) != EOF && caractere != '\n');
-        else if (!isspace(caractere)) {
-            ungetc(caractere, fichier);
-            return;
-        }
-    }
-}
-
-/* Lecture d'un fichier PNM */
-int lire_pnm(const char *chemin, ImagePNM *image_sortie) {
-    FILE *fichier = fopen(chemin, "rb");
-    if (!fichier) 
-        return DIF_ERR_IO;
-    char nombre_magique[3];
-    int largeur, hauteur, valeur_max;
-    int nb_canaux;
-    ignorer_commentaires(fichier);
-    if (fscanf(fichier, "%2s", nombre_magique) != 1) {
-        fclose(fichier);
-        return DIF_ERR_FORMAT;
-    }
-    if (strcmp(nombre_magique, "P5") == 0){
-        nb_canaux = 1;
-    }
-    else if (strcmp(nombre_magique, "P6") == 0){
-        nb_canaux = 3;
-    }
-    else {
-        fclose(fichier);
-        return DIF_ERR_FORMAT;
-    }
-    ignorer_commentaires(fichier);
-    if (fscanf(fichier, "%d", &largeur) != 1) {
-        fclose(fichier);
-        return DIF_ERR_FORMAT;
-    }
-    ignorer_commentaires(fichier);
-    if (fscanf(fichier, "%d", &hauteur) != 1) {
-        fclose(fichier);
-        return DIF_ERR_FORMAT;
-    }
-    ignorer_commentaires(fichier);
-    if (fscanf(fichier, "%d", &valeur_max) != 1) {
-        fclose(fichier);
-        return DIF_ERR_FORMAT;
-    }
-    if (largeur <= 0 || hauteur <= 0 ||
-        largeur > 65535 || hauteur > 65535 ||
-        valeur_max != 255) {
-        fclose(fichier);
-        return DIF_ERR_FORMAT;
-    }
-    fgetc(fichier);
-    size_t taille_totale = (size_t)largeur * hauteur * nb_canaux;
-    unsigned char *tampon = malloc(taille_totale);
-    if (!tampon) {
-        fclose(fichier);
-        return DIF_ERR_ALLOC;
-    }
-    if (fread(tampon, 1, taille_totale, fichier) != taille_totale) {
-        free(tampon);
-        fclose(fichier);
-        return DIF_ERR_FORMAT;
-    }
-    fclose(fichier);
-    image_sortie->largeur = (uint16_t)largeur;
-    image_sortie->hauteur = (uint16_t)hauteur;
-    image_sortie->type = (uint8_t)nb_canaux;
-    image_sortie->donnees = tampon;
-    return DIF_OK;
-}
-
-/* Libération mémoire d'une image PNM */
-void liberer_pnm(ImagePNM *image) {
-    if (!image) return;
-    free(image->donnees);
-    image->donnees = NULL;
-}
-
-/* Réduction de l'amplitude (division par 2) */
-static void diminuer_amplitude(ImagePNM *image) {
-    size_t taille_totale = (size_t)image->largeur * image->hauteur * image->type;
-    for (size_t i = 0; i < taille_totale; i++)
-        image->donnees[i] >>= 1;
-}
-
-/* Calcul des différences entre pixels */
-static int generer_differences(const ImagePNM *image,
-                                unsigned char **valeurs_initiales,
-                                int8_t **differences_sortie,
-                                size_t *longueur_differences)
-{
-    int nb_pixels = image->largeur * image->hauteur;
-    int nb_canaux = image->type;
-    int taille_diff = (nb_pixels > 1) ? nb_canaux * (nb_pixels - 1) : 0;
-    unsigned char *premiers_pixels = malloc(nb_canaux);
-    int8_t *tableau_diffs = taille_diff ? malloc(taille_diff) : NULL;
-    if (!premiers_pixels || (taille_diff && !tableau_diffs)) {
-        free(premiers_pixels); 
-        free(tableau_diffs);
-        return DIF_ERR_ALLOC;
-    }
-    int index_diff = 0;
-    if (nb_canaux == 1) {
-        unsigned char pixel_precedent = image->donnees[0];
-        premiers_pixels[0] = pixel_precedent;
-        for (int i = 1; i < nb_pixels; i++) {
-            unsigned char pixel_actuel = image->donnees[i];
-            int difference = pixel_actuel - pixel_precedent;
-            if (difference < -127 || difference > 127) {
-                free(premiers_pixels); 
-                free(tableau_diffs);
-                return DIF_ERR_FORMAT;
-            }
-            tableau_diffs[index_diff++] = (int8_t)difference;
-            pixel_precedent = pixel_actuel;
-        }
-    } else {
-        int *valeurs_precedentes = malloc(sizeof(int) * nb_canaux);
-        if (!valeurs_precedentes) { 
-            free(premiers_pixels); 
-            free(tableau_diffs); 
-            return DIF_ERR_ALLOC; 
-        }
-        for (int canal = 0; canal < nb_canaux; canal++) {
-            valeurs_precedentes[canal] = image->donnees[canal];
-            premiers_pixels[canal] = (unsigned char)valeurs_precedentes[canal];
-        }
-        for (int i = 1; i < nb_pixels; i++) {
-            for (int canal = 0; canal < nb_canaux; canal++) {
-                unsigned char pixel_actuel = image->donnees[i * nb_canaux + canal];
-                int difference = (int)pixel_actuel - valeurs_precedentes[canal];
-                if (difference < -127 || difference > 127) {
-                    free(valeurs_precedentes); 
-                    free(premiers_pixels); 
-                    free(tableau_diffs);
-                    return DIF_ERR_FORMAT;
-                }
-                
-                tableau_diffs[index_diff++] = (int8_t)difference;
-                valeurs_precedentes[canal] = pixel_actuel;
-            }
-        }
-        free(valeurs_precedentes);
-    }
-
-    *valeurs_initiales = premiers_pixels;
-    *differences_sortie = tableau_diffs;
-    *longueur_differences = taille_diff;
-    return DIF_OK;
-}
-
-/* Repliement des deltas */
-static int transformer_differences(const int8_t *diffs, size_t taille, unsigned char **sortie) {
-    unsigned char *tampon = taille ? malloc(taille) : NULL;
-    if (taille && !tampon) return DIF_ERR_ALLOC;
-    for (size_t i = 0; i < taille; i++)
-        tampon[i] = replier_delta(diffs[i]);
-    *sortie = tampon;
-    return DIF_OK;
-}
-
-/* Initialisation du flux d'écriture */
-static int initialiser_flux_ecriture(FluxBits *flux, size_t taille) {
-    flux->buffer = malloc(taille);
-    if (!flux->buffer) return DIF_ERR_ALLOC;
-    flux->taille = taille;
-    flux->position = 0;
-    flux->accumulateur = 0;
-    flux->bits_accumules = 0;
-    return DIF_OK;
-}
-
-/* Libération du flux d'écriture */
-static void liberer_flux_ecriture(FluxBits *flux) {
-    free(flux->buffer);
-}
-
-/* Écriture de bits dans le flux */
-static void ecrire_bits(FluxBits *flux, unsigned int code, int nb_bits) {
-    for (int bit = nb_bits - 1; bit >= 0; bit--) {
-        flux->accumulateur = (flux->accumulateur << 1) | ((code >> bit) & 1);
-        flux->bits_accumules++;
-        if (flux->bits_accumules == 8) {
-            flux->buffer[flux->position++] = flux->accumulateur;
-            flux->accumulateur = 0;
-            flux->bits_accumules = 0;
-        }
-    }
-}
-
-/* Finalisation du flux (écriture du dernier octet) */
-static void finaliser_flux(FluxBits *flux) {
-    if (flux->bits_accumules) {
-        flux->accumulateur <<= (8 - flux->bits_accumules);
-        flux->buffer[flux->position++] = flux->accumulateur;
-    }
-}
-
-/* Encodage PNM vers DIF */
-int pnmtodif(const char *chemin_pnm, const char *chemin_dif) {
-    ImagePNM img;
-    if (lire_pnm(chemin_pnm, &img) != DIF_OK) return DIF_ERR_IO;
-    diminuer_amplitude(&img);
-    unsigned char *premiers;
-    int8_t *deltas;
-    size_t longueur;
-    generer_differences(&img, &premiers, &deltas, &longueur);
-    unsigned char *valeurs_repliees;
-    transformer_differences(deltas, longueur, &valeurs_repliees);
-    FluxBits flux_sortie;
-    initialiser_flux_ecriture(&flux_sortie, longueur * 2 + 16);
-    for (size_t i = 0; i < longueur; i++) {
-        unsigned int valeur = valeurs_repliees[i];
-        if (valeur < 2) {
-            ecrire_bits(&flux_sortie, 0b0, 1);
-            ecrire_bits(&flux_sortie, valeur, 1);
-        }
-        else if (valeur < 6) {
-            ecrire_bits(&flux_sortie, 0b10, 2);
-            ecrire_bits(&flux_sortie, valeur - 2, 2);
-        }
-        else if (valeur < 22) {
-            ecrire_bits(&flux_sortie, 0b110, 3);
-            ecrire_bits(&flux_sortie, valeur - 6, 4);
-        }
-        else {
-            ecrire_bits(&flux_sortie, 0b111, 3);
-            ecrire_bits(&flux_sortie, valeur - 22, 8);
-        }
-    }
-    
-    finaliser_flux(&flux_sortie);
-    FILE *fichier = fopen(chemin_dif, "wb");
-    if (!fichier) return DIF_ERR_IO;
-    uint16_t numero_magique = (img.type == 3) ? DIF_MAGIC_COLOR : DIF_MAGIC_GRAY;
-    uint8_t nombre_niveaux = 4;
-    uint8_t bits_par_niveau[4] = {1, 2, 4, 8};
-    uint8_t entete[2 + 2 + 2 + 1 + 4];
-    memcpy(entete + 0, &numero_magique, 2);
-    memcpy(entete + 2, &img.largeur, 2);
-    memcpy(entete + 4, &img.hauteur, 2);
-    entete[6] = nombre_niveaux;
-    memcpy(entete + 7, bits_par_niveau, nombre_niveaux);
-    if (fwrite(entete, 1, 7 + nombre_niveaux, fichier) != (size_t)(7 + nombre_niveaux)) {
-        fclose(fichier);
-        return DIF_ERR_IO;
-    }
-    fwrite(premiers, 1, img.type, fichier);
-    fwrite(flux_sortie.buffer, 1, flux_sortie.position, fichier);
-    fclose(fichier);
-    liberer_flux_ecriture(&flux_sortie);
-    free(valeurs_repliees);
-    free(deltas);
-    free(premiers);
-    liberer_pnm(&img);
-    return DIF_OK;
-}
-
-/* Décodage DIF vers PNM */
-int diftopnm(const char* fichier_dif, const char* fichier_pnm){
-    FILE *f = fopen(fichier_dif, "rb");
-    if (!f) return DIF_ERR_IO;
-    struct stat info_fichier;
-    if (stat(fichier_dif, &info_fichier) != 0) { 
-        fclose(f); 
-        return DIF_ERR_IO; 
-    }
-    long taille_fichier = (long)info_fichier.st_size;
-    if (taille_fichier < 0) { 
-        fclose(f); 
-        return DIF_ERR_IO; 
-    }
-    uint16_t num_magique, larg, haut;
-    uint8_t nb_niveaux;
-    uint8_t entete7[7];
-    if (fread(entete7, 1, 7, f) != 7) { 
-        fclose(f); 
-        return DIF_ERR_FORMAT; 
-    }
-    memcpy(&num_magique, entete7 + 0, 2);
-    memcpy(&larg, entete7 + 2, 2);
-    memcpy(&haut, entete7 + 4, 2);
-    nb_niveaux = entete7[6];
-    if (nb_niveaux != 4) { 
-        fclose(f); 
-        return DIF_ERR_FORMAT; 
-    }
-    uint8_t bits_niveaux[4];
-    if (fread(bits_niveaux, 1, nb_niveaux, f) != (size_t)nb_niveaux) { 
-        fclose(f); 
-        return DIF_ERR_FORMAT; 
-    }
-    
-    int nb_canaux;
-    if (num_magique == DIF_MAGIC_GRAY) nb_canaux = 1;
-    else if (num_magique == DIF_MAGIC_COLOR) nb_canaux = 3;
-    else { 
-        fclose(f); 
-        return DIF_ERR_FORMAT; 
-    }
-    
-    unsigned int decalages[4];
-    decalages[0] = 0;
-    for (int niveau = 1; niveau < 4; niveau++) 
-        decalages[niveau] = decalages[niveau-1] + (1U << bits_niveaux[niveau-1]);
-    unsigned char pixels_initiaux[3] = {0,0,0};
-    if (fread(pixels_initiaux, 1, nb_canaux, f) != (size_t)nb_canaux) { 
-        fclose(f); 
-        return DIF_ERR_FORMAT; 
-    }
-    long taille_entete = 2 + 2 + 2 + 1 + nb_niveaux;
-    long taille_premiers = nb_canaux;
-    long taille_compresse = taille_fichier - (taille_entete + taille_premiers);
-    if (taille_compresse < 0) { 
-        fclose(f); 
-        return DIF_ERR_FORMAT; 
-    }
-    
-    unsigned char *donnees_compressees = NULL;
-    size_t taille_comp = 0;
-    if (taille_compresse > 0) {
-        donnees_compressees = malloc((size_t)taille_compresse);
-        if (!donnees_compressees) { 
-            fclose(f); 
-            return DIF_ERR_ALLOC; 
-        }
-        if (fread(donnees_compressees, 1, (size_t)taille_compresse, f) != (size_t)taille_compresse) {
-            free(donnees_compressees); 
-            fclose(f); 
-            return DIF_ERR_FORMAT; 
-        }
-        
-        taille_comp = (size_t)taille_compresse;
-    }
-    
-    fclose(f);
-    uint64_t nb_pixels_total = (uint64_t)larg * (uint64_t)haut;
-    if (nb_pixels_total == 0 || nb_pixels_total > SIZE_MAX / (size_t)nb_canaux) {
-        free(donnees_compressees);
-        return DIF_ERR_FORMAT;
-    }
-    
-    size_t total_pixels = (size_t)nb_pixels_total;
-    unsigned char *plans = malloc(total_pixels * (size_t)nb_canaux);
-    if (!plans) {
-        free(donnees_compressees);
-        return DIF_ERR_ALLOC;
-    }
-    
-    FluxBits flux_lecture = { donnees_compressees, taille_comp, 0, 0, 0 };
-    if (nb_canaux == 1) {
-        int valeur_prec = pixels_initiaux[0];
-        plans[0] = (unsigned char)valeur_prec;
-        for (size_t idx = 1; idx < total_pixels; idx++) {
-            int bit, niveau;
-            unsigned int val = 0;
-            if (!lire_un_bit(&flux_lecture, &bit)) {
-                free(donnees_compressees);
-                free(plans);
-                return DIF_ERR_FORMAT;
-            }
-            
-            if (!bit) niveau = 0;
-            else {
-                if (!lire_un_bit(&flux_lecture, &bit)) {
-                    free(donnees_compressees);
-                    free(plans);
-                    return DIF_ERR_FORMAT;
-                }
-                
-                if (!bit) niveau = 1;
-                else {
-                    if (!lire_un_bit(&flux_lecture, &bit)) {
-                        free(donnees_compressees);
-                        free(plans);
-                        return DIF_ERR_FORMAT;
-                    }
-                    niveau = bit ? 3 : 2;
-                }
-            }
-            
-            if (bits_niveaux[niveau] > 0) {
-                if (!lire_n_bits(&flux_lecture, bits_niveaux[niveau], &val)) {
-                    free(donnees_compressees);
-                    free(plans);
-                    return DIF_ERR_FORMAT;
-                }
-            }
-            
-            unsigned int valeur_diff = decalages[niveau] + val;
-            int difference = deplier_delta((unsigned char)valeur_diff);
-            int valeur_courante = valeur_prec + difference;
-            
-            plans[idx] = limiter_octet(valeur_courante);
-            valeur_prec = valeur_courante;
-        }
-    } else {
-        int *valeurs_prec = malloc(sizeof(int) * nb_canaux);
-        if (!valeurs_prec) {
-            free(donnees_compressees);
-            free(plans);
-            return DIF_ERR_ALLOC;
-        }
-        
-        for (int canal = 0; canal < nb_canaux; canal++) {
-            valeurs_prec[canal] = pixels_initiaux[canal];
-            plans[canal * total_pixels] = (unsigned char)valeurs_prec[canal];
-        }
-        
-        for (size_t idx = 1; idx < total_pixels; idx++) {
-            for (int canal = 0; canal < nb_canaux; canal++) {
-                int bit, niveau;
-                unsigned int val = 0;
-                
-                if (!lire_un_bit(&flux_lecture, &bit)) {
-                    free(valeurs_prec);
-                    free(donnees_compressees);
-                    free(plans);
-                    return DIF_ERR_FORMAT;
-                }
-                
-                if (!bit) niveau = 0;
-                else {
-                    if (!lire_un_bit(&flux_lecture, &bit)) {
-                        free(valeurs_prec);
-                        free(donnees_compressees);
-                        free(plans);
-                        return DIF_ERR_FORMAT;
-                    }
-                    
-                    if (!bit) niveau = 1;
-                    else {
-                        if (!lire_un_bit(&flux_lecture, &bit)) {
-                            free(valeurs_prec);
-                            free(donnees_compressees);
-                            free(plans);
-                            return DIF_ERR_FORMAT;
-                        }
-                        niveau = bit ? 3 : 2;
-                    }
-                }
-                
-                if (bits_niveaux[niveau] > 0) {
-                    if (!lire_n_bits(&flux_lecture, bits_niveaux[niveau], &val)) {
-                        free(valeurs_prec);
-                        free(donnees_compressees);
-                        free(plans);
-                        return DIF_ERR_FORMAT;
-                    }
-                }
-                
-                unsigned int valeur_diff = decalages[niveau] + val;
-                int difference = deplier_delta((unsigned char)valeur_diff);
-                int valeur_courante = valeurs_prec[canal] + difference;
-                
-                plans[canal * total_pixels + idx] = limiter_octet(valeur_courante);
-                valeurs_prec[canal] = valeur_courante;
-            }
-        }
-        free(valeurs_prec);
-    }
-
-    free(donnees_compressees);
-
-    /* Réinterleavage RGB */
-    unsigned char *image_finale = malloc(total_pixels * (size_t)nb_canaux);
-    if (!image_finale) {
-        free(plans);
-        return DIF_ERR_ALLOC;
-    }
-
-    for (size_t idx = 0; idx < total_pixels; idx++)
-        for (int canal = 0; canal < nb_canaux; canal++)
-            image_finale[idx * nb_canaux + canal] = plans[canal * total_pixels + idx];
-
-    free(plans);
-
-    /* Restauration amplitude : multiplier par 2 */
-    size_t octets_totaux = total_pixels * (size_t)nb_canaux;
-    for (size_t i = 0; i < octets_totaux; i++) {
-        unsigned int valeur_amp = ((unsigned int)image_finale[i]) << 1;
-        if (valeur_amp > 255u) valeur_amp = 255u;
-        image_finale[i] = (unsigned char)valeur_amp;
-    }
-
-    /* Écriture PNM */
-    FILE *sortie = fopen(fichier_pnm, "wb");
-    if (!sortie) {
-        free(image_finale);
-        return DIF_ERR_IO;
-    }
-
-    fprintf(sortie, nb_canaux == 1 ? "P5\n" : "P6\n");
-    fprintf(sortie, "%u %u\n255\n", larg, haut);
-    
-    if (fwrite(image_finale, 1, octets_totaux, sortie) != octets_totaux) {
-        fclose(sortie);
-        free(image_finale);
-        return DIF_ERR_IO;
-    }
-    
-    fclose(sortie);
-    free(image_finale);
-    
-    return DIF_OK;
-}
-
-/* Décodage DIF raw (image différentielle) */
-int diftopnm_raw(const char* fichier_dif, const char* fichier_pnm)
-{
-    FILE *f = fopen(fichier_dif, "rb");
-    if (!f) return DIF_ERR_IO;
-
-    struct stat info_fichier;
-    if (stat(fichier_dif, &info_fichier) != 0) {
-        fclose(f);
-        return DIF_ERR_IO;
-    }
-    
-    long taille_fichier = (long)info_fichier.st_size;
-    if (taille_fichier < 0) {
-        fclose(f);
-        return DIF_ERR_IO;
-    }
-
-    uint16_t num_magique, larg, haut;
-    uint8_t nb_niveaux;
-    uint8_t entete7[7];
-    
-    if (fread(entete7, 1, 7, f) != 7) {
-        fclose(f);
-        return DIF_ERR_FORMAT;
-    }
-    
-    memcpy(&num_magique, entete7 + 0, 2);
-    memcpy(&larg, entete7 + 2, 2);
-    memcpy(&haut, entete7 + 4, 2);
-    nb_niveaux = entete7[6];
-
-    if (nb_niveaux != 4) {
-        fclose(f);
-        return DIF_ERR_FORMAT;
-    }
-
-    uint8_t bits_niveaux[4];
-    if (fread(bits_niveaux, 1, nb_niveaux, f) != (size_t)nb_niveaux) {
-        fclose(f);
-        return DIF_ERR_FORMAT;
-    }
-
-    int nb_canaux;
-    if (num_magique == DIF_MAGIC_GRAY) nb_canaux = 1;
-    else if (num_magique == DIF_MAGIC_COLOR) nb_canaux = 3;
-    else {
-        fclose(f);
-        return DIF_ERR_FORMAT;
-    }
-
-    unsigned int decalages[4];
-    decalages[0] = 0;
-    for (int niveau = 1; niveau < 4; niveau++) 
-        decalages[niveau] = decalages[niveau-1] + (1U << bits_niveaux[niveau-1]);
-
-    unsigned char pixels_initiaux[3] = {0,0,0};
-    if (fread(pixels_initiaux, 1, nb_canaux, f) != (size_t)nb_canaux) {
-        fclose(f);
-        return DIF_ERR_FORMAT;
-    }
-
-    long taille_entete = 2 + 2 + 2 + 1 + nb_niveaux;
-    long taille_premiers = nb_canaux;
-    long taille_compresse = taille_fichier - (taille_entete + taille_premiers);
-    
-    if (taille_compresse < 0) {
-        fclose(f);
-        return DIF_ERR_FORMAT;
-    }
-
-    unsigned char *donnees_comp = NULL;
-    size_t taille_comp = 0;
-    
-    if (taille_compresse > 0) {
-        donnees_comp = malloc((size_t)taille_compresse);
-        if (!donnees_comp) {
-            fclose(f);
-            return DIF_ERR_ALLOC;
-        }
-        
-        if (fread(donnees_comp, 1, (size_t)taille_compresse, f) != (size_t)taille_compresse) { 
-            free(donnees_comp); 
-            fclose(f); 
-            return DIF_ERR_FORMAT; 
-        }
-        
-        taille_comp = (size_t)taille_compresse;
-    }
-    
-    fclose(f);
-
-    uint64_t nb_pixels_total = (uint64_t)larg * (uint64_t)haut;
-    if (nb_pixels_total == 0 || nb_pixels_total > SIZE_MAX / (size_t)nb_canaux) {
-        free(donnees_comp);
-        return DIF_ERR_FORMAT;
-    }
-    
-    size_t total_pixels = (size_t)nb_pixels_total;
-
-    unsigned char *image_diff = malloc(total_pixels * (size_t)nb_canaux);
-    if (!image_diff) {
-        free(donnees_comp);
-        return DIF_ERR_ALLOC;
-    }
-
-    FluxBits flux_lecture = { donnees_comp, taille_comp, 0, 0, 0 };
-
-    if (nb_canaux == 1) {
-        image_diff[0] = 255;
-        
-        for (size_t idx = 1; idx < total_pixels; idx++) {
-            int bit, niveau;
-            unsigned int val = 0;
-            
-            if (!lire_un_bit(&flux_lecture, &bit)) {
-                free(donnees_comp);
-                free(image_diff);
-                return DIF_ERR_FORMAT;
-            }
-            
-            if (!bit) niveau = 0;
-            else {
-                if (!lire_un_bit(&flux_lecture, &bit)) {
-                    free(donnees_comp);
-                    free(image_diff);
-                    return DIF_ERR_FORMAT;
-                }
-                
-                if (!bit) niveau = 1;
-                else {
-                    if (!lire_un_bit(&flux_lecture, &bit)) {
-                        free(donnees_comp);
-                        free(image_diff);
-                        return DIF_ERR_FORMAT;
-                    }
-                    niveau = bit ? 3 : 2;
-                }
-            }
-            
-            if (bits_niveaux[niveau] > 0) {
-                if (!lire_n_bits(&flux_lecture, bits_niveaux[niveau], &val)) { 
-                    free(donnees_comp); 
-                    free(image_diff); 
-                    return DIF_ERR_FORMAT; 
-                }
-            }
-            
-            unsigned int valeur_repliee = decalages[niveau] + val;
-            int difference = deplier_delta((unsigned char)valeur_repliee);
-            
-            /* Amplification du contraste */
-            int diff_amplifiee = difference * 4;
-            int visualisation = 255 - abs(diff_amplifiee);
-            
-            if (visualisation < 0) visualisation = 0;
-            if (visualisation > 255) visualisation = 255;
-            
-            image_diff[idx] = (unsigned char)visualisation;
-        }
-    } else {
-        image_diff[0] = 255;
-        image_diff[1] = 255;
-        image_diff[2] = 255;
-        
-        size_t position = 3;
-        
-        for (size_t idx = 1; idx < total_pixels; idx++) {
-            for (int canal = 0; canal < nb_canaux; canal++) {
-                int bit, niveau;
-                unsigned int val = 0;
-                
-                if (!lire_un_bit(&flux_lecture, &bit)) {
-                    free(donnees_comp);
-                    free(image_diff);
-                    return DIF_ERR_FORMAT;
-                }
-                
-                if (!bit) niveau = 0;
-                else {
-                    if (!lire_un_bit(&flux_lecture, &bit)) {
-                        free(donnees_comp);
-                        free(image_diff);
-                        return DIF_ERR_FORMAT;
-                    }
-                    
-                    if (!bit) niveau = 1;
-                    else {
-                        if (!lire_un_bit(&flux_lecture, &bit)) {
-                            free(donnees_comp);
-                            free(image_diff);
-                            return DIF_ERR_FORMAT;
-                        }
-                        niveau = bit ? 3 : 2;
-                    }
-                }
-                
-                if (bits_niveaux[niveau] > 0) {
-                    if (!lire_n_bits(&flux_lecture, bits_niveaux[niveau], &val)) { 
-                        free(donnees_comp); 
-                        free(image_diff); 
-                        return DIF_ERR_FORMAT; 
-                    }
-                }
-                
-                unsigned int valeur_repliee = decalages[niveau] + val;
-                int difference = deplier_delta((unsigned char)valeur_repliee);
-                
-                /* Amplification du contraste */
-                int diff_amplifiee = difference * 4;
-                int visualisation = 255 - abs(diff_amplifiee);
-                
-                if (visualisation < 0) visualisation = 0;
-                if (visualisation > 255) visualisation = 255;
-                
-                image_diff[position++] = (unsigned char)visualisation;
-            }
-        }
-    }
-
-    free(donnees_comp);
-
-    /* Écriture PNM */
-    FILE *sortie = fopen(fichier_pnm, "wb");
-    if (!sortie) {
-        free(image_diff);
-        return DIF_ERR_IO;
-    }
-
-    fprintf(sortie, nb_canaux == 1 ? "P5\n" : "P6\n");
-    fprintf(sortie, "%u %u\n255\n", larg, haut);
-    
-    size_t octets_totaux = total_pixels * (size_t)nb_canaux;
-    if (fwrite(image_diff, 1, octets_totaux, sortie) != octets_totaux) { 
-        fclose(sortie); 
-        free(image_diff); 
-        return DIF_ERR_IO; 
-    }
-    
-    fclose(sortie);
-    free(image_diff);
-    
-    return DIF_OK;
-}
\ No newline at end of file
+#include "codec_interne.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Structure pour la gestion des flux binaires (écriture par mots de 32 bits) */
+typedef struct {
+    unsigned char *buffer;
+    size_t taille;
+    size_t position;
+    uint64_t accumulateur;
+    int bits_accumules;
+    FILE *fichier;          /* destination du tampon quand il est plein */
+    TamponDIF *tampon;      /* ou tampon de l'appelant, agrandi au besoin */
+    size_t ecrits;          /* octets déjà écrits dans le fichier */
+} FluxBits;
+
+/* En-tête d'un fichier DIF */
+typedef struct {
+    int nb_canaux;
+    uint16_t largeur;
+    uint16_t hauteur;
+    uint8_t nb_niveaux;
+    uint8_t bits_niveaux[4];
+    unsigned char pixels_initiaux[3];
+    /* en-tête étendu uniquement */
+    uint8_t version;            /* 0 = fichier DIF classique */
+    uint8_t options;
+    uint16_t hauteur_bande;
+    uint32_t nb_bandes;
+    uint8_t longueurs[256];     /* mode Huffman : longueur du code de chaque symbole */
+    uint16_t valeur_max;        /* 255, ou 256 à 65535 (DIF_OPTION_16BITS) */
+} EnteteDIF;
+
+/* Taille de l'en-tête étendu avant la table des positions des bandes */
+#define TAILLE_ENTETE_ETENDU (2 + 2 + 2 + 1 + 4 + 1 + 1 + 2)
+/* Taille de l'en-tête d'une séquence avant la table des positions des images */
+#define TAILLE_ENTETE_SEQUENCE (2 + 1 + 1 + 2 + 2 + 2 + 2 + 4)
+
+/* Zone de travail réutilisable d'une image à l'autre */
+typedef struct {
+    void *donnees;
+    size_t capacite;
+} ZoneDIF;
+
+/* Contexte d'encodage et de décodage : pool de threads, tables et zones de
+ * travail conservés entre les appels (une image à la fois par contexte) */
+struct dif_context {
+    OptionsDIF options;
+    PoolThreads *pool;
+    TableCodes codes;
+    TableVLC vlc;
+    uint8_t bits_codes[4];      /* quantificateur des tables construites */
+    uint8_t bits_vlc[4];
+    int plages_vlc;             /* table de décodage du mode plages */
+    int codes_prets;
+    int vlc_pret;
+    ZoneDIF lignes;             /* bloc de lignes brutes ou décodées */
+    ZoneDIF differences;        /* bloc de lignes de l'image différentielle */
+    ZoneDIF fichier;            /* tampon d'écriture ou de lecture du fichier */
+    ZoneDIF bandes;             /* flux compressés d'une vague de bandes */
+    ZoneDIF flux;               /* flux d'écriture des bandes */
+    ZoneDIF positions;          /* table des positions des bandes */
+    ZoneDIF positions_vague;
+    ZoneDIF erreurs;            /* erreur de chaque bande d'une vague */
+    ZoneDIF histogramme;        /* histogramme des échantillons sur 16 bits */
+    ZoneDIF vignette;           /* sommes et ligne de la vignette */
+    ZoneDIF sequence;           /* image de séquence décodée, prédiction de la suivante */
+    ZoneDIF reference;          /* image précédente entrelacée (encodage de plans) */
+    ZoneDIF images;             /* table des positions des images d'une séquence */
+    /* dernière image décodée de la séquence (données, taille, empreinte de
+     * l'en-tête et de la table des positions), conservée dans `sequence` */
+    const unsigned char *sequence_donnees;
+    size_t sequence_taille;
+    uint64_t sequence_empreinte;
+    uint32_t sequence_image;
+};
+
+/* Accès aux `nombre` octets suivants : pointeur direct en mémoire, copie
+ * dans `tampon` pour un fichier ; NULL si la source est trop courte */
+static const unsigned char *prendre_octets(SourceOctets *source, unsigned char *tampon, size_t nombre) {
+    if (source->fichier)
+        return fread(tampon, 1, nombre, source->fichier) == nombre ? tampon : NULL;
+    if (source->taille - source->position < nombre) return NULL;
+    const unsigned char *p = source->donnees + source->position;
+    source->position += nombre;
+    return p;
+}
+
+/* Saut des `nombre` octets suivants ; faux si la source est trop courte */
+static int sauter_octets(SourceOctets *source, size_t nombre) {
+    if (source->fichier)
+        return fseek(source->fichier, (long)nombre, SEEK_CUR) == 0;
+    if (source->taille - source->position < nombre) return 0;
+    source->position += nombre;
+    return 1;
+}
+
+/* Copie des `nombre` octets suivants dans `destination` */
+static int lire_octets(SourceOctets *source, void *destination, size_t nombre) {
+    const unsigned char *p = prendre_octets(source, destination, nombre);
+    if (!p) return 0;
+    if (p != destination) memcpy(destination, p, nombre);
+    return 1;
+}
+
+/* Repliement pair/impair sans branchement (négatifs = impairs, positifs = pairs) */
+static inline unsigned int replier(int delta) {
+    return ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+}
+
+/* Repliement pair/impair d'un delta */
+unsigned char replier_delta(int delta) {
+    return (unsigned char)replier(delta);
+}
+
+/* Dépliement pair/impair d'une valeur */
+int deplier_delta(unsigned char y) {
+    return (y & 1) ? -((int)y + 1) / 2 : (int)y / 2;
+}
+
+/* Décalage des échantillons avant prédiction : 1 (réduction d'amplitude),
+ * 0 en mode sans perte (deltas pris modulo 256) */
+static inline int decalage_modes(unsigned int modes) {
+    return (modes & DIF_MODE_SANS_PERTE) ? 0 : 1;
+}
+
+/* Chemin "-" : entrée ou sortie standard */
+static int chemin_standard(const char *chemin) {
+    return chemin[0] == '-' && chemin[1] == '\0';
+}
+
+/* Ouverture d'un fichier en lecture : projection en mémoire (lecture
+ * séquentielle annoncée au noyau), sinon lecture par fread ; l'entrée
+ * standard est toujours lue en flux, sans dépendre de sa taille */
+static int ouvrir_source(SourceOctets *source, const char *chemin) {
+    memset(source, 0, sizeof *source);
+    if (chemin_standard(chemin)) {
+        source->fichier = stdin;
+        return DIF_OK;
+    }
+    int fd = open(chemin, O_RDONLY);
+    if (fd < 0) return DIF_ERR_IO;
+    struct stat st;
+    void *adresse = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        adresse = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (adresse != MAP_FAILED) {
+        close(fd);
+        madvise(adresse, (size_t)st.st_size, MADV_SEQUENTIAL);
+        source->donnees = adresse;
+        source->taille = (size_t)st.st_size;
+        return DIF_OK;
+    }
+    source->fichier = fdopen(fd, "rb");
+    if (!source->fichier) {
+        close(fd);
+        return DIF_ERR_IO;
+    }
+    return DIF_OK;
+}
+
+static void fermer_source(SourceOctets *source) {
+    if (source->fichier) {
+        if (source->fichier != stdin)
+            fclose(source->fichier);
+    }
+    else if (source->donnees)
+        munmap((void *)source->donnees, source->taille);
+}
+
+/* Ouverture d'un fichier en écriture (sortie standard pour "-") */
+static FILE *ouvrir_sortie(const char *chemin) {
+    return chemin_standard(chemin) ? stdout : fopen(chemin, "wb");
+}
+
+/* Fermeture d'un fichier de sortie (la sortie standard est seulement vidée) */
+static int fermer_sortie(FILE *fichier, const char *chemin) {
+    int echec = chemin_standard(chemin) ? fflush(fichier) != 0 : fclose(fichier) != 0;
+    return echec ? DIF_ERR_IO : DIF_OK;
+}
+
+/* Suppression d'un fichier de sortie incomplet */
+static void supprimer_sortie(const char *chemin) {
+    if (!chemin_standard(chemin)) remove(chemin);
+}
+
+/* Vrai si le fichier accepte les retours en arrière (pas un tube) */
+static int sortie_positionnable(FILE *fichier) {
+    return fseek(fichier, 0, SEEK_CUR) == 0;
+}
+
+/* Ignorer les blancs et les commentaires d'un en-tête PNM ; renvoie le
+ * premier caractère significatif, déjà consommé */
+int ignorer_commentaires(SourceOctets *source){
+    int caractere;
+    while ((caractere = caractere_suivant(source)) != EOF) {
+        if (caractere == '#')
+            while ((caractere = caractere_suivant(source)) != EOF && caractere != '\n');
+        else if (!isspace(caractere))
+            return caractere;
+    }
+    return EOF;
+}
+
+/* Lecture d'un entier de l'en-tête PNM (ou d'un échantillon ASCII) ; le
+ * blanc qui le suit est consommé */
+int lire_entier_pnm(SourceOctets *source, int *valeur) {
+    int caractere = ignorer_commentaires(source);
+    if (!isdigit(caractere)) return 0;
+    *valeur = 0;
+    do {
+        if (*valeur > 100000) return 0;
+        *valeur = *valeur * 10 + (caractere - '0');
+        caractere = caractere_suivant(source);
+    } while (isdigit(caractere));
+    if (caractere == '#')
+        while ((caractere = caractere_suivant(source)) != EOF && caractere != '\n');
+    return 1;
+}
+
+/* Lecture de l'en-tête d'un fichier PNM binaire (P5, P6) ou ASCII (P2, P3),
+ * la source étant laissée sur le premier pixel ; valeur maximale de 1 à
+ * 65535 (en dessous de 255, les échantillons sont ramenés à 255 par
+ * l'appelant, au-delà ils sont sur 16 bits) */
+int lire_entete_pnm(SourceOctets *source, int *largeur, int *hauteur, int *nb_canaux,
+                    int *valeur_max, int *ascii)
+{
+    if (ignorer_commentaires(source) != 'P')
+        return DIF_ERR_FORMAT;
+    int type = caractere_suivant(source);
+    if (type == '5' || type == '2'){
+        *nb_canaux = 1;
+    }
+    else if (type == '6' || type == '3'){
+        *nb_canaux = 3;
+    }
+    else {
+        return DIF_ERR_FORMAT;
+    }
+    *ascii = type == '2' || type == '3';
+    if (!lire_entier_pnm(source, largeur) ||
+        !lire_entier_pnm(source, hauteur) ||
+        !lire_entier_pnm(source, valeur_max))
+        return DIF_ERR_FORMAT;
+    if (*largeur <= 0 || *hauteur <= 0 ||
+        *largeur > 65535 || *hauteur > 65535 ||
+        *valeur_max < 1 || *valeur_max > 65535)
+        return DIF_ERR_FORMAT;
+    return DIF_OK;
+}
+
+/* Table des échantillons 8 bits d'une valeur maximale inférieure à 255
+ * ramenés à 255 */
+static void construire_table_ramenee(unsigned char table[256], int valeur_max) {
+    for (int valeur = 0; valeur < 256; valeur++)
+        table[valeur] = ramener_echantillon((unsigned int)valeur, (unsigned int)valeur_max);
+}
+
+/* Échantillons ramenés à 255 par la table (source et destination peuvent
+ * être confondues) */
+static void ramener_echantillons(const unsigned char *source, unsigned char *destination, size_t n,
+                                 const unsigned char table[256])
+{
+    for (size_t i = 0; i < n; i++)
+        destination[i] = table[source[i]];
+}
+
+/* Octets par échantillon d'une image de valeur maximale `valeur_max` */
+static inline size_t octets_echantillon(int valeur_max) {
+    return valeur_max > 255 ? 2 : 1;
+}
+
+/* Échantillons 16 bits gros-boutistes (ordre des fichiers PNM) vers l'ordre
+ * natif, et inversement ; source et destination peuvent être confondues */
+static void lire_gros_boutistes16(const unsigned char *source, unsigned char *destination, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint16_t valeur = (uint16_t)(source[2 * i] << 8 | source[2 * i + 1]);
+        memcpy(destination + 2 * i, &valeur, 2);
+    }
+}
+
+static void ecrire_gros_boutistes16(const unsigned char *source, unsigned char *destination, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint16_t valeur;
+        memcpy(&valeur, source + 2 * i, 2);
+        destination[2 * i] = (unsigned char)(valeur >> 8);
+        destination[2 * i + 1] = (unsigned char)valeur;
+    }
+}
+
+/* Lecture d'un fichier PNM binaire ; au-delà de 255, échantillons uint16
+ * natifs, en dessous ramenés à 255 (les PNM ASCII passent par lire_image) */
+int lire_pnm(const char *chemin, ImagePNM *image_sortie) {
+    SourceOctets source;
+    if (ouvrir_source(&source, chemin) != DIF_OK)
+        return DIF_ERR_IO;
+    int largeur, hauteur, nb_canaux, valeur_max, ascii;
+    int err = lire_entete_pnm(&source, &largeur, &hauteur, &nb_canaux, &valeur_max, &ascii);
+    if (err == DIF_OK && ascii) err = DIF_ERR_FORMAT;
+    if (err != DIF_OK) {
+        fermer_source(&source);
+        return err;
+    }
+    size_t nb_echantillons = (size_t)largeur * hauteur * nb_canaux;
+    size_t taille_totale = nb_echantillons * octets_echantillon(valeur_max);
+    unsigned char *tampon = malloc(taille_totale);
+    if (!tampon) {
+        fermer_source(&source);
+        return DIF_ERR_ALLOC;
+    }
+    if (!lire_octets(&source, tampon, taille_totale)) {
+        free(tampon);
+        fermer_source(&source);
+        return DIF_ERR_FORMAT;
+    }
+    fermer_source(&source);
+    if (valeur_max > 255)
+        lire_gros_boutistes16(tampon, tampon, nb_echantillons);
+    else if (valeur_max < 255) {
+        unsigned char table[256];
+        construire_table_ramenee(table, valeur_max);
+        ramener_echantillons(tampon, tampon, nb_echantillons, table);
+        valeur_max = 255;
+    }
+    image_sortie->largeur = (uint16_t)largeur;
+    image_sortie->hauteur = (uint16_t)hauteur;
+    image_sortie->type = (uint8_t)nb_canaux;
+    image_sortie->donnees = tampon;
+    image_sortie->valeur_max = (uint16_t)valeur_max;
+    return DIF_OK;
+}
+
+/* Libération mémoire d'une image PNM */
+void liberer_pnm(ImagePNM *image) {
+    if (!image) return;
+    free(image->donnees);
+    image->donnees = NULL;
+}
+
+/* Zone d'au moins `taille` octets ; l'ancien contenu n'est pas conservé */
+static void *reserver_zone(ZoneDIF *zone, size_t taille) {
+    if (taille > zone->capacite) {
+        free(zone->donnees);
+        zone->donnees = malloc(taille);
+        zone->capacite = zone->donnees ? taille : 0;
+    }
+    return zone->donnees;
+}
+
+static void liberer_zone(ZoneDIF *zone) {
+    free(zone->donnees);
+    zone->donnees = NULL;
+    zone->capacite = 0;
+}
+
+static void initialiser_contexte(dif_context *contexte, const OptionsDIF *options) {
+    memset(contexte, 0, sizeof *contexte);
+    if (options)
+        contexte->options = *options;
+    else
+        options_dif_defaut(&contexte->options);
+}
+
+static void liberer_contexte(dif_context *contexte) {
+    detruire_pool(contexte->pool);
+    contexte->pool = NULL;
+    liberer_zone(&contexte->lignes);
+    liberer_zone(&contexte->differences);
+    liberer_zone(&contexte->fichier);
+    liberer_zone(&contexte->bandes);
+    liberer_zone(&contexte->flux);
+    liberer_zone(&contexte->positions);
+    liberer_zone(&contexte->positions_vague);
+    liberer_zone(&contexte->erreurs);
+    liberer_zone(&contexte->histogramme);
+    liberer_zone(&contexte->vignette);
+    liberer_zone(&contexte->sequence);
+    liberer_zone(&contexte->reference);
+    liberer_zone(&contexte->images);
+    contexte->sequence_donnees = NULL;
+}
+
+/* Création d'un contexte réutilisable (options == NULL : options par défaut) */
+dif_context *dif_context_creer(const OptionsDIF *options) {
+    dif_context *contexte = malloc(sizeof *contexte);
+    if (contexte) initialiser_contexte(contexte, options);
+    return contexte;
+}
+
+/* Destruction du contexte et de ses zones de travail */
+void dif_context_detruire(dif_context *contexte) {
+    if (!contexte) return;
+    liberer_contexte(contexte);
+    free(contexte);
+}
+
+/* Pool de threads du contexte, créé au premier encodage ou décodage en bandes */
+static PoolThreads *pool_contexte(dif_context *contexte) {
+    if (!contexte->pool)
+        contexte->pool = creer_pool(contexte->options.nb_threads);
+    return contexte->pool;
+}
+
+/* Initialisation d'un flux d'écriture sur une zone de travail de `taille` octets */
+static int initialiser_flux_ecriture(FluxBits *flux, ZoneDIF *zone, size_t taille) {
+    memset(flux, 0, sizeof *flux);
+    flux->buffer = reserver_zone(zone, taille);
+    if (!flux->buffer) return DIF_ERR_ALLOC;
+    flux->taille = taille;
+    return DIF_OK;
+}
+
+/* Réallocation par défaut des tampons alloués par la bibliothèque */
+static void *reallouer_defaut(void *contexte, void *ancien, size_t taille) {
+    (void)contexte;
+    return realloc(ancien, taille);
+}
+
+/* Un tampon vide de l'appelant sera alloué par realloc, et pourra ensuite
+ * être réutilisé (et agrandi) par les appels suivants */
+static void preparer_tampon(TamponDIF *tampon) {
+    tampon->taille = 0;
+    if (tampon->donnees) return;
+    tampon->capacite = 0;
+    if (!tampon->reallouer) tampon->reallouer = reallouer_defaut;
+}
+
+/* Initialisation d'un flux d'écriture sur le tampon de l'appelant */
+static void initialiser_flux_tampon(FluxBits *flux, TamponDIF *tampon) {
+    memset(flux, 0, sizeof *flux);
+    preparer_tampon(tampon);
+    flux->tampon = tampon;
+    flux->buffer = tampon->donnees;
+    flux->taille = tampon->capacite;
+}
+
+/* Garantit une capacité d'au moins `capacite` octets au tampon de l'appelant */
+static int agrandir_tampon(TamponDIF *tampon, size_t capacite) {
+    if (tampon->capacite >= capacite) return DIF_OK;
+    if (!tampon->reallouer) return DIF_ERR_TAILLE;
+    void *nouveau = tampon->reallouer(tampon->contexte, tampon->donnees, capacite);
+    if (!nouveau) return DIF_ERR_ALLOC;
+    tampon->donnees = nouveau;
+    tampon->capacite = capacite;
+    return DIF_OK;
+}
+
+/* Vidage des octets complets du tampon vers le fichier */
+static int vider_flux(FluxBits *flux) {
+    if (flux->fichier && flux->position) {
+        if (fwrite(flux->buffer, 1, flux->position, flux->fichier) != flux->position)
+            return DIF_ERR_IO;
+        flux->ecrits += flux->position;
+        flux->position = 0;
+    }
+    return DIF_OK;
+}
+
+/* Garantit la place pour au moins `besoin` octets dans le tampon : vidage
+ * vers le fichier, ou agrandissement du tampon de l'appelant */
+static int reserver_flux(FluxBits *flux, size_t besoin) {
+    if (flux->position + besoin <= flux->taille) return DIF_OK;
+    if (flux->tampon) {
+        size_t capacite = flux->taille ? flux->taille : DIF_TAILLE_TAMPON;
+        while (capacite < flux->position + besoin) capacite *= 2;
+        int err = agrandir_tampon(flux->tampon, capacite);
+        flux->buffer = flux->tampon->donnees;
+        flux->taille = flux->tampon->capacite;
+        return err;
+    }
+    if (vider_flux(flux) != DIF_OK) return DIF_ERR_IO;
+    return flux->position + besoin <= flux->taille ? DIF_OK : DIF_ERR_ALLOC;
+}
+
+/* Écriture d'octets bruts (flux aligné sur un octet) ; les blocs plus grands
+ * que le tampon vont directement dans le fichier */
+static int ecrire_octets(FluxBits *flux, const void *octets, size_t nombre) {
+    if (flux->fichier && nombre > flux->taille) {
+        if (vider_flux(flux) != DIF_OK || fwrite(octets, 1, nombre, flux->fichier) != nombre)
+            return DIF_ERR_IO;
+        flux->ecrits += nombre;
+        return DIF_OK;
+    }
+    int err = reserver_flux(flux, nombre);
+    if (err != DIF_OK) return err;
+    memcpy(flux->buffer + flux->position, octets, nombre);
+    flux->position += nombre;
+    return DIF_OK;
+}
+
+/* Position d'écriture depuis le début du flux (octets alignés) */
+static size_t position_flux(const FluxBits *flux) {
+    return flux->ecrits + flux->position;
+}
+
+/* Réécriture d'octets déjà émis, à la position `debut` depuis le début du
+ * flux (le flux d'un fichier doit avoir été vidé) ; l'écriture reprend
+ * ensuite à la fin du fichier */
+static int reecrire_flux(FluxBits *flux, size_t debut, const void *octets, size_t nombre) {
+    if (!flux->fichier) {
+        memcpy(flux->buffer + debut, octets, nombre);
+        return DIF_OK;
+    }
+    if (fseek(flux->fichier, (long)debut, SEEK_SET) != 0 ||
+        fwrite(octets, 1, nombre, flux->fichier) != nombre ||
+        fseek(flux->fichier, 0, SEEK_END) != 0)
+        return DIF_ERR_IO;
+    return DIF_OK;
+}
+
+/* Écriture d'un mot de code dans le flux (nb_bits <= 32) */
+static inline void ecrire_bits(FluxBits *flux, uint32_t code, int nb_bits) {
+    flux->accumulateur = (flux->accumulateur << nb_bits) | code;
+    flux->bits_accumules += nb_bits;
+    if (flux->bits_accumules >= 32) {
+        flux->bits_accumules -= 32;
+        uint32_t mot = (uint32_t)(flux->accumulateur >> flux->bits_accumules);
+        unsigned char *p = flux->buffer + flux->position;
+        p[0] = (unsigned char)(mot >> 24);
+        p[1] = (unsigned char)(mot >> 16);
+        p[2] = (unsigned char)(mot >> 8);
+        p[3] = (unsigned char)mot;
+        flux->position += 4;
+    }
+}
+
+/* Finalisation du flux (écriture des derniers octets, complétés par des zéros) */
+static int finaliser_flux(FluxBits *flux) {
+    int err = reserver_flux(flux, 4);
+    if (err != DIF_OK) return err;
+    while (flux->bits_accumules >= 8) {
+        flux->bits_accumules -= 8;
+        flux->buffer[flux->position++] = (unsigned char)(flux->accumulateur >> flux->bits_accumules);
+    }
+    if (flux->bits_accumules) {
+        flux->buffer[flux->position++] =
+            (unsigned char)(flux->accumulateur << (8 - flux->bits_accumules));
+        flux->bits_accumules = 0;
+    }
+    return DIF_OK;
+}
+
+/* Construction de la table des mots de code (préfixe et charge utile
+ * concaténés), indexée par symbole : la valeur repliée elle-même, ou
+ * l'annonce de plage puis les valeurs décalées de 1 en mode plages */
+int construire_table_codes(TableCodes *table, const uint8_t bits_niveaux[4]) {
+    static const uint32_t prefixes[4] = {0b0, 0b10, 0b110, 0b111};
+    static const uint8_t longueurs_prefixes[4] = {1, 2, 3, 3};
+    unsigned int debut = 0;
+    int niveau = 0;
+    for (unsigned int valeur = 0; valeur < 256; valeur++) {
+        while (niveau < 4 && valeur >= debut + (1U << bits_niveaux[niveau])) {
+            debut += 1U << bits_niveaux[niveau];
+            niveau++;
+        }
+        if (niveau == 4 || bits_niveaux[niveau] > 8) return DIF_ERR_FORMAT;
+        table->code[valeur] = (uint16_t)((prefixes[niveau] << bits_niveaux[niveau]) | (valeur - debut));
+        table->longueur[valeur] = (uint8_t)(longueurs_prefixes[niveau] + bits_niveaux[niveau]);
+    }
+    return DIF_OK;
+}
+
+/* Table d'encodage du contexte, reconstruite seulement si le quantificateur change */
+static const TableCodes *table_codes_contexte(dif_context *contexte, const uint8_t bits_niveaux[4]) {
+    if (!contexte->codes_prets || memcmp(contexte->bits_codes, bits_niveaux, 4) != 0) {
+        contexte->codes_prets = 0;
+        if (construire_table_codes(&contexte->codes, bits_niveaux) != DIF_OK) return NULL;
+        memcpy(contexte->bits_codes, bits_niveaux, 4);
+        contexte->codes_prets = 1;
+    }
+    return &contexte->codes;
+}
+
+/* Place maximale de la fin d'une plage de `plage` zéros */
+static size_t octets_plage(size_t plage) {
+    return (plage / DIF_PLAGE_MAX + 1) * 6;
+}
+
+/* Destination des symboles d'une bande : un seul flux, ou DIF_SOUS_FLUX
+ * sous-flux entrelacés en mode Huffman, où le symbole k de la bande va au
+ * sous-flux k % DIF_SOUS_FLUX (la longueur d'une plage suit son annonce) */
+typedef struct {
+    FluxBits *flux;
+    unsigned int nb_flux;
+    unsigned int courant;   /* sous-flux du prochain symbole */
+} SortieSymboles;
+
+/* Sous-flux du prochain symbole, puis passage au suivant */
+static inline FluxBits *flux_symbole(SortieSymboles *sortie) {
+    FluxBits *flux = &sortie->flux[sortie->courant];
+    if (++sortie->courant == sortie->nb_flux) sortie->courant = 0;
+    return flux;
+}
+
+/* Place de `nb_symboles` symboles et `supplement` octets dans chaque flux */
+static int reserver_symboles(SortieSymboles *sortie, size_t nb_symboles, size_t supplement) {
+    size_t par_flux = (nb_symboles + sortie->nb_flux - 1) / sortie->nb_flux;
+    for (unsigned int i = 0; i < sortie->nb_flux; i++) {
+        int err = reserver_flux(&sortie->flux[i], par_flux * DIF_BITS_LUT / 8 + supplement);
+        if (err != DIF_OK) return err;
+    }
+    return DIF_OK;
+}
+
+/* Fin d'une plage de zéros : symbole 1 pour un zéro isolé, sinon annonce et
+ * longueur en Exp-Golomb, en plusieurs plages au-delà de DIF_PLAGE_MAX */
+static void terminer_plage(SortieSymboles *sortie, const TableCodes *table, size_t *plage) {
+    while (*plage) {
+        FluxBits *flux = flux_symbole(sortie);
+        size_t longueur = *plage < DIF_PLAGE_MAX ? *plage : DIF_PLAGE_MAX;
+        if (longueur < DIF_PLAGE_MIN) {
+            ecrire_bits(flux, table->code[1], table->longueur[1]);
+        } else {
+            uint32_t valeur = (uint32_t)(longueur - DIF_PLAGE_MIN + 1);
+            int nb_bits = 32 - __builtin_clz(valeur);
+            ecrire_bits(flux, table->code[0], table->longueur[0]);
+            ecrire_bits(flux, valeur, 2 * nb_bits - 1);
+        }
+        *plage -= longueur;
+    }
+}
+
+/* ecrire_bits sans branchement : le mot de 32 bits est toujours écrit à la
+ * position courante, qui n'avance qu'une fois 32 bits accumulés (un mot
+ * incomplet est réécrit au symbole suivant ; 4 octets de marge) : les
+ * vidages de sous-flux écrits à tour de rôle se prédisent mal. */
+static inline void ecrire_bits_continu(FluxBits *flux, uint32_t code, int nb_bits) {
+    flux->accumulateur = (flux->accumulateur << nb_bits) | code;
+    flux->bits_accumules += nb_bits;
+    int plein = flux->bits_accumules >= 32;
+    flux->bits_accumules -= 32 * plein;
+    uint32_t mot = (uint32_t)(flux->accumulateur >> flux->bits_accumules);
+    unsigned char *p = flux->buffer + flux->position;
+    p[0] = (unsigned char)(mot >> 24);
+    p[1] = (unsigned char)(mot >> 16);
+    p[2] = (unsigned char)(mot >> 8);
+    p[3] = (unsigned char)mot;
+    flux->position += 4 * (size_t)plein;
+}
+
+/* Symboles replies[k] répartis tour à tour dans les DIF_SOUS_FLUX sous-flux,
+ * par tours complets ; retourne le nombre de symboles écrits. Chaque sous-flux
+ * est écrit d'une traite (un symbole sur DIF_SOUS_FLUX), comme un flux
+ * unique : seul le décodage gagne à entrelacer. */
+static size_t ecrire_replies_entrelaces(FluxBits flux[DIF_SOUS_FLUX], const TableCodes *table,
+                                        const uint8_t *replies, size_t n)
+{
+    size_t fin = n - n % DIF_SOUS_FLUX;
+    for (int i = 0; i < DIF_SOUS_FLUX; i++) {
+        FluxBits ecrivain = flux[i];
+        for (size_t k = (size_t)i; k < fin; k += DIF_SOUS_FLUX)
+            ecrire_bits(&ecrivain, table->code[replies[k]], table->longueur[replies[k]]);
+        flux[i] = ecrivain;
+    }
+    return fin;
+}
+
+/* Écriture de valeurs repliées. Avec `plage` (mode plages), les zéros sont
+ * comptés dans la plage en cours, reportée d'un appel à l'autre. */
+static void ecrire_replies(SortieSymboles *sortie, const TableCodes *table, const uint8_t *replies,
+                           size_t n, size_t *plage)
+{
+    if (!plage && sortie->nb_flux == 1) {
+        FluxBits *flux = sortie->flux;
+        for (size_t k = 0; k < n; k++)
+            ecrire_bits(flux, table->code[replies[k]], table->longueur[replies[k]]);
+        return;
+    }
+    if (!plage) {
+        size_t k = 0;
+        for (; k < n && sortie->courant; k++)
+            ecrire_bits(flux_symbole(sortie), table->code[replies[k]], table->longueur[replies[k]]);
+        k += ecrire_replies_entrelaces(sortie->flux, table, replies + k, n - k);
+        for (; k < n; k++)
+            ecrire_bits(flux_symbole(sortie), table->code[replies[k]], table->longueur[replies[k]]);
+        return;
+    }
+    /* plage, sous-flux courant et sortie en variables locales (les octets
+     * écrits dans les flux pourraient sinon les modifier) */
+    FluxBits *flux = sortie->flux;
+    unsigned int nb_flux = sortie->nb_flux, courant = sortie->courant;
+    size_t zeros = *plage;
+    for (size_t k = 0; k < n; k++) {
+        if (replies[k] == 0) {
+            zeros++;
+            continue;
+        }
+        if (zeros) {
+            sortie->courant = courant;
+            terminer_plage(sortie, table, &zeros);
+            courant = sortie->courant;
+        }
+        unsigned int symbole = replies[k] + 1u;
+        if (nb_flux == 1)
+            ecrire_bits(flux, table->code[symbole], table->longueur[symbole]);
+        else
+            ecrire_bits_continu(&flux[courant], table->code[symbole], table->longueur[symbole]);
+        if (++courant == nb_flux) courant = 0;
+    }
+    *plage = zeros;
+    sortie->courant = courant;
+}
+
+/* Table d'encodage de Huffman, propre à chaque image (remplace la table du
+ * contexte) */
+static const TableCodes *table_codes_huffman(dif_context *contexte, const uint8_t longueurs[256]) {
+    contexte->codes_prets = 0;
+    if (construire_codes_huffman(&contexte->codes, longueurs) != DIF_OK) return NULL;
+    return &contexte->codes;
+}
+
+/* Encodage en une seule passe : réduction d'amplitude (sauf `decalage`
+ * nul), différence avec l'échantillon précédent du même canal (ou résidu
+ * MED si la ligne `precedente` est fournie), repliement et code VLC.
+ * Les nb_canaux premiers octets de `donnees` servent uniquement de prédiction. */
+static int encoder_echantillons(SortieSymboles *sortie, const TableCodes *table, const unsigned char *donnees,
+                                const unsigned char *precedente, size_t taille, int nb_canaux,
+                                int decalage, size_t *plage)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    size_t i = (size_t)nb_canaux;
+    while (i < taille) {
+        size_t fin = (taille - i > DIF_SEGMENT) ? i + DIF_SEGMENT : taille;
+        int err = reserver_symboles(sortie, fin - i, 8 + (plage ? octets_plage(*plage) : 0));
+        if (err != DIF_OK) return err;
+        uint8_t replies[DIF_SEGMENT];
+        if (precedente)
+            noyaux->replier_residus_med(donnees + i, precedente + i, fin - i, nb_canaux, decalage,
+                                        replies);
+        else
+            noyaux->replier_differences(donnees + i, fin - i, nb_canaux, decalage, replies);
+        ecrire_replies(sortie, table, replies, fin - i, plage);
+        i = fin;
+    }
+    return DIF_OK;
+}
+
+/* Encodage de lignes espacées de `pas` octets. Le premier pixel de chaque
+ * ligne est prédit par `precedents` (dernier pixel réduit de la ligne
+ * précédente), sauf en début de chaîne où il sert de pixel initial.
+ * En mode MED, à partir de la deuxième ligne, le premier pixel est prédit
+ * par celui du dessus et les suivants par le prédicteur MED.
+ * En mode plages, la plage en cours est terminée à la fin de chaque ligne. */
+static int encoder_lignes(SortieSymboles *sortie, const TableCodes *table, const unsigned char *pixels,
+                          size_t pas, size_t nb_lignes, size_t octets_ligne, int nb_canaux,
+                          unsigned char precedents[3], int debut_chaine, unsigned int modes)
+{
+    size_t plage = 0;
+    size_t *plages = (modes & DIF_MODE_PLAGES) ? &plage : NULL;
+    int decalage = decalage_modes(modes);
+    for (size_t ligne = 0; ligne < nb_lignes; ligne++) {
+        const unsigned char *p = pixels + ligne * pas;
+        const unsigned char *precedente = (modes & DIF_MODE_MED) && ligne > 0 ? p - pas : NULL;
+        if (precedente) {
+            for (int canal = 0; canal < nb_canaux; canal++)
+                precedents[canal] = precedente[canal] >> decalage;
+        }
+        if (ligne > 0 || !debut_chaine) {
+            int err = reserver_symboles(sortie, 0, 8);
+            if (err != DIF_OK) return err;
+            uint8_t premiers[3];
+            for (int canal = 0; canal < nb_canaux; canal++)
+                premiers[canal] = (uint8_t)replier((int8_t)((p[canal] >> decalage) - precedents[canal]));
+            ecrire_replies(sortie, table, premiers, (size_t)nb_canaux, plages);
+        }
+        int err = encoder_echantillons(sortie, table, p, precedente, octets_ligne, nb_canaux, decalage,
+                                       plages);
+        if (err == DIF_OK && plage) {
+            err = reserver_symboles(sortie, 0, octets_plage(plage) + 8);
+            if (err == DIF_OK) terminer_plage(sortie, table, &plage);
+        }
+        if (err != DIF_OK) return err;
+        for (int canal = 0; canal < nb_canaux; canal++)
+            precedents[canal] = p[octets_ligne - nb_canaux + canal] >> decalage;
+    }
+    return DIF_OK;
+}
+
+/* Encodage de lignes prédites par les mêmes lignes de l'image précédente
+ * (DIF_OPTION_TEMPOREL) : tous les échantillons sont codés, premier pixel
+ * compris ; en mode plages, la plage en cours est terminée à chaque ligne */
+static int encoder_lignes_temporelles(SortieSymboles *sortie, const TableCodes *table, const unsigned char *pixels,
+                                      size_t pas, const unsigned char *reference, size_t pas_reference,
+                                      size_t nb_lignes, size_t octets_ligne, unsigned int modes)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    size_t plage = 0;
+    size_t *plages = (modes & DIF_MODE_PLAGES) ? &plage : NULL;
+    int decalage = decalage_modes(modes);
+    for (size_t ligne = 0; ligne < nb_lignes; ligne++) {
+        const unsigned char *p = pixels + ligne * pas;
+        const unsigned char *precedente = reference + ligne * pas_reference;
+        for (size_t i = 0; i < octets_ligne; ) {
+            size_t fin = (octets_ligne - i > DIF_SEGMENT) ? i + DIF_SEGMENT : octets_ligne;
+            int err = reserver_symboles(sortie, fin - i, 8 + (plages ? octets_plage(plage) : 0));
+            if (err != DIF_OK) return err;
+            uint8_t replies[DIF_SEGMENT];
+            noyaux->replier_ecarts_temporels(p + i, precedente + i, fin - i, decalage, replies);
+            ecrire_replies(sortie, table, replies, fin - i, plages);
+            i = fin;
+        }
+        if (plage) {
+            int err = reserver_symboles(sortie, 0, octets_plage(plage) + 8);
+            if (err != DIF_OK) return err;
+            terminer_plage(sortie, table, &plage);
+        }
+    }
+    return DIF_OK;
+}
+
+/* Plus long mot de code des échantillons sur 16 bits : préfixe (3) + charge (16) */
+#define DIF_BITS_MAX16 19
+/* Valeurs repliées des échantillons sur 16 bits */
+#define DIF_VALEURS16 65536u
+
+/* Code à 4 niveaux des échantillons sur 16 bits : mêmes préfixes, jusqu'à
+ * 16 bits de charge par niveau. Trop grand pour une table indexée par les
+ * prochains bits du flux : le niveau est tiré du préfixe à la volée. */
+typedef struct {
+    uint32_t debut[4];          /* première valeur repliée du niveau */
+    uint32_t prefixe[4];
+    uint8_t bits[4];
+    uint8_t longueur[4];        /* préfixe + charge */
+} Niveaux16;
+
+/* Niveaux d'un quantificateur sur 16 bits ; erreur s'il ne couvre pas les
+ * 65536 valeurs repliées */
+static int preparer_niveaux16(Niveaux16 *niveaux, const uint8_t bits_niveaux[4]) {
+    static const uint32_t prefixes[4] = {0b0, 0b10, 0b110, 0b111};
+    static const uint8_t longueurs_prefixes[4] = {1, 2, 3, 3};
+    uint32_t debut = 0;
+    for (int niveau = 0; niveau < 4; niveau++) {
+        if (bits_niveaux[niveau] > 16) return DIF_ERR_FORMAT;
+        niveaux->debut[niveau] = debut;
+        niveaux->prefixe[niveau] = prefixes[niveau];
+        niveaux->bits[niveau] = bits_niveaux[niveau];
+        niveaux->longueur[niveau] = (uint8_t)(longueurs_prefixes[niveau] + bits_niveaux[niveau]);
+        debut += 1u << bits_niveaux[niveau];
+    }
+    return debut >= DIF_VALEURS16 ? DIF_OK : DIF_ERR_FORMAT;
+}
+
+/* Écriture d'une valeur repliée sur 16 bits */
+static inline void ecrire_valeur16(FluxBits *flux, const Niveaux16 *niveaux, unsigned int valeur) {
+    int niveau = (valeur >= niveaux->debut[1]) + (valeur >= niveaux->debut[2]) +
+                 (valeur >= niveaux->debut[3]);
+    ecrire_bits(flux, niveaux->prefixe[niveau] << niveaux->bits[niveau] | (valeur - niveaux->debut[niveau]),
+                niveaux->longueur[niveau]);
+}
+
+/* Encodage d'échantillons sur 16 bits, comme encoder_echantillons (sans
+ * plages ni Huffman) : différences ou résidus MED pris modulo 65536 */
+static int encoder_echantillons16(FluxBits *flux, const Niveaux16 *niveaux, const uint16_t *donnees,
+                                  const uint16_t *precedente, size_t taille, int nb_canaux, int decalage)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    size_t i = (size_t)nb_canaux;
+    while (i < taille) {
+        size_t fin = (taille - i > DIF_SEGMENT) ? i + DIF_SEGMENT : taille;
+        int err = reserver_flux(flux, (fin - i) * DIF_BITS_MAX16 / 8 + 8);
+        if (err != DIF_OK) return err;
+        uint16_t replies[DIF_SEGMENT];
+        if (precedente)
+            noyaux->replier_residus_med16(donnees + i, precedente + i, fin - i, nb_canaux, decalage,
+                                          replies);
+        else
+            noyaux->replier_differences16(donnees + i, fin - i, nb_canaux, decalage, replies);
+        for (size_t k = 0; k < fin - i; k++)
+            ecrire_valeur16(flux, niveaux, replies[k]);
+        i = fin;
+    }
+    return DIF_OK;
+}
+
+/* Encodage de lignes d'échantillons sur 16 bits en début de chaîne (bande),
+ * comme encoder_lignes : `precedents` contient les pixels initiaux réduits */
+static int encoder_lignes16(FluxBits *flux, const Niveaux16 *niveaux, const unsigned char *pixels,
+                            size_t pas, size_t nb_lignes, size_t nb_echantillons, int nb_canaux,
+                            uint16_t precedents[3], unsigned int modes)
+{
+    int decalage = decalage_modes(modes);
+    for (size_t ligne = 0; ligne < nb_lignes; ligne++) {
+        const uint16_t *p = (const uint16_t *)(pixels + ligne * pas);
+        const uint16_t *precedente = (modes & DIF_MODE_MED) && ligne > 0
+                                   ? (const uint16_t *)(pixels + (ligne - 1) * pas) : NULL;
+        if (precedente) {
+            for (int canal = 0; canal < nb_canaux; canal++)
+                precedents[canal] = precedente[canal] >> decalage;
+        }
+        if (ligne > 0) {
+            int err = reserver_flux(flux, 8);
+            if (err != DIF_OK) return err;
+            for (int canal = 0; canal < nb_canaux; canal++)
+                ecrire_valeur16(flux, niveaux,
+                                replier((int16_t)((p[canal] >> decalage) - precedents[canal])));
+        }
+        int err = encoder_echantillons16(flux, niveaux, p, precedente, nb_echantillons, nb_canaux,
+                                         decalage);
+        if (err != DIF_OK) return err;
+        for (int canal = 0; canal < nb_canaux; canal++)
+            precedents[canal] = p[nb_echantillons - nb_canaux + canal] >> decalage;
+    }
+    return DIF_OK;
+}
+
+/* Encodage de lignes d'échantillons sur 16 bits prédites par l'image
+ * précédente, comme encoder_lignes_temporelles */
+static int encoder_lignes_temporelles16(FluxBits *flux, const Niveaux16 *niveaux, const unsigned char *pixels,
+                                        size_t pas, const unsigned char *reference, size_t pas_reference,
+                                        size_t nb_lignes, size_t nb_echantillons, unsigned int modes)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    int decalage = decalage_modes(modes);
+    for (size_t ligne = 0; ligne < nb_lignes; ligne++) {
+        const uint16_t *p = (const uint16_t *)(pixels + ligne * pas);
+        const uint16_t *precedente = (const uint16_t *)(reference + ligne * pas_reference);
+        for (size_t i = 0; i < nb_echantillons; ) {
+            size_t fin = (nb_echantillons - i > DIF_SEGMENT) ? i + DIF_SEGMENT : nb_echantillons;
+            int err = reserver_flux(flux, (fin - i) * DIF_BITS_MAX16 / 8 + 8);
+            if (err != DIF_OK) return err;
+            uint16_t replies[DIF_SEGMENT];
+            noyaux->replier_ecarts_temporels16(p + i, precedente + i, fin - i, decalage, replies);
+            for (size_t k = 0; k < fin - i; k++)
+                ecrire_valeur16(flux, niveaux, replies[k]);
+            i = fin;
+        }
+    }
+    return DIF_OK;
+}
+
+/* Écriture de l'en-tête DIF et des pixels initiaux */
+static int ecrire_entete_dif(FluxBits *flux, int nb_canaux, uint16_t largeur, uint16_t hauteur,
+                             const uint8_t bits_par_niveau[4], const unsigned char *premiers)
+{
+    uint16_t numero_magique = (nb_canaux == 3) ? DIF_MAGIC_COLOR : DIF_MAGIC_GRAY;
+    uint8_t nombre_niveaux = 4;
+    uint8_t entete[2 + 2 + 2 + 1 + 4 + 3];
+    memcpy(entete + 0, &numero_magique, 2);
+    memcpy(entete + 2, &largeur, 2);
+    memcpy(entete + 4, &hauteur, 2);
+    entete[6] = nombre_niveaux;
+    memcpy(entete + 7, bits_par_niveau, nombre_niveaux);
+    memcpy(entete + 7 + nombre_niveaux, premiers, nb_canaux);
+    return ecrire_octets(flux, entete, 7 + nombre_niveaux + nb_canaux);
+}
+
+/* Options par défaut : fichier DIF classique, autant de threads que de coeurs */
+void options_dif_defaut(OptionsDIF *options) {
+    options->nb_threads = 0;
+    options->hauteur_bande = 0;
+    options->quantificateur_fixe = 0;
+    options->modes = 0;
+    options->intervalle_cles = 0;
+}
+
+/* Taille maximale du flux compressé de n échantillons */
+static size_t taille_max_flux(size_t nb_echantillons) {
+    return nb_echantillons * DIF_BITS_LUT / 8 + 16;
+}
+
+/* Taille maximale d'un sous-flux d'une bande de n échantillons en mode
+ * Huffman (le quart des symboles, arrondi, et une marge) */
+static size_t taille_max_sous_flux(size_t nb_echantillons) {
+    return taille_max_flux(nb_echantillons / DIF_SOUS_FLUX + 16);
+}
+
+/* Taille maximale d'une bande de n échantillons : pixels initiaux puis flux
+ * VLC, ou en mode Huffman table des tailles et sous-flux */
+static size_t taille_max_bande(size_t octets_premiers, size_t nb_echantillons, unsigned int options) {
+    if (!(options & DIF_MODE_HUFFMAN))
+        return octets_premiers + taille_max_flux(nb_echantillons);
+    return octets_premiers + (DIF_SOUS_FLUX - 1) * sizeof(uint32_t) +
+           DIF_SOUS_FLUX * taille_max_sous_flux(nb_echantillons);
+}
+
+/* Lignes brutes à encoder : lues par blocs dans un fichier, prises
+ * directement dans l'image de l'appelant, ou entrelacées à partir de ses
+ * plans (pas_plan non nul) ; décorrélées en couleur si demandé.
+ * Dans une séquence, l'image précédente peut servir de prédiction.
+ * Échantillons sur 16 bits au-delà de valeur_max 255 (entrelacés, sans
+ * décorrélation), remis dans l'ordre natif s'ils viennent d'un PNM ;
+ * échantillons d'un PNM de valeur maximale inférieure à 255 ramenés à 255
+ * à mesure qu'ils sont lus. */
+typedef struct {
+    FILE *fichier;
+    const unsigned char *pixels;
+    size_t pas;
+    size_t octets_ligne;
+    size_t pas_plan;
+    int decorrelation;
+    int decalage;               /* décalage des échantillons décorrélés */
+    int valeur_max;
+    int gros_boutiste;          /* échantillons 16 bits dans l'ordre PNM */
+    unsigned char *bloc;
+    const unsigned char *reference; /* séquences : image précédente, lignes
+                                       entrelacées (NULL : image intra) */
+    size_t pas_reference;
+    const unsigned char *ramenes;   /* table de ramener_echantillons (NULL : PNM
+                                       de valeur maximale 255 ou plus) */
+} SourceLignes;
+
+/* Vrai si les lignes passent par le bloc de la source */
+static int source_par_bloc(const SourceLignes *source) {
+    return source->fichier || source->pas_plan || source->decorrelation || source->gros_boutiste ||
+           source->ramenes;
+}
+
+/* Bloc de lecture pris dans la zone des lignes (si les lignes ne peuvent
+ * pas être lues directement dans l'image) */
+static int preparer_source(SourceLignes *source, ZoneDIF *zone, size_t lignes_max) {
+    source->bloc = NULL;
+    if (!source_par_bloc(source)) return DIF_OK;
+    source->bloc = reserver_zone(zone, lignes_max * source->octets_ligne);
+    return source->bloc ? DIF_OK : DIF_ERR_ALLOC;
+}
+
+/* Ligne `ligne` de l'image en mémoire telle qu'encodée : ramenée à 255,
+ * entrelacée et décorrélée dans `tampon` si besoin, sinon prise dans l'image */
+static const unsigned char *preparer_ligne(const SourceLignes *source, int ligne, unsigned char *tampon) {
+    const NoyauxDIF *noyaux = noyaux_dif();
+    const unsigned char *pixels = source->pixels + (size_t)ligne * source->pas;
+    if (source->gros_boutiste) {
+        lire_gros_boutistes16(pixels, tampon, source->octets_ligne / 2);
+        return tampon;
+    }
+    if (source->ramenes) {
+        ramener_echantillons(pixels, tampon, source->octets_ligne, source->ramenes);
+        pixels = tampon;
+    }
+    if (source->pas_plan) {
+        const unsigned char *const plans[3] = { pixels, pixels + source->pas_plan,
+                                                pixels + 2 * source->pas_plan };
+        noyaux->entrelacer_plans(plans, source->octets_ligne / 3, tampon);
+        pixels = tampon;
+    }
+    if (source->decorrelation) {
+        noyaux->decorreler_couleurs(pixels, tampon, source->octets_ligne / 3, source->decalage);
+        pixels = tampon;
+    }
+    return pixels;
+}
+
+/* Accès aux `nb_lignes` lignes suivantes, à partir de la ligne `ligne` */
+static const unsigned char *lire_lignes(SourceLignes *source, int ligne, size_t nb_lignes, size_t *pas) {
+    if (!source_par_bloc(source)) {
+        *pas = source->pas;
+        return source->pixels + (size_t)ligne * source->pas;
+    }
+    *pas = source->octets_ligne;
+    if (source->fichier) {
+        if (fread(source->bloc, source->octets_ligne, nb_lignes, source->fichier) != nb_lignes)
+            return NULL;
+        if (source->gros_boutiste)
+            lire_gros_boutistes16(source->bloc, source->bloc, nb_lignes * source->octets_ligne / 2);
+        if (source->ramenes)
+            ramener_echantillons(source->bloc, source->bloc, nb_lignes * source->octets_ligne,
+                                 source->ramenes);
+        for (size_t i = 0; i < nb_lignes && source->decorrelation; i++) {
+            unsigned char *p = source->bloc + i * source->octets_ligne;
+            noyaux_dif()->decorreler_couleurs(p, p, source->octets_ligne / 3, source->decalage);
+        }
+        return source->bloc;
+    }
+    for (size_t i = 0; i < nb_lignes; i++) {
+        unsigned char *tampon = source->bloc + i * source->octets_ligne;
+        const unsigned char *p = preparer_ligne(source, ligne + (int)i, tampon);
+        if (p != tampon) memcpy(tampon, p, source->octets_ligne);
+    }
+    return source->bloc;
+}
+
+/* Lignes échantillonnées pour l'histogramme du quantificateur */
+#define DIF_PAS_HISTOGRAMME 4
+
+/* Histogrammes du quantificateur : valeurs repliées et, pour le mode
+ * plages, symboles et bits des longueurs de plage */
+typedef struct {
+    uint64_t valeurs[256];
+    uint64_t symboles[256];
+    uint64_t bits_longueurs;
+} HistogrammesDIF;
+
+/* Fin d'une plage dans les histogrammes du mode plages */
+static void compter_fin_plage(size_t plage, uint32_t symboles[256], uint64_t *bits_longueurs) {
+    while (plage) {
+        size_t longueur = plage < DIF_PLAGE_MAX ? plage : DIF_PLAGE_MAX;
+        if (longueur < DIF_PLAGE_MIN) {
+            symboles[1]++;
+        } else {
+            symboles[0]++;
+            *bits_longueurs += 2 * (32 - __builtin_clz((uint32_t)(longueur - DIF_PLAGE_MIN + 1))) - 1;
+        }
+        plage -= longueur;
+    }
+}
+
+/* Symboles du mode plages : une annonce par plage, les autres valeurs
+ * décalées de 1 */
+static void compter_plages(const uint8_t *replies, size_t n, size_t *plage,
+                           uint32_t symboles[256], uint64_t *bits_longueurs)
+{
+    for (size_t k = 0; k < n; k++) {
+        if (replies[k] == 0) {
+            (*plage)++;
+            continue;
+        }
+        if (*plage) compter_fin_plage(*plage, symboles, bits_longueurs);
+        *plage = 0;
+        symboles[replies[k] + 1]++;
+    }
+}
+
+/* Ajout des valeurs repliées d'une ligne (hors premier pixel, prédit par la
+ * ligne précédente) aux histogrammes ; résidus MED si `precedente` est
+ * fournie, écarts avec la ligne `reference` de l'image précédente (premier
+ * pixel compris) si elle l'est, symboles du mode plages en plus si
+ * `plages` est vrai */
+static void compter_replies(const unsigned char *ligne, const unsigned char *precedente,
+                            const unsigned char *reference, size_t taille, int nb_canaux,
+                            int decalage, int plages, HistogrammesDIF *histogrammes)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    uint8_t replies[DIF_SEGMENT];
+    uint32_t comptes[4][256], symboles[256];
+    memset(comptes, 0, sizeof comptes);
+    memset(symboles, 0, sizeof symboles);
+    size_t plage = 0;
+    for (size_t i = reference ? 0 : (size_t)nb_canaux; i < taille; ) {
+        size_t n = taille - i < DIF_SEGMENT ? taille - i : DIF_SEGMENT;
+        if (reference)
+            noyaux->replier_ecarts_temporels(ligne + i, reference + i, n, decalage, replies);
+        else if (precedente)
+            noyaux->replier_residus_med(ligne + i, precedente + i, n, nb_canaux, decalage, replies);
+        else
+            noyaux->replier_differences(ligne + i, n, nb_canaux, decalage, replies);
+        if (plages)
+            compter_plages(replies, n, &plage, symboles, &histogrammes->bits_longueurs);
+        size_t k = 0;
+        for (; k + 4 <= n; k += 4) {
+            comptes[0][replies[k]]++;
+            comptes[1][replies[k + 1]]++;
+            comptes[2][replies[k + 2]]++;
+            comptes[3][replies[k + 3]]++;
+        }
+        for (; k < n; k++)
+            comptes[0][replies[k]]++;
+        i += n;
+    }
+    compter_fin_plage(plage, symboles, &histogrammes->bits_longueurs);
+    for (int valeur = 0; valeur < 256; valeur++) {
+        histogrammes->valeurs[valeur] += (uint64_t)comptes[0][valeur] + comptes[1][valeur] +
+                                         comptes[2][valeur] + comptes[3][valeur];
+        histogrammes->symboles[valeur] += symboles[valeur];
+    }
+}
+
+/* Nombre de bits produits par une table, UINT64_MAX si elle ne couvre pas
+ * les nb_valeurs valeurs repliées ; cumul[v] = nombre de valeurs < v */
+static uint64_t cout_table(const uint64_t *cumul, unsigned int nb_valeurs, const uint8_t bits_niveaux[4]) {
+    static const int longueurs_prefixes[4] = {1, 2, 3, 3};
+    unsigned int debut = 0;
+    uint64_t cout = 0;
+    for (int niveau = 0; niveau < 4; niveau++) {
+        unsigned int fin = debut + (1U << bits_niveaux[niveau]);
+        cout += (uint64_t)(longueurs_prefixes[niveau] + bits_niveaux[niveau]) *
+                (cumul[fin < nb_valeurs ? fin : nb_valeurs] - cumul[debut < nb_valeurs ? debut : nb_valeurs]);
+        debut = fin;
+    }
+    return debut >= nb_valeurs ? cout : UINT64_MAX;
+}
+
+/* Table de coût minimal parmi les tables de 0 à bits_max bits par niveau ;
+ * à coût égal, la table reçue dans bits_niveaux est gardée */
+static uint64_t choisir_table(const uint64_t *cumul, unsigned int nb_valeurs, int bits_max,
+                              uint8_t bits_niveaux[4])
+{
+    int base = bits_max + 1;
+    uint64_t meilleur = cout_table(cumul, nb_valeurs, bits_niveaux);
+    for (int candidat = 0; candidat < base * base * base * base; candidat++) {
+        uint8_t essai[4] = { candidat % base, candidat / base % base, candidat / (base * base) % base,
+                             candidat / (base * base * base) };
+        uint64_t cout = cout_table(cumul, nb_valeurs, essai);
+        if (cout < meilleur) {
+            meilleur = cout;
+            memcpy(bits_niveaux, essai, 4);
+        }
+    }
+    return meilleur;
+}
+
+/* Histogramme cumulé des 256 valeurs repliées : cumul[v] = nombre de valeurs < v */
+static void cumuler_histogramme(const uint64_t histogramme[256], uint64_t cumul[257]) {
+    cumul[0] = 0;
+    for (int valeur = 0; valeur < 256; valeur++)
+        cumul[valeur + 1] = cumul[valeur] + histogramme[valeur];
+}
+
+/* Table à 4 niveaux de coût minimal pour l'histogramme, parmi les 9^4
+ * tables de 0 à 8 bits par niveau. Toutes les valeurs repliées restent
+ * codables : le dernier niveau absorbe les grands deltas. À coût égal, la
+ * table reçue dans bits_niveaux (la table historique) est gardée.
+ * Retourne le nombre de bits produits avec la table choisie. */
+static uint64_t choisir_bits_niveaux(const uint64_t histogramme[256], uint8_t bits_niveaux[4]) {
+    uint64_t cumul[257];
+    cumuler_histogramme(histogramme, cumul);
+    return choisir_table(cumul, 256, 8, bits_niveaux);
+}
+
+/* Quantificateur de l'image : adapté à l'histogramme des deltas quand les
+ * pixels sont accessibles avant l'encodage (mémoire ou projection), table
+ * historique sinon (lecture séquentielle) ou si l'appelant l'impose.
+ * Les lignes à transformer passent par deux lignes de la zone des lignes.
+ * Le mode plages est retiré de `modes` s'il ne réduit pas l'estimation, le
+ * mode Huffman faute d'histogramme ; sinon `longueurs` reçoit ses codes.
+ * Retourne le nombre de bits estimé avec la table retenue, UINT64_MAX sans
+ * histogramme ; une image de séquence est toujours estimée (choix de sa
+ * prédiction), même avec la table historique. */
+static uint64_t quantificateur_image(dif_context *contexte, const SourceLignes *source,
+                                     int hauteur, int nb_canaux, unsigned int *modes,
+                                     uint8_t bits_niveaux[4], uint8_t longueurs[256])
+{
+    memcpy(bits_niveaux, (uint8_t[4]){1, 2, 4, 8}, 4);
+    int fixe = contexte->options.quantificateur_fixe;
+    unsigned char *tampons = NULL;
+    if ((fixe && !source->reference) || source->fichier ||
+        (source_par_bloc(source) &&
+         !(tampons = reserver_zone(&contexte->lignes, 2 * source->octets_ligne)))) {
+        *modes &= ~DIF_MODE_HUFFMAN;
+        return UINT64_MAX;
+    }
+    HistogrammesDIF histogrammes;
+    memset(&histogrammes, 0, sizeof histogrammes);
+    int temporel = (*modes & DIF_OPTION_TEMPOREL) != 0;
+    int med = !temporel && (*modes & DIF_MODE_MED) && hauteur > 1;
+    int plages = (*modes & DIF_MODE_PLAGES) != 0;
+    for (int ligne = med; ligne < hauteur; ligne += DIF_PAS_HISTOGRAMME) {
+        const unsigned char *precedente = NULL;
+        if (med)
+            precedente = preparer_ligne(source, ligne - 1, tampons);
+        const unsigned char *courante = preparer_ligne(source, ligne,
+                                                       tampons ? tampons + source->octets_ligne : NULL);
+        compter_replies(courante, precedente,
+                        temporel ? source->reference + (size_t)ligne * source->pas_reference : NULL,
+                        source->octets_ligne, nb_canaux, decalage_modes(*modes), plages, &histogrammes);
+    }
+    if (fixe) {
+        uint64_t cumul[257];
+        *modes &= ~DIF_MODE_HUFFMAN;
+        cumuler_histogramme(plages ? histogrammes.symboles : histogrammes.valeurs, cumul);
+        return cout_table(cumul, 256, bits_niveaux) + (plages ? histogrammes.bits_longueurs : 0);
+    }
+    uint64_t cout = choisir_bits_niveaux(histogrammes.valeurs, bits_niveaux);
+    if (plages) {
+        uint8_t bits_plages[4] = {1, 2, 4, 8};
+        uint64_t cout_plages = choisir_bits_niveaux(histogrammes.symboles, bits_plages) +
+                               histogrammes.bits_longueurs;
+        if (cout_plages < cout) {
+            memcpy(bits_niveaux, bits_plages, 4);
+            cout = cout_plages;
+        } else {
+            *modes &= ~DIF_MODE_PLAGES;
+        }
+    }
+    if (*modes & DIF_MODE_HUFFMAN)
+        longueurs_huffman((*modes & DIF_MODE_PLAGES) ? histogrammes.symboles : histogrammes.valeurs,
+                          longueurs);
+    return cout;
+}
+
+/* Ajout des valeurs repliées sur 16 bits d'une ligne à l'histogramme,
+ * comme compter_replies */
+static void compter_replies16(const uint16_t *ligne, const uint16_t *precedente, const uint16_t *reference,
+                              size_t taille, int nb_canaux, int decalage, uint64_t *histogramme)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    uint16_t replies[DIF_SEGMENT];
+    for (size_t i = reference ? 0 : (size_t)nb_canaux; i < taille; ) {
+        size_t n = taille - i < DIF_SEGMENT ? taille - i : DIF_SEGMENT;
+        if (reference)
+            noyaux->replier_ecarts_temporels16(ligne + i, reference + i, n, decalage, replies);
+        else if (precedente)
+            noyaux->replier_residus_med16(ligne + i, precedente + i, n, nb_canaux, decalage, replies);
+        else
+            noyaux->replier_differences16(ligne + i, n, nb_canaux, decalage, replies);
+        for (size_t k = 0; k < n; k++)
+            histogramme[replies[k]]++;
+        i += n;
+    }
+}
+
+/* Quantificateur des échantillons sur 16 bits : table adaptée à
+ * l'histogramme des 65536 valeurs repliées, parmi les 17^4 tables de 0 à 16
+ * bits par niveau, mêmes lignes échantillonnées que sur 8 bits ; table
+ * {2, 4, 8, 16} en lecture séquentielle ou si l'appelant l'impose.
+ * Retourne l'estimation comme quantificateur_image. */
+static uint64_t quantificateur_image16(dif_context *contexte, const SourceLignes *source,
+                                       int hauteur, int nb_canaux, unsigned int modes,
+                                       uint8_t bits_niveaux[4])
+{
+    memcpy(bits_niveaux, (uint8_t[4]){2, 4, 8, 16}, 4);
+    int fixe = contexte->options.quantificateur_fixe;
+    unsigned char *tampons = NULL;
+    uint64_t *cumul = NULL;
+    if ((fixe && !source->reference) || source->fichier ||
+        (source_par_bloc(source) &&
+         !(tampons = reserver_zone(&contexte->lignes, 2 * source->octets_ligne))) ||
+        !(cumul = reserver_zone(&contexte->histogramme, (DIF_VALEURS16 + 1) * sizeof *cumul)))
+        return UINT64_MAX;
+    memset(cumul, 0, (DIF_VALEURS16 + 1) * sizeof *cumul);
+    int temporel = (modes & DIF_OPTION_TEMPOREL) != 0;
+    int med = !temporel && (modes & DIF_MODE_MED) && hauteur > 1;
+    for (int ligne = med; ligne < hauteur; ligne += DIF_PAS_HISTOGRAMME) {
+        const unsigned char *precedente = NULL;
+        if (med)
+            precedente = preparer_ligne(source, ligne - 1, tampons);
+        const unsigned char *courante = preparer_ligne(source, ligne,
+                                                       tampons ? tampons + source->octets_ligne : NULL);
+        const unsigned char *reference = temporel
+                                       ? source->reference + (size_t)ligne * source->pas_reference : NULL;
+        compter_replies16((const uint16_t *)courante, (const uint16_t *)precedente,
+                          (const uint16_t *)reference, source->octets_ligne / 2, nb_canaux,
+                          decalage_modes(modes), cumul + 1);
+    }
+    for (unsigned int valeur = 0; valeur < DIF_VALEURS16; valeur++)
+        cumul[valeur + 1] += cumul[valeur];
+    if (fixe) return cout_table(cumul, DIF_VALEURS16, bits_niveaux);
+    return choisir_table(cumul, DIF_VALEURS16, 16, bits_niveaux);
+}
+
+/* Écriture du fichier DIF classique (une seule chaîne de prédiction) avec
+ * le quantificateur déjà choisi */
+static int ecrire_classique(dif_context *contexte, SourceLignes *source, FluxBits *flux,
+                            int largeur, int hauteur, int nb_canaux, const uint8_t bits_par_niveau[4])
+{
+    size_t octets_ligne = (size_t)largeur * nb_canaux;
+    size_t lignes_par_bloc = DIF_TAILLE_BLOC / octets_ligne;
+    if (lignes_par_bloc == 0) lignes_par_bloc = 1;
+    const TableCodes *table = table_codes_contexte(contexte, bits_par_niveau);
+    int err = table ? preparer_source(source, &contexte->lignes, lignes_par_bloc) : DIF_ERR_FORMAT;
+    SortieSymboles symboles = { flux, 1, 0 };
+
+    unsigned char precedents[3];
+    for (int ligne = 0; ligne < hauteur && err == DIF_OK; ) {
+        size_t nb_lignes = (size_t)(hauteur - ligne) < lignes_par_bloc ? (size_t)(hauteur - ligne) : lignes_par_bloc;
+        size_t pas;
+        const unsigned char *lignes = lire_lignes(source, ligne, nb_lignes, &pas);
+        if (!lignes) {
+            err = DIF_ERR_IO;
+            break;
+        }
+        if (ligne == 0) {
+            for (int canal = 0; canal < nb_canaux; canal++)
+                precedents[canal] = lignes[canal] >> 1;
+            err = ecrire_entete_dif(flux, nb_canaux, (uint16_t)largeur, (uint16_t)hauteur,
+                                    bits_par_niveau, precedents);
+        }
+        if (err == DIF_OK)
+            err = encoder_lignes(&symboles, table, lignes, pas, nb_lignes, octets_ligne, nb_canaux,
+                                 precedents, ligne == 0, 0);
+        ligne += (int)nb_lignes;
+    }
+    if (err == DIF_OK)
+        err = finaliser_flux(flux);
+    return err;
+}
+
+/* Encodage du fichier DIF classique */
+static int encoder_classique(dif_context *contexte, SourceLignes *source, FluxBits *flux,
+                             int largeur, int hauteur, int nb_canaux)
+{
+    uint8_t bits_par_niveau[4];
+    unsigned int modes = 0;
+    quantificateur_image(contexte, source, hauteur, nb_canaux, &modes, bits_par_niveau, NULL);
+    return ecrire_classique(contexte, source, flux, largeur, hauteur, nb_canaux, bits_par_niveau);
+}
+
+/* Lignes produites par le décodage : image reconstruite et/ou image
+ * différentielle (NULL si non demandée), décodées en une seule passe */
+typedef struct {
+    unsigned char *image;
+    size_t pas_image;
+    unsigned char *differences;
+    size_t pas_differences;
+} SortiesLignes;
+
+/* Une vague de bandes traitées en parallèle */
+typedef struct {
+    const TableCodes *table_codes;
+    const TableVLC *table_vlc;
+    const Niveaux16 *niveaux;       /* échantillons sur 16 bits (tables NULL) */
+    int valeur_max;
+    unsigned char *lignes;          /* encodage : lignes de la vague, entrelacées */
+    size_t pas;                     /* octets entre deux lignes */
+    size_t octets_ligne;            /* octets d'une ligne de l'image */
+    int nb_canaux;
+    int hauteur_bande;
+    int nb_lignes;                  /* lignes de la vague */
+    unsigned int modes;             /* DIF_MODE_* de l'en-tête */
+    FluxBits *flux;                 /* encodage : un flux par bande */
+    FluxBits *sous_flux;            /* encodage en mode Huffman : DIF_SOUS_FLUX par bande */
+    const unsigned char *compresse; /* décodage : données de la vague */
+    const uint64_t *positions;      /* décodage : positions relatives au début de la vague */
+    SortiesLignes sorties;          /* décodage : lignes de la vague */
+    int *erreurs;                   /* une par bande : chaque tâche n'écrit que la sienne */
+    const unsigned char *reference; /* DIF_OPTION_TEMPOREL : lignes de la vague
+                                       dans l'image précédente */
+    size_t pas_reference;
+} VagueBandes;
+
+/* Première erreur des bandes d'une vague, lue après executer_pool */
+static int erreur_vague(const VagueBandes *vague, int nb_bandes) {
+    for (int i = 0; i < nb_bandes; i++)
+        if (vague->erreurs[i] != DIF_OK) return vague->erreurs[i];
+    return DIF_OK;
+}
+
+/* Sous-flux d'une bande en mode Huffman, taillés dans le tampon de la
+ * bande après les `debut` octets des pixels initiaux et la table des tailles */
+static void preparer_sous_flux(FluxBits *flux, size_t debut, size_t nb_echantillons,
+                               FluxBits sous_flux[DIF_SOUS_FLUX], SortieSymboles *symboles)
+{
+    size_t capacite = taille_max_sous_flux(nb_echantillons);
+    unsigned char *tampon = flux->buffer + debut + (DIF_SOUS_FLUX - 1) * sizeof(uint32_t);
+    for (int i = 0; i < DIF_SOUS_FLUX; i++) {
+        memset(&sous_flux[i], 0, sizeof sous_flux[i]);
+        sous_flux[i].buffer = tampon + i * capacite;
+        sous_flux[i].taille = capacite;
+    }
+    symboles->flux = sous_flux;
+    symboles->nb_flux = DIF_SOUS_FLUX;
+    symboles->courant = 0;
+}
+
+/* Finalisation des symboles d'une bande. En mode Huffman, la table des
+ * tailles des DIF_SOUS_FLUX - 1 premiers sous-flux (32 bits, ordre natif)
+ * suit les pixels initiaux ; les sous-flux restent en place, écrits à la
+ * suite par ecrire_bande. */
+static int finaliser_symboles(FluxBits *flux, SortieSymboles *symboles) {
+    if (symboles->nb_flux == 1) return finaliser_flux(flux);
+    uint32_t tailles[DIF_SOUS_FLUX - 1];
+    for (int i = 0; i < DIF_SOUS_FLUX; i++) {
+        FluxBits *sous_flux = &symboles->flux[i];
+        int err = finaliser_flux(sous_flux);
+        if (err != DIF_OK) return err;
+        if (i < DIF_SOUS_FLUX - 1) {
+            if (sous_flux->position > UINT32_MAX) return DIF_ERR_TAILLE;
+            tailles[i] = (uint32_t)sous_flux->position;
+        }
+    }
+    memcpy(flux->buffer + flux->position, tailles, sizeof tailles);
+    flux->position += sizeof tailles;
+    return DIF_OK;
+}
+
+/* Écriture d'une bande encodée : son flux, suivi de ses sous-flux en mode
+ * Huffman ; `taille` reçoit le nombre d'octets écrits */
+static int ecrire_bande(FluxBits *sortie, const VagueBandes *vague, int index, uint64_t *taille) {
+    const FluxBits *flux = &vague->flux[index];
+    int err = ecrire_octets(sortie, flux->buffer, flux->position);
+    *taille = flux->position;
+    if (!(vague->modes & DIF_MODE_HUFFMAN)) return err;
+    const FluxBits *sous_flux = vague->sous_flux + (size_t)index * DIF_SOUS_FLUX;
+    for (int i = 0; i < DIF_SOUS_FLUX && err == DIF_OK; i++) {
+        err = ecrire_octets(sortie, sous_flux[i].buffer, sous_flux[i].position);
+        *taille += sous_flux[i].position;
+    }
+    return err;
+}
+
+/* Tâche d'encodage d'une bande : pixels initiaux puis flux VLC aligné (flux
+ * seul pour une bande prédite par l'image précédente), ou sous-flux
+ * entrelacés en mode Huffman */
+static void encoder_bande(void *contexte, int index) {
+    VagueBandes *vague = contexte;
+    int premiere = index * vague->hauteur_bande;
+    int nb_lignes = vague->nb_lignes - premiere < vague->hauteur_bande
+                  ? vague->nb_lignes - premiere : vague->hauteur_bande;
+    const unsigned char *pixels = vague->lignes + (size_t)premiere * vague->pas;
+    FluxBits *flux = &vague->flux[index];
+    flux->position = 0;
+    flux->accumulateur = 0;
+    flux->bits_accumules = 0;
+    int temporel = (vague->modes & DIF_OPTION_TEMPOREL) != 0;
+    SortieSymboles symboles = { flux, 1, 0 };
+    if (vague->modes & DIF_MODE_HUFFMAN)
+        preparer_sous_flux(flux, temporel ? 0 : (size_t)vague->nb_canaux,
+                           vague->octets_ligne * (size_t)vague->hauteur_bande,
+                           vague->sous_flux + (size_t)index * DIF_SOUS_FLUX, &symboles);
+    int err;
+    if (temporel) {
+        err = encoder_lignes_temporelles(&symboles, vague->table_codes, pixels, vague->pas,
+                                         vague->reference + (size_t)premiere * vague->pas_reference,
+                                         vague->pas_reference, (size_t)nb_lignes, vague->octets_ligne,
+                                         vague->modes);
+    } else {
+        unsigned char premiers[3];
+        for (int canal = 0; canal < vague->nb_canaux; canal++)
+            premiers[canal] = pixels[canal] >> decalage_modes(vague->modes);
+        err = ecrire_octets(flux, premiers, vague->nb_canaux);
+        if (err == DIF_OK)
+            err = encoder_lignes(&symboles, vague->table_codes, pixels, vague->pas, (size_t)nb_lignes,
+                                 vague->octets_ligne, vague->nb_canaux, premiers, 1, vague->modes);
+    }
+    if (err == DIF_OK) err = finaliser_symboles(flux, &symboles);
+    vague->erreurs[index] = err;
+}
+
+/* Tâche d'encodage d'une bande d'échantillons sur 16 bits : pixels
+ * initiaux sur 2 octets (ordre natif, comme l'en-tête) puis flux VLC aligné */
+static void encoder_bande16(void *contexte, int index) {
+    VagueBandes *vague = contexte;
+    int premiere = index * vague->hauteur_bande;
+    int nb_lignes = vague->nb_lignes - premiere < vague->hauteur_bande
+                  ? vague->nb_lignes - premiere : vague->hauteur_bande;
+    const unsigned char *pixels = vague->lignes + (size_t)premiere * vague->pas;
+    FluxBits *flux = &vague->flux[index];
+    flux->position = 0;
+    flux->accumulateur = 0;
+    flux->bits_accumules = 0;
+    int err;
+    if (vague->modes & DIF_OPTION_TEMPOREL) {
+        err = encoder_lignes_temporelles16(flux, vague->niveaux, pixels, vague->pas,
+                                           vague->reference + (size_t)premiere * vague->pas_reference,
+                                           vague->pas_reference, (size_t)nb_lignes, vague->octets_ligne / 2,
+                                           vague->modes);
+    } else {
+        uint16_t premiers[3];
+        for (int canal = 0; canal < vague->nb_canaux; canal++)
+            premiers[canal] = ((const uint16_t *)pixels)[canal] >> decalage_modes(vague->modes);
+        err = ecrire_octets(flux, premiers, vague->nb_canaux * sizeof *premiers);
+        if (err == DIF_OK)
+            err = encoder_lignes16(flux, vague->niveaux, pixels, vague->pas, (size_t)nb_lignes,
+                                   vague->octets_ligne / 2, vague->nb_canaux, premiers, vague->modes);
+    }
+    if (err == DIF_OK) err = finaliser_flux(flux);
+    vague->erreurs[index] = err;
+}
+
+/* Écriture de l'en-tête étendu (la table des positions suit) */
+static int ecrire_entete_etendu(FluxBits *flux, const EnteteDIF *entete) {
+    uint16_t numero_magique = (entete->nb_canaux == 3) ? DIF_MAGIC_COLOR_EXT : DIF_MAGIC_GRAY_EXT;
+    uint8_t octets[TAILLE_ENTETE_ETENDU];
+    memcpy(octets + 0, &numero_magique, 2);
+    memcpy(octets + 2, &entete->largeur, 2);
+    memcpy(octets + 4, &entete->hauteur, 2);
+    octets[6] = entete->nb_niveaux;
+    memcpy(octets + 7, entete->bits_niveaux, 4);
+    octets[11] = entete->version;
+    octets[12] = entete->options;
+    memcpy(octets + 13, &entete->hauteur_bande, 2);
+    int err = ecrire_octets(flux, octets, sizeof octets);
+    if (err == DIF_OK && (entete->options & DIF_OPTION_16BITS))
+        err = ecrire_octets(flux, &entete->valeur_max, 2);
+    if (err != DIF_OK || !(entete->options & DIF_MODE_HUFFMAN)) return err;
+    uint8_t longueurs[DIF_TAILLE_LONGUEURS];
+    for (int i = 0; i < DIF_TAILLE_LONGUEURS; i++)
+        longueurs[i] = (uint8_t)(entete->longueurs[2 * i] | entete->longueurs[2 * i + 1] << 4);
+    return ecrire_octets(flux, longueurs, sizeof longueurs);
+}
+
+/* Taille de l'en-tête étendu, valeur maximale des échantillons sur 16 bits
+ * et longueurs des codes de Huffman comprises */
+static size_t taille_entete_etendu(const EnteteDIF *entete) {
+    return TAILLE_ENTETE_ETENDU + ((entete->options & DIF_OPTION_16BITS) ? 2 : 0) +
+           ((entete->options & DIF_MODE_HUFFMAN) ? DIF_TAILLE_LONGUEURS : 0);
+}
+
+/* Encodage en bandes indépendantes : chaque vague de bandes est encodée en
+ * parallèle, puis écrite dans l'ordre ; la table des positions est complétée
+ * à la fin. Avec l'image précédente d'une séquence, la prédiction temporelle
+ * remplace la prédiction intra si elle réduit l'estimation. Avec `repli`,
+ * une image dont aucun mode n'est retenu est écrite en fichier classique. */
+static int encoder_bandes(dif_context *contexte, SourceLignes *source, FluxBits *sortie,
+                          int largeur, int hauteur, int nb_canaux, int repli)
+{
+    const OptionsDIF *options = &contexte->options;
+    EnteteDIF entete = {0};
+    entete.nb_canaux = nb_canaux;
+    entete.largeur = (uint16_t)largeur;
+    entete.hauteur = (uint16_t)hauteur;
+    entete.nb_niveaux = 4;
+    entete.version = DIF_VERSION_ETENDUE;
+    entete.options = (uint8_t)options->modes;
+    entete.valeur_max = (uint16_t)source->valeur_max;
+    if (options->modes & ~DIF_MODES_CONNUS) return DIF_ERR_FORMAT;
+    if (nb_canaux == 1) entete.options &= ~DIF_MODE_DECORRELATION;
+    /* les 256 valeurs repliées du mode sans perte occupent tous les symboles */
+    if (entete.options & DIF_MODE_SANS_PERTE) entete.options &= ~DIF_MODE_PLAGES;
+    int seize_bits = source->valeur_max > 255;
+    if (seize_bits) entete.options = (entete.options & DIF_MODES_16BITS) | DIF_OPTION_16BITS;
+    source->decorrelation = (entete.options & DIF_MODE_DECORRELATION) != 0;
+    source->decalage = decalage_modes(entete.options);
+    unsigned int modes = entete.options;
+    uint64_t cout;
+    if (seize_bits)
+        cout = quantificateur_image16(contexte, source, hauteur, nb_canaux, modes, entete.bits_niveaux);
+    else
+        cout = quantificateur_image(contexte, source, hauteur, nb_canaux, &modes, entete.bits_niveaux,
+                                    entete.longueurs);
+    if (source->reference) {
+        unsigned int temporels = (entete.options & (DIF_MODES_TEMPORELS | DIF_OPTION_16BITS)) |
+                                 DIF_OPTION_TEMPOREL;
+        uint8_t bits_temporels[4], longueurs[256];
+        source->decorrelation = 0;
+        uint64_t cout_temporel = seize_bits
+            ? quantificateur_image16(contexte, source, hauteur, nb_canaux, temporels, bits_temporels)
+            : quantificateur_image(contexte, source, hauteur, nb_canaux, &temporels, bits_temporels,
+                                   longueurs);
+        if (cout_temporel < cout) {
+            modes = temporels;
+            memcpy(entete.bits_niveaux, bits_temporels, 4);
+            if (modes & DIF_MODE_HUFFMAN) memcpy(entete.longueurs, longueurs, sizeof longueurs);
+        } else {
+            source->decorrelation = (modes & DIF_MODE_DECORRELATION) != 0;
+        }
+    }
+    if (repli && !seize_bits && modes == 0)
+        return ecrire_classique(contexte, source, sortie, largeur, hauteur, nb_canaux,
+                                entete.bits_niveaux);
+    entete.options = (uint8_t)modes;
+    int hauteur_bande = options->hauteur_bande > 0 ? options->hauteur_bande : DIF_HAUTEUR_BANDE_MODES;
+    entete.hauteur_bande = (uint16_t)(hauteur_bande > 65535 ? 65535 : hauteur_bande);
+    entete.nb_bandes = (hauteur + entete.hauteur_bande - 1) / entete.hauteur_bande;
+    Niveaux16 niveaux;
+    const TableCodes *table = NULL;
+    if (seize_bits) {
+        if (preparer_niveaux16(&niveaux, entete.bits_niveaux) != DIF_OK) return DIF_ERR_FORMAT;
+    } else if (!(table = (entete.options & DIF_MODE_HUFFMAN)
+                       ? table_codes_huffman(contexte, entete.longueurs)
+                       : table_codes_contexte(contexte, entete.bits_niveaux)))
+        return DIF_ERR_ALLOC;
+    PoolThreads *pool = pool_contexte(contexte);
+    if (!pool) return DIF_ERR_ALLOC;
+
+    int bandes_par_vague = 2 * taille_pool(pool);
+    if ((uint32_t)bandes_par_vague > entete.nb_bandes) bandes_par_vague = (int)entete.nb_bandes;
+    size_t octets_premiers = nb_canaux * octets_echantillon(source->valeur_max);
+    size_t octets_ligne = (size_t)largeur * octets_premiers;
+    size_t capacite_bande = taille_max_bande(octets_premiers, octets_ligne * entete.hauteur_bande,
+                                             entete.options);
+    size_t taille_table = (entete.nb_bandes + 1) * sizeof(uint64_t);
+    uint64_t *positions = reserver_zone(&contexte->positions, taille_table);
+    FluxBits *flux = reserver_zone(&contexte->flux,
+                                   bandes_par_vague * (1 + DIF_SOUS_FLUX) * sizeof *flux);
+    unsigned char *compresse = reserver_zone(&contexte->bandes, bandes_par_vague * capacite_bande);
+    int *erreurs = reserver_zone(&contexte->erreurs, bandes_par_vague * sizeof *erreurs);
+    int err = (positions && flux && compresse && erreurs) ? DIF_OK : DIF_ERR_ALLOC;
+    if (err == DIF_OK) {
+        memset(positions, 0, taille_table);
+        for (int i = 0; i < bandes_par_vague; i++) {
+            memset(&flux[i], 0, sizeof flux[i]);
+            flux[i].buffer = compresse + i * capacite_bande;
+            flux[i].taille = capacite_bande;
+        }
+        err = preparer_source(source, &contexte->lignes, (size_t)bandes_par_vague * entete.hauteur_bande);
+    }
+
+    size_t debut = position_flux(sortie);
+    if (err == DIF_OK) err = ecrire_entete_etendu(sortie, &entete);
+    if (err == DIF_OK) err = ecrire_octets(sortie, positions, taille_table);
+
+    VagueBandes vague = { table, NULL, seize_bits ? &niveaux : NULL, entete.valeur_max, NULL, 0,
+                          octets_ligne, nb_canaux, entete.hauteur_bande, 0, entete.options, flux,
+                          flux + bandes_par_vague, NULL, NULL, {0}, erreurs, NULL,
+                          source->pas_reference };
+    uint32_t bande = 0;
+    for (int ligne = 0; ligne < hauteur && err == DIF_OK; ) {
+        int nb_lignes = hauteur - ligne;
+        if (nb_lignes > bandes_par_vague * entete.hauteur_bande)
+            nb_lignes = bandes_par_vague * entete.hauteur_bande;
+        vague.lignes = (unsigned char *)lire_lignes(source, ligne, (size_t)nb_lignes, &vague.pas);
+        if (!vague.lignes) {
+            err = DIF_ERR_IO;
+            break;
+        }
+        int nb_bandes = (nb_lignes + entete.hauteur_bande - 1) / entete.hauteur_bande;
+        vague.nb_lignes = nb_lignes;
+        if (entete.options & DIF_OPTION_TEMPOREL)
+            vague.reference = source->reference + (size_t)ligne * source->pas_reference;
+        executer_pool(pool, nb_bandes, seize_bits ? encoder_bande16 : encoder_bande, &vague);
+        err = erreur_vague(&vague, nb_bandes);
+        for (int i = 0; i < nb_bandes && err == DIF_OK; i++, bande++) {
+            uint64_t taille_bande;
+            err = ecrire_bande(sortie, &vague, i, &taille_bande);
+            positions[bande + 1] = positions[bande] + taille_bande;
+        }
+        ligne += nb_lignes;
+    }
+    if (err == DIF_OK) err = vider_flux(sortie);
+    if (err == DIF_OK)
+        err = reecrire_flux(sortie, debut + taille_entete_etendu(&entete), positions, taille_table);
+    return err;
+}
+
+/* Vrai si l'image est encodée en fichier étendu : bandes ou modes
+ * demandés, ou échantillons sur 16 bits */
+static int encodage_etendu(const dif_context *contexte, int valeur_max) {
+    return contexte->options.hauteur_bande > 0 || contexte->options.modes || valeur_max > 255;
+}
+
+/* Encodage d'une image (source en mémoire ou fichier) vers un flux DIF ;
+ * les échantillons sur 16 bits imposent le fichier étendu, les modes
+ * seulement s'il en reste un après le choix du quantificateur */
+static int encoder_image(dif_context *contexte, SourceLignes *source, FluxBits *sortie,
+                         int largeur, int hauteur, int nb_canaux)
+{
+    int err;
+    if (encodage_etendu(contexte, source->valeur_max))
+        err = encoder_bandes(contexte, source, sortie, largeur, hauteur, nb_canaux,
+                             contexte->options.hauteur_bande <= 0);
+    else
+        err = encoder_classique(contexte, source, sortie, largeur, hauteur, nb_canaux);
+    if (err == DIF_OK) err = vider_flux(sortie);
+    return err;
+}
+
+/* Vérification d'un format d'image fourni par l'appelant ; renvoie le pas
+ * effectif et l'écart entre deux plans (0 pour une image entrelacée).
+ * Les échantillons sur 16 bits (`octets` 2) sont entrelacés, pas pair. */
+static int verifier_format(const FormatImageDIF *format, int largeur, int hauteur, int nb_canaux,
+                           size_t octets, size_t *pas, size_t *pas_plan)
+{
+    if (largeur <= 0 || hauteur <= 0 || largeur > 65535 || hauteur > 65535 ||
+        (nb_canaux != 1 && nb_canaux != 3))
+        return DIF_ERR_FORMAT;
+    int plans = format->plans && nb_canaux == 3;
+    if (plans && octets > 1) return DIF_ERR_UNIMPLEMENTED;
+    size_t octets_ligne = (size_t)largeur * (plans ? 1 : nb_canaux) * octets;
+    *pas = format->pas ? format->pas : octets_ligne;
+    *pas_plan = plans ? *pas * hauteur : 0;
+    return *pas >= octets_ligne && *pas % octets == 0 ? DIF_OK : DIF_ERR_FORMAT;
+}
+
+/* Octets couverts par une image au format vérifié */
+static size_t taille_format(int largeur, int hauteur, int nb_canaux, size_t octets, size_t pas,
+                            size_t pas_plan)
+{
+    if (pas_plan)
+        return 2 * pas_plan + pas * (hauteur - 1u) + (size_t)largeur;
+    return pas * (hauteur - 1u) + (size_t)largeur * nb_canaux * octets;
+}
+
+/* Encodage d'une image en mémoire vers un tampon DIF, avec un contexte réutilisable */
+int dif_encode_mem_ctx(dif_context *contexte, const unsigned char *pixels,
+                       const FormatImageDIF *format, TamponDIF *sortie)
+{
+    size_t pas, pas_plan;
+    if (!pixels || !format || !sortie) return DIF_ERR_FORMAT;
+    sortie->taille = 0;
+    int valeur_max = format->valeur_max ? format->valeur_max : 255;
+    if (valeur_max < 255 || valeur_max > 65535) return DIF_ERR_FORMAT;
+    size_t octets = octets_echantillon(valeur_max);
+    int err = verifier_format(format, format->largeur, format->hauteur, format->nb_canaux, octets,
+                              &pas, &pas_plan);
+    if (err != DIF_OK) return err;
+    SourceLignes source = { NULL, pixels, pas, (size_t)format->largeur * format->nb_canaux * octets,
+                            pas_plan, 0, 1, valeur_max, 0, NULL, NULL, 0 };
+    FluxBits flux;
+    initialiser_flux_tampon(&flux, sortie);
+    err = encoder_image(contexte, &source, &flux, format->largeur, format->hauteur, format->nb_canaux);
+    if (err == DIF_OK) sortie->taille = flux.position;
+    return err;
+}
+
+/* Encodage d'une image en mémoire vers un tampon DIF */
+int dif_encode_mem(const unsigned char *pixels, const FormatImageDIF *format,
+                   TamponDIF *sortie, const OptionsDIF *options)
+{
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = dif_encode_mem_ctx(&contexte, pixels, format, sortie);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Encodage PNM binaire vers DIF avec un contexte réutilisable : les lignes
+ * sont encodées directement depuis la projection du fichier PNM ; une
+ * valeur maximale inférieure à 255 est ramenée à 255 bloc par bloc, dans
+ * la zone des lignes du contexte */
+int pnmtodif_ctx(dif_context *contexte, const char *chemin_pnm, const char *chemin_dif) {
+    SourceOctets entree;
+    if (ouvrir_source(&entree, chemin_pnm) != DIF_OK) return DIF_ERR_IO;
+    int largeur, hauteur, nb_canaux, valeur_max, ascii;
+    int err = lire_entete_pnm(&entree, &largeur, &hauteur, &nb_canaux, &valeur_max, &ascii);
+    if (err == DIF_OK && ascii) err = DIF_ERR_FORMAT;
+    if (err != DIF_OK) {
+        fermer_source(&entree);
+        return err;
+    }
+    size_t octets_ligne = (size_t)largeur * nb_canaux * octets_echantillon(valeur_max);
+    unsigned char table_ramenee[256];
+    SourceLignes source = { entree.fichier, NULL, octets_ligne, octets_ligne, 0, 0, 1, valeur_max,
+                            valeur_max > 255, NULL, NULL, 0, NULL };
+    if (valeur_max < 255) {
+        construire_table_ramenee(table_ramenee, valeur_max);
+        source.ramenes = table_ramenee;
+        source.valeur_max = 255;
+    }
+    if (!entree.fichier) {
+        if (entree.taille - entree.position < octets_ligne * hauteur) {
+            fermer_source(&entree);
+            return DIF_ERR_IO;
+        }
+        source.pixels = entree.donnees + entree.position;
+    }
+    FILE *fichier = ouvrir_sortie(chemin_dif);
+    if (!fichier) {
+        fermer_source(&entree);
+        return DIF_ERR_IO;
+    }
+    /* la table des positions du fichier étendu est réécrite à la fin : vers
+     * un tube ou la sortie standard, le fichier est encodé en mémoire puis
+     * écrit d'un bloc */
+    TamponDIF memoire = {0};
+    FluxBits flux;
+    if (encodage_etendu(contexte, source.valeur_max) &&
+        (chemin_standard(chemin_dif) || !sortie_positionnable(fichier))) {
+        initialiser_flux_tampon(&flux, &memoire);
+    } else {
+        err = initialiser_flux_ecriture(&flux, &contexte->fichier, DIF_TAILLE_TAMPON);
+        flux.fichier = fichier;
+    }
+    if (err == DIF_OK)
+        err = encoder_image(contexte, &source, &flux, largeur, hauteur, nb_canaux);
+    if (err == DIF_OK && flux.tampon && fwrite(memoire.donnees, 1, flux.position, fichier) != flux.position)
+        err = DIF_ERR_IO;
+    free(memoire.donnees);
+    fermer_source(&entree);
+    if (fermer_sortie(fichier, chemin_dif) != DIF_OK) err = DIF_ERR_IO;
+    if (err != DIF_OK) supprimer_sortie(chemin_dif);
+    return err;
+}
+
+/* Encodage PNM vers DIF avec options */
+int pnmtodif_options(const char *chemin_pnm, const char *chemin_dif, const OptionsDIF *options) {
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = pnmtodif_ctx(&contexte, chemin_pnm, chemin_dif);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Encodage PNM vers DIF : le raster est lu par blocs de lignes et le flux
+ * compressé est écrit dès que le tampon de sortie est plein */
+int pnmtodif(const char *chemin_pnm, const char *chemin_dif) {
+    OptionsDIF options;
+    options_dif_defaut(&options);
+    return pnmtodif_options(chemin_pnm, chemin_dif, &options);
+}
+
+/* Construction de la table de décodage VLC à partir des bits par niveau */
+int construire_table_vlc(TableVLC *table, const uint8_t bits_niveaux[4], int plages) {
+    unsigned int decalages[4];
+    decalages[0] = 0;
+    for (int niveau = 0; niveau < 4; niveau++) {
+        if (bits_niveaux[niveau] > 8) return DIF_ERR_FORMAT;
+        if (niveau > 0)
+            decalages[niveau] = decalages[niveau-1] + (1U << bits_niveaux[niveau-1]);
+    }
+    for (unsigned int index = 0; index < (1U << DIF_BITS_LUT); index++) {
+        int niveau, longueur_prefixe;
+        if (!(index >> (DIF_BITS_LUT - 1) & 1))      { niveau = 0; longueur_prefixe = 1; }
+        else if (!(index >> (DIF_BITS_LUT - 2) & 1)) { niveau = 1; longueur_prefixe = 2; }
+        else {
+            niveau = (index >> (DIF_BITS_LUT - 3) & 1) ? 3 : 2;
+            longueur_prefixe = 3;
+        }
+        int nb_bits = bits_niveaux[niveau];
+        unsigned int charge = (index >> (DIF_BITS_LUT - longueur_prefixe - nb_bits)) & ((1U << nb_bits) - 1);
+        EntreeVLC *entree = &table->entrees[index];
+        entree->niveau = (uint8_t)niveau;
+        entree->charge = (uint8_t)charge;
+        entree->longueur = (uint8_t)(longueur_prefixe + nb_bits);
+        entree->delta = delta_symbole(decalages[niveau] + charge, plages);
+    }
+    return DIF_OK;
+}
+
+/* Initialisation commune des lecteurs */
+static void preparer_lecteur(LecteurBits *lecteur, const unsigned char *donnees, size_t taille,
+                             FILE *fichier, unsigned char *bloc, size_t capacite)
+{
+    lecteur->donnees = donnees;
+    lecteur->taille = taille;
+    lecteur->position = 0;
+    lecteur->reservoir = 0;
+    lecteur->bits_disponibles = 0;
+    lecteur->octets_fantomes = 0;
+    lecteur->fichier = fichier;
+    lecteur->bloc = bloc;
+    lecteur->capacite = capacite;
+    recharger_lecteur(lecteur);
+}
+
+/* Initialisation du lecteur de bits sur un tampon complet */
+void initialiser_lecteur(LecteurBits *lecteur, const unsigned char *donnees, size_t taille) {
+    preparer_lecteur(lecteur, donnees, taille, NULL, NULL, 0);
+}
+
+/* Initialisation du lecteur de bits sur un fichier lu par blocs de `capacite` octets */
+void initialiser_lecteur_fichier(LecteurBits *lecteur, FILE *fichier,
+                                 unsigned char *bloc, size_t capacite)
+{
+    preparer_lecteur(lecteur, bloc, 0, fichier, bloc, capacite);
+}
+
+/* Lecture du bloc suivant : les octets non consommés sont ramenés au début */
+static void alimenter_lecteur(LecteurBits *lecteur) {
+    size_t restants = lecteur->taille - lecteur->position;
+    memmove(lecteur->bloc, lecteur->bloc + lecteur->position, restants);
+    size_t lus = fread(lecteur->bloc + restants, 1, lecteur->capacite - restants, lecteur->fichier);
+    if (lus == 0) lecteur->fichier = NULL;
+    lecteur->taille = restants + lus;
+    lecteur->position = 0;
+}
+
+/* Complément du réservoir par les 8 octets suivants, présents dans le tampon */
+static inline void charger_mot(LecteurBits *lecteur) {
+    const unsigned char *p = lecteur->donnees + lecteur->position;
+    uint64_t mot = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+                   ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+                   ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+                   ((uint64_t)p[6] << 8)  |  (uint64_t)p[7];
+    int octets = (63 - lecteur->bits_disponibles) >> 3;
+    lecteur->reservoir |= mot >> lecteur->bits_disponibles;
+    lecteur->position += octets;
+    lecteur->bits_disponibles += octets << 3;
+}
+
+/* Remplissage du réservoir (au moins 56 bits disponibles en sortie) */
+void recharger_lecteur(LecteurBits *lecteur) {
+    if (lecteur->position + 8 > lecteur->taille && lecteur->fichier)
+        alimenter_lecteur(lecteur);
+    if (lecteur->position + 8 <= lecteur->taille) {
+        charger_mot(lecteur);
+        return;
+    }
+    /* Fin du flux : octet par octet, puis des zéros comptés comme fantômes */
+    while (lecteur->bits_disponibles <= 56) {
+        uint64_t octet = 0;
+        if (lecteur->position < lecteur->taille)
+            octet = lecteur->donnees[lecteur->position++];
+        else
+            lecteur->octets_fantomes++;
+        lecteur->reservoir |= octet << (56 - lecteur->bits_disponibles);
+        lecteur->bits_disponibles += 8;
+    }
+}
+
+/* Lecture de l'en-tête DIF. Fichier classique : la source est laissée au
+ * début des données compressées, après les pixels initiaux. Fichier étendu :
+ * elle est laissée sur la table des positions des bandes. */
+static int lire_entete_dif(SourceOctets *source, EnteteDIF *entete) {
+    uint16_t num_magique;
+    uint8_t entete7[7];
+    if (!lire_octets(source, entete7, 7))
+        return DIF_ERR_FORMAT;
+    memcpy(&num_magique, entete7 + 0, 2);
+    memcpy(&entete->largeur, entete7 + 2, 2);
+    memcpy(&entete->hauteur, entete7 + 4, 2);
+    entete->nb_niveaux = entete7[6];
+    if (entete->nb_niveaux != 4)
+        return DIF_ERR_FORMAT;
+    if (!lire_octets(source, entete->bits_niveaux, entete->nb_niveaux))
+        return DIF_ERR_FORMAT;
+    entete->version = 0;
+    entete->options = 0;
+    entete->hauteur_bande = 0;
+    entete->nb_bandes = 0;
+    entete->valeur_max = 255;
+    memset(entete->pixels_initiaux, 0, sizeof entete->pixels_initiaux);
+    if (num_magique == DIF_MAGIC_GRAY) entete->nb_canaux = 1;
+    else if (num_magique == DIF_MAGIC_COLOR) entete->nb_canaux = 3;
+    else if (num_magique == DIF_MAGIC_GRAY_EXT || num_magique == DIF_MAGIC_COLOR_EXT) {
+        entete->nb_canaux = (num_magique == DIF_MAGIC_COLOR_EXT) ? 3 : 1;
+        uint8_t suite[4];
+        if (!lire_octets(source, suite, 4))
+            return DIF_ERR_FORMAT;
+        entete->version = suite[0];
+        entete->options = suite[1];
+        memcpy(&entete->hauteur_bande, suite + 2, 2);
+        if (entete->version != DIF_VERSION_ETENDUE ||
+            (entete->options & ~(DIF_MODES_CONNUS | DIF_OPTION_16BITS | DIF_OPTION_TEMPOREL)) ||
+            ((entete->options & DIF_OPTION_TEMPOREL) &&
+             (entete->options & (DIF_MODE_MED | DIF_MODE_DECORRELATION))) ||
+            entete->hauteur_bande == 0 ||
+            (entete->nb_canaux == 1 && (entete->options & DIF_MODE_DECORRELATION)) ||
+            ((entete->options & DIF_MODE_SANS_PERTE) && (entete->options & DIF_MODE_PLAGES)))
+            return DIF_ERR_FORMAT;
+        if (entete->options & DIF_OPTION_16BITS) {
+            if ((entete->options & ~(DIF_MODES_16BITS | DIF_OPTION_16BITS | DIF_OPTION_TEMPOREL)) ||
+                !lire_octets(source, &entete->valeur_max, 2) || entete->valeur_max < 256)
+                return DIF_ERR_FORMAT;
+        }
+        entete->nb_bandes = (entete->hauteur + entete->hauteur_bande - 1u) / entete->hauteur_bande;
+        uint8_t longueurs[DIF_TAILLE_LONGUEURS];
+        if (entete->options & DIF_MODE_HUFFMAN) {
+            if (!lire_octets(source, longueurs, sizeof longueurs))
+                return DIF_ERR_FORMAT;
+            for (int i = 0; i < DIF_TAILLE_LONGUEURS; i++) {
+                entete->longueurs[2 * i] = longueurs[i] & 15;
+                entete->longueurs[2 * i + 1] = longueurs[i] >> 4;
+            }
+        }
+    }
+    else
+        return DIF_ERR_FORMAT;
+    if (entete->largeur == 0 || entete->hauteur == 0)
+        return DIF_ERR_FORMAT;
+    if (entete->version == 0 &&
+        !lire_octets(source, entete->pixels_initiaux, entete->nb_canaux))
+        return DIF_ERR_FORMAT;
+    return DIF_OK;
+}
+
+/* Décodeur DIF en flux : en-tête, table VLC (ou niveaux des échantillons
+ * sur 16 bits) et lecteur sur la source (ou table des positions des bandes
+ * pour un fichier étendu). Une image de séquence prédite par la précédente
+ * (DIF_OPTION_TEMPOREL) se décode avec les lignes de celle-ci. */
+typedef struct {
+    SourceOctets source;
+    EnteteDIF entete;
+    const TableVLC *table;
+    Niveaux16 niveaux;
+    LecteurBits lecteur;
+    const uint64_t *positions;
+    const unsigned char *reference;
+    size_t pas_reference;
+} DecodeurDIF;
+
+/* Table de décodage de Huffman, propre à chaque image (remplace la table du
+ * contexte) */
+static const TableVLC *table_vlc_huffman(dif_context *contexte, const uint8_t longueurs[256],
+                                         int plages)
+{
+    contexte->vlc_pret = 0;
+    if (construire_table_vlc_huffman(&contexte->vlc, longueurs, plages) != DIF_OK) return NULL;
+    return &contexte->vlc;
+}
+
+/* Table de décodage du contexte, reconstruite seulement si le quantificateur change */
+static const TableVLC *table_vlc_contexte(dif_context *contexte, const uint8_t bits_niveaux[4],
+                                         int plages)
+{
+    if (!contexte->vlc_pret || memcmp(contexte->bits_vlc, bits_niveaux, 4) != 0 ||
+        contexte->plages_vlc != plages) {
+        contexte->vlc_pret = 0;
+        if (construire_table_vlc(&contexte->vlc, bits_niveaux, plages) != DIF_OK) return NULL;
+        memcpy(contexte->bits_vlc, bits_niveaux, 4);
+        contexte->plages_vlc = plages;
+        contexte->vlc_pret = 1;
+    }
+    return &contexte->vlc;
+}
+
+/* Ouverture d'un décodeur sur sa source (fichier ou mémoire) */
+static int ouvrir_decodeur(dif_context *contexte, DecodeurDIF *dec) {
+    dec->positions = NULL;
+    dec->table = NULL;
+    dec->reference = NULL;
+    dec->pas_reference = 0;
+    int err = lire_entete_dif(&dec->source, &dec->entete);
+    int plages = (dec->entete.options & DIF_MODE_PLAGES) != 0;
+    if (err == DIF_OK && (dec->entete.options & DIF_OPTION_16BITS))
+        err = preparer_niveaux16(&dec->niveaux, dec->entete.bits_niveaux);
+    else if (err == DIF_OK &&
+             !(dec->table = (dec->entete.options & DIF_MODE_HUFFMAN)
+                          ? table_vlc_huffman(contexte, dec->entete.longueurs, plages)
+                          : table_vlc_contexte(contexte, dec->entete.bits_niveaux, plages)))
+        err = DIF_ERR_FORMAT;
+    size_t octets_premiers = dec->entete.nb_canaux * octets_echantillon(dec->entete.valeur_max);
+    if (err == DIF_OK && dec->entete.nb_bandes) {
+        /* positions croissantes, chaque bande bornée par sa taille maximale */
+        size_t nb = dec->entete.nb_bandes + 1u;
+        size_t octets_bande = (size_t)dec->entete.largeur * octets_premiers * dec->entete.hauteur_bande;
+        uint64_t *positions = reserver_zone(&contexte->positions, nb * sizeof *positions);
+        if (!positions)
+            err = DIF_ERR_ALLOC;
+        else if (!lire_octets(&dec->source, positions, nb * sizeof *positions))
+            err = DIF_ERR_FORMAT;
+        for (size_t i = 1; err == DIF_OK && i < nb; i++)
+            if (positions[i] < positions[i - 1] ||
+                positions[i] - positions[i - 1] > taille_max_bande(octets_premiers, octets_bande,
+                                                                   dec->entete.options))
+                err = DIF_ERR_FORMAT;
+        if (err == DIF_OK && positions[0] != 0)
+            err = DIF_ERR_FORMAT;
+        dec->positions = positions;
+    }
+    else if (err == DIF_OK && dec->source.fichier) {
+        unsigned char *bloc = reserver_zone(&contexte->fichier, DIF_TAILLE_TAMPON);
+        if (bloc)
+            initialiser_lecteur_fichier(&dec->lecteur, dec->source.fichier, bloc, DIF_TAILLE_TAMPON);
+        else
+            err = DIF_ERR_ALLOC;
+    }
+    else if (err == DIF_OK)
+        initialiser_lecteur(&dec->lecteur, dec->source.donnees + dec->source.position,
+                            dec->source.taille - dec->source.position);
+    return err;
+}
+
+/* Restauration d'un échantillon : limitation à [0,255] puis multiplication par 2 */
+static inline unsigned char restaurer(int valeur) {
+    if (valeur <= 0) return 0;
+    if (valeur >= 128) return 255;
+    return (unsigned char)(valeur << 1);
+}
+
+/* Échantillons décodés par lot : la lecture des symboles reste séquentielle,
+ * la restauration et la visualisation passent par les noyaux vectoriels.
+ * Multiple de 3 pour garder les canaux alignés d'un lot à l'autre. */
+#define DIF_LOT_DECODAGE 1536
+
+/* Restauration d'un lot de valeurs : 2v limité à [0,255], ou v modulo 256
+ * en mode sans perte (`decalage` nul) */
+typedef void (*RestaurationLot)(const int32_t *valeurs, uint8_t *sortie, size_t n);
+
+static RestaurationLot restauration_lot(int decalage) {
+    const NoyauxDIF *noyaux = noyaux_dif();
+    return decalage ? noyaux->restaurer_valeurs : noyaux->tronquer_valeurs;
+}
+
+/* En mode sans perte, les prédictions reportées au lot suivant sont
+ * ramenées modulo 256 (les sommes ne débordent pas au sein d'un lot) */
+static inline void ramener_precedents(int precedents[3], int nb_canaux, int decalage) {
+    if (decalage) return;
+    for (int canal = 0; canal < nb_canaux; canal++)
+        precedents[canal] &= 0xFF;
+}
+
+/* Décodage de `taille` échantillons entrelacés ; `precedents` porte la
+ * prédiction de chaque canal d'un appel à l'autre */
+static void decoder_echantillons(LecteurBits *lecteur, const TableVLC *table,
+                                 unsigned char *sortie, size_t taille,
+                                 int nb_canaux, int precedents[3], int decalage)
+{
+    RestaurationLot restaurer_lot = restauration_lot(decalage);
+    int32_t valeurs[DIF_LOT_DECODAGE];
+    for (size_t debut = 0; debut < taille; debut += DIF_LOT_DECODAGE) {
+        size_t n = taille - debut < DIF_LOT_DECODAGE ? taille - debut : DIF_LOT_DECODAGE;
+        if (nb_canaux == 1) {
+            int32_t valeur = precedents[0];
+            for (size_t i = 0; i < n; i++) {
+                valeur += lire_symbole(lecteur, table)->delta;
+                valeurs[i] = valeur;
+            }
+            precedents[0] = valeur;
+        } else {
+            for (size_t i = 0; i < n; i += 3)
+                for (int canal = 0; canal < 3; canal++) {
+                    precedents[canal] += lire_symbole(lecteur, table)->delta;
+                    valeurs[i + canal] = precedents[canal];
+                }
+        }
+        ramener_precedents(precedents, nb_canaux, decalage);
+        restaurer_lot(valeurs, sortie + debut, n);
+    }
+}
+
+/* Décodage de `taille` deltas vers l'image différentielle (blanc pour un
+ * delta nul, plus sombre quand il grandit) */
+static void decoder_differences(LecteurBits *lecteur, const TableVLC *table,
+                                unsigned char *sortie, size_t taille)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    int8_t deltas[DIF_LOT_DECODAGE];
+    for (size_t debut = 0; debut < taille; debut += DIF_LOT_DECODAGE) {
+        size_t n = taille - debut < DIF_LOT_DECODAGE ? taille - debut : DIF_LOT_DECODAGE;
+        for (size_t i = 0; i < n; i++)
+            deltas[i] = lire_symbole(lecteur, table)->delta;
+        noyaux->visualiser_deltas(deltas, sortie + debut, n);
+    }
+}
+
+/* Décodage de `taille` échantillons vers les deux images à la fois :
+ * chaque symbole n'est lu qu'une fois */
+static void decoder_image_et_differences(LecteurBits *lecteur, const TableVLC *table,
+                                         unsigned char *sortie, unsigned char *differences,
+                                         size_t taille, int nb_canaux, int precedents[3],
+                                         int decalage)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    RestaurationLot restaurer_lot = restauration_lot(decalage);
+    int32_t valeurs[DIF_LOT_DECODAGE];
+    int8_t deltas[DIF_LOT_DECODAGE];
+    for (size_t debut = 0; debut < taille; debut += DIF_LOT_DECODAGE) {
+        size_t n = taille - debut < DIF_LOT_DECODAGE ? taille - debut : DIF_LOT_DECODAGE;
+        if (nb_canaux == 1) {
+            int32_t valeur = precedents[0];
+            for (size_t i = 0; i < n; i++) {
+                deltas[i] = lire_symbole(lecteur, table)->delta;
+                valeur += deltas[i];
+                valeurs[i] = valeur;
+            }
+            precedents[0] = valeur;
+        } else {
+            for (size_t i = 0; i < n; i += 3)
+                for (int canal = 0; canal < 3; canal++) {
+                    deltas[i + canal] = lire_symbole(lecteur, table)->delta;
+                    precedents[canal] += deltas[i + canal];
+                    valeurs[i + canal] = precedents[canal];
+                }
+        }
+        ramener_precedents(precedents, nb_canaux, decalage);
+        restaurer_lot(valeurs, sortie + debut, n);
+        noyaux->visualiser_deltas(deltas, differences + debut, n);
+    }
+}
+
+/* Longueur d'une plage de zéros (Exp-Golomb d'ordre 0, 31 bits au plus) */
+static inline size_t lire_longueur_plage(LecteurBits *lecteur) {
+    if (lecteur->bits_disponibles < 32)
+        recharger_lecteur(lecteur);
+    int zeros = __builtin_clzll(lecteur->reservoir | 1);
+    if (zeros > 15) zeros = 15;
+    int longueur = 2 * zeros + 1;
+    size_t valeur = (size_t)(lecteur->reservoir >> (64 - longueur));
+    lecteur->reservoir <<= longueur;
+    lecteur->bits_disponibles -= longueur;
+    return valeur - 1 + DIF_PLAGE_MIN;
+}
+
+/* Lecture de `n` deltas en mode plages : les plages sont remplies d'un bloc.
+ * `plage` est le reste de la plage en cours, retourné mis à jour. */
+static size_t lire_deltas_plages(LecteurBits *lecteur, const TableVLC *table,
+                                 int8_t *deltas, size_t n, size_t plage)
+{
+    size_t i = 0;
+    while (i < n) {
+        if (plage) {
+            size_t nombre = plage < n - i ? plage : n - i;
+            memset(deltas + i, 0, nombre);
+            i += nombre;
+            plage -= nombre;
+            continue;
+        }
+        int8_t delta = lire_symbole(lecteur, table)->delta;
+        if (delta == DIF_DELTA_PLAGE)
+            plage = lire_longueur_plage(lecteur);
+        else
+            deltas[i++] = delta;
+    }
+    return plage;
+}
+
+/* Sous-flux d'une bande en mode Huffman, lus à tour de rôle (un symbole,
+ * et la longueur d'une plage qu'il annonce, par sous-flux) */
+typedef struct {
+    LecteurBits lecteurs[DIF_SOUS_FLUX];
+    unsigned int courant;   /* sous-flux du prochain symbole */
+} LecteursEntrelaces;
+
+/* Remplissage de chaque sous-flux, sans test du nombre de bits : 56 bits
+ * garantis, soit 4 symboles par sous-flux */
+static inline void remplir_sous_flux(LecteurBits lecteurs[DIF_SOUS_FLUX]) {
+    for (int k = 0; k < DIF_SOUS_FLUX; k++) {
+        if (lecteurs[k].position + 8 <= lecteurs[k].taille)
+            charger_mot(&lecteurs[k]);
+        else
+            recharger_lecteur(&lecteurs[k]);
+    }
+}
+
+/* Tours complets (un symbole par sous-flux) sans annonce de plage, lus
+ * comme sans plages, 4 tours par remplissage ; arrêt avant le premier tour
+ * qui en contient une. Retourne le nombre de deltas lus. */
+static size_t lire_tours_sans_plage(LecteurBits lecteurs[DIF_SOUS_FLUX], const TableVLC *table,
+                                    int8_t *deltas, size_t n)
+{
+    size_t i = 0;
+    while (i + DIF_SOUS_FLUX <= n) {
+        remplir_sous_flux(lecteurs);
+        uint64_t r0 = lecteurs[0].reservoir, r1 = lecteurs[1].reservoir;
+        uint64_t r2 = lecteurs[2].reservoir, r3 = lecteurs[3].reservoir;
+        int u0 = 0, u1 = 0, u2 = 0, u3 = 0;
+        int tours = 0;
+        for (; tours < 4 && i + DIF_SOUS_FLUX <= n; tours++, i += DIF_SOUS_FLUX) {
+            const EntreeVLC *e0 = &table->entrees[r0 >> (64 - DIF_BITS_LUT)];
+            const EntreeVLC *e1 = &table->entrees[r1 >> (64 - DIF_BITS_LUT)];
+            const EntreeVLC *e2 = &table->entrees[r2 >> (64 - DIF_BITS_LUT)];
+            const EntreeVLC *e3 = &table->entrees[r3 >> (64 - DIF_BITS_LUT)];
+            if ((e0->delta == DIF_DELTA_PLAGE) | (e1->delta == DIF_DELTA_PLAGE) |
+                (e2->delta == DIF_DELTA_PLAGE) | (e3->delta == DIF_DELTA_PLAGE))
+                break;
+            r0 <<= e0->longueur;
+            r1 <<= e1->longueur;
+            r2 <<= e2->longueur;
+            r3 <<= e3->longueur;
+            u0 += e0->longueur;
+            u1 += e1->longueur;
+            u2 += e2->longueur;
+            u3 += e3->longueur;
+            deltas[i] = e0->delta;
+            deltas[i + 1] = e1->delta;
+            deltas[i + 2] = e2->delta;
+            deltas[i + 3] = e3->delta;
+        }
+        lecteurs[0].reservoir = r0;
+        lecteurs[1].reservoir = r1;
+        lecteurs[2].reservoir = r2;
+        lecteurs[3].reservoir = r3;
+        lecteurs[0].bits_disponibles -= u0;
+        lecteurs[1].bits_disponibles -= u1;
+        lecteurs[2].bits_disponibles -= u2;
+        lecteurs[3].bits_disponibles -= u3;
+        if (tours < 4) break;
+    }
+    return i;
+}
+
+/* Lecture de `n` deltas dans les sous-flux entrelacés, plages comprises
+ * (`plage` comme pour lire_deltas_plages). Chaque tour de boucle lit un
+ * symbole dans chacun des sous-flux (déroulé pour DIF_SOUS_FLUX = 4) : les
+ * quatre lectures sont indépendantes. En mode plages, les tours qui
+ * annoncent une plage sont lus symbole par symbole. */
+static size_t lire_deltas_entrelaces(LecteursEntrelaces *sous_flux, const TableVLC *table,
+                                     int8_t *deltas, size_t n, size_t plage, int plages)
+{
+    LecteurBits *lecteurs = sous_flux->lecteurs;
+    size_t i = 0;
+    if (!plages) {
+        for (; i < n && sous_flux->courant; i++) {
+            deltas[i] = lire_symbole(&lecteurs[sous_flux->courant], table)->delta;
+            sous_flux->courant = (sous_flux->courant + 1) % DIF_SOUS_FLUX;
+        }
+        /* 4 symboles par sous-flux et par remplissage ; les réservoirs
+         * restent dans des variables locales (les écritures d'octets dans
+         * `deltas` pourraient sinon modifier les lecteurs) */
+        for (; i + 4 * DIF_SOUS_FLUX <= n; i += 4 * DIF_SOUS_FLUX) {
+            remplir_sous_flux(lecteurs);
+            uint64_t r0 = lecteurs[0].reservoir, r1 = lecteurs[1].reservoir;
+            uint64_t r2 = lecteurs[2].reservoir, r3 = lecteurs[3].reservoir;
+            int u0 = 0, u1 = 0, u2 = 0, u3 = 0;
+            for (size_t j = i; j < i + 4 * DIF_SOUS_FLUX; j += DIF_SOUS_FLUX) {
+                const EntreeVLC *e0 = &table->entrees[r0 >> (64 - DIF_BITS_LUT)];
+                const EntreeVLC *e1 = &table->entrees[r1 >> (64 - DIF_BITS_LUT)];
+                const EntreeVLC *e2 = &table->entrees[r2 >> (64 - DIF_BITS_LUT)];
+                const EntreeVLC *e3 = &table->entrees[r3 >> (64 - DIF_BITS_LUT)];
+                r0 <<= e0->longueur;
+                r1 <<= e1->longueur;
+                r2 <<= e2->longueur;
+                r3 <<= e3->longueur;
+                u0 += e0->longueur;
+                u1 += e1->longueur;
+                u2 += e2->longueur;
+                u3 += e3->longueur;
+                deltas[j] = e0->delta;
+                deltas[j + 1] = e1->delta;
+                deltas[j + 2] = e2->delta;
+                deltas[j + 3] = e3->delta;
+            }
+            lecteurs[0].reservoir = r0;
+            lecteurs[1].reservoir = r1;
+            lecteurs[2].reservoir = r2;
+            lecteurs[3].reservoir = r3;
+            lecteurs[0].bits_disponibles -= u0;
+            lecteurs[1].bits_disponibles -= u1;
+            lecteurs[2].bits_disponibles -= u2;
+            lecteurs[3].bits_disponibles -= u3;
+        }
+        for (; i < n; i++) {
+            deltas[i] = lire_symbole(&lecteurs[sous_flux->courant], table)->delta;
+            sous_flux->courant = (sous_flux->courant + 1) % DIF_SOUS_FLUX;
+        }
+        return 0;
+    }
+    unsigned int courant = sous_flux->courant;
+    while (i < n) {
+        if (plage) {
+            size_t nombre = plage < n - i ? plage : n - i;
+            memset(deltas + i, 0, nombre);
+            i += nombre;
+            plage -= nombre;
+            continue;
+        }
+        if (courant == 0) {
+            i += lire_tours_sans_plage(lecteurs, table, deltas + i, n - i);
+            if (i == n) break;
+        }
+        LecteurBits *lecteur = &lecteurs[courant];
+        courant = (courant + 1) % DIF_SOUS_FLUX;
+        int8_t delta = lire_symbole(lecteur, table)->delta;
+        if (delta == DIF_DELTA_PLAGE)
+            plage = lire_longueur_plage(lecteur);
+        else
+            deltas[i++] = delta;
+    }
+    sous_flux->courant = courant;
+    return plage;
+}
+
+/* Décodage de `taille` échantillons d'une ligne prédite horizontalement,
+ * depuis les sous-flux entrelacés : les deltas de chaque lot sont lus
+ * d'abord, puis cumulés par canal (sortie ou differences peut être NULL) */
+static void decoder_ligne_entrelacee(LecteursEntrelaces *sous_flux, const TableVLC *table,
+                                     unsigned char *sortie, unsigned char *differences, size_t taille,
+                                     int nb_canaux, int precedents[3], int plages, int decalage)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    RestaurationLot restaurer_lot = restauration_lot(decalage);
+    int32_t valeurs[DIF_LOT_DECODAGE];
+    int8_t deltas[DIF_LOT_DECODAGE];
+    size_t plage = 0;
+    for (size_t debut = 0; debut < taille; debut += DIF_LOT_DECODAGE) {
+        size_t n = taille - debut < DIF_LOT_DECODAGE ? taille - debut : DIF_LOT_DECODAGE;
+        plage = lire_deltas_entrelaces(sous_flux, table, deltas, n, plage, plages);
+        if (sortie) {
+            if (nb_canaux == 1) {
+                int32_t valeur = precedents[0];
+                for (size_t i = 0; i < n; i++) {
+                    valeur += deltas[i];
+                    valeurs[i] = valeur;
+                }
+                precedents[0] = valeur;
+            } else {
+                int rouge = precedents[0], vert = precedents[1], bleu = precedents[2];
+                for (size_t i = 0; i < n; i += 3) {
+                    valeurs[i] = rouge += deltas[i];
+                    valeurs[i + 1] = vert += deltas[i + 1];
+                    valeurs[i + 2] = bleu += deltas[i + 2];
+                }
+                precedents[0] = rouge;
+                precedents[1] = vert;
+                precedents[2] = bleu;
+            }
+            ramener_precedents(precedents, nb_canaux, decalage);
+            restaurer_lot(valeurs, sortie + debut, n);
+        }
+        if (differences) noyaux->visualiser_deltas(deltas, differences + debut, n);
+    }
+}
+
+/* Décodage de `taille` échantillons d'une ligne en mode plages vers l'image
+ * et/ou l'image différentielle (NULL si non demandée) : une plage recopie
+ * d'un bloc la dernière valeur de chaque canal */
+static void decoder_ligne_plages(LecteurBits *lecteur, const TableVLC *table, unsigned char *sortie,
+                                 unsigned char *differences, size_t taille, int nb_canaux,
+                                 int precedents[3])
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    int32_t valeurs[DIF_LOT_DECODAGE];
+    int8_t deltas[DIF_LOT_DECODAGE];
+    size_t plage = 0;
+    int canal = 0;
+    for (size_t debut = 0; debut < taille; debut += DIF_LOT_DECODAGE) {
+        size_t n = taille - debut < DIF_LOT_DECODAGE ? taille - debut : DIF_LOT_DECODAGE;
+        size_t i = 0;
+        while (i < n) {
+            if (plage) {
+                size_t nombre = plage < n - i ? plage : n - i;
+                memset(deltas + i, 0, nombre);
+                if (nb_canaux == 1) {
+                    for (size_t k = 0; k < nombre; k++)
+                        valeurs[i + k] = precedents[0];
+                } else {
+                    for (size_t k = 0; k < nombre; k++) {
+                        valeurs[i + k] = precedents[canal];
+                        if (++canal == nb_canaux) canal = 0;
+                    }
+                }
+                i += nombre;
+                plage -= nombre;
+                continue;
+            }
+            int8_t delta = lire_symbole(lecteur, table)->delta;
+            if (delta == DIF_DELTA_PLAGE) {
+                plage = lire_longueur_plage(lecteur);
+                continue;
+            }
+            deltas[i] = delta;
+            precedents[canal] += delta;
+            valeurs[i++] = precedents[canal];
+            if (++canal == nb_canaux) canal = 0;
+        }
+        if (sortie) noyaux->restaurer_valeurs(valeurs, sortie + debut, n);
+        if (differences) noyaux->visualiser_deltas(deltas, differences + debut, n);
+    }
+}
+
+/* Prédicteur MED (LOCO-I) sur échantillons réduits ou entiers */
+static inline int predire_med(int gauche, int haut, int haut_gauche) {
+    int minimum = gauche < haut ? gauche : haut;
+    int maximum = gauche < haut ? haut : gauche;
+    if (haut_gauche >= maximum) return minimum;
+    if (haut_gauche <= minimum) return maximum;
+    return gauche + haut - haut_gauche;
+}
+
+/* Décodage d'une ligne complète en mode MED : le voisinage du haut est relu
+ * dans la ligne `precedente` déjà restaurée de l'image (seul contexte
+ * nécessaire), le premier pixel est prédit par celui du dessus.
+ * `differences` peut être NULL. En mode plages, ou depuis les sous-flux
+ * entrelacés (`sous_flux` non NULL), les deltas du lot sont lus avant la
+ * prédiction. Sans perte, chaque échantillon est ramené modulo 256
+ * avant de servir de voisin. */
+static void decoder_ligne_med(LecteurBits *lecteur, LecteursEntrelaces *sous_flux, const TableVLC *table,
+                              unsigned char *sortie, unsigned char *differences,
+                              const unsigned char *precedente, size_t taille, int nb_canaux, int plages,
+                              int decalage)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    RestaurationLot restaurer_lot = restauration_lot(decalage);
+    int masque = decalage ? -1 : 0xFF;
+    int32_t valeurs[DIF_LOT_DECODAGE];
+    int8_t deltas[DIF_LOT_DECODAGE];
+    int gauche[3] = {0};
+    size_t plage = 0;
+    for (size_t debut = 0; debut < taille; debut += DIF_LOT_DECODAGE) {
+        size_t n = taille - debut < DIF_LOT_DECODAGE ? taille - debut : DIF_LOT_DECODAGE;
+        const unsigned char *haut = precedente + debut;
+        if (sous_flux) plage = lire_deltas_entrelaces(sous_flux, table, deltas, n, plage, plages);
+        else if (plages) plage = lire_deltas_plages(lecteur, table, deltas, n, plage);
+        for (size_t i = 0; i < n; i += nb_canaux)
+            for (int canal = 0; canal < nb_canaux; canal++) {
+                int prediction = (debut + i == 0)
+                               ? haut[canal] >> decalage
+                               : predire_med(gauche[canal], haut[i + canal] >> decalage,
+                                             haut[i + canal - nb_canaux] >> decalage);
+                if (!plages && !sous_flux) deltas[i + canal] = lire_symbole(lecteur, table)->delta;
+                gauche[canal] = (prediction + deltas[i + canal]) & masque;
+                valeurs[i + canal] = gauche[canal];
+            }
+        restaurer_lot(valeurs, sortie + debut, n);
+        if (differences) noyaux->visualiser_deltas(deltas, differences + debut, n);
+    }
+}
+
+/* Décodage de lignes vers les sorties demandées (modes DIF_MODE_* de
+ * l'en-tête). En début de chaîne, `precedents` contient les pixels
+ * initiaux, qui ne sont pas codés dans le flux.
+ * En mode MED, les lignes suivant la première sont prédites en 2D.
+ * Avec la décorrélation, chaque ligne de l'image est recorrélée sur place
+ * dès qu'elle ne sert plus de voisinage (une ligne plus tard en MED).
+ * Les symboles viennent de `lecteur`, ou des sous-flux entrelacés d'une
+ * bande en mode Huffman (`sous_flux` non NULL). */
+static void decoder_lignes(LecteurBits *lecteur, LecteursEntrelaces *sous_flux, const TableVLC *table,
+                           const SortiesLignes *sorties, size_t nb_lignes, size_t octets_ligne,
+                           int nb_canaux, int precedents[3], int debut_chaine, unsigned int modes)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    size_t nb_pixels = octets_ligne / (size_t)nb_canaux;
+    int med = (modes & DIF_MODE_MED) != 0;
+    int plages = (modes & DIF_MODE_PLAGES) != 0;
+    int decalage = decalage_modes(modes);
+    int decorrelation = (modes & DIF_MODE_DECORRELATION) && sorties->image;
+    for (size_t ligne = 0; ligne < nb_lignes; ligne++) {
+        unsigned char *image = sorties->image ? sorties->image + ligne * sorties->pas_image : NULL;
+        unsigned char *differences = sorties->differences
+                                   ? sorties->differences + ligne * sorties->pas_differences : NULL;
+        size_t debut = 0;
+        if (ligne == 0 && debut_chaine) {
+            for (int canal = 0; canal < nb_canaux; canal++) {
+                if (image) image[canal] = decalage ? restaurer(precedents[canal])
+                                                   : (unsigned char)precedents[canal];
+                if (differences) differences[canal] = 255;
+            }
+            debut = (size_t)nb_canaux;
+        }
+        if (med && ligne > 0 && image)
+            decoder_ligne_med(lecteur, sous_flux, table, image, differences, image - sorties->pas_image,
+                              octets_ligne, nb_canaux, plages, decalage);
+        else if (sous_flux)
+            decoder_ligne_entrelacee(sous_flux, table, image ? image + debut : NULL,
+                                     differences ? differences + debut : NULL, octets_ligne - debut,
+                                     nb_canaux, precedents, plages, decalage);
+        else if (plages)
+            decoder_ligne_plages(lecteur, table, image ? image + debut : NULL,
+                                 differences ? differences + debut : NULL,
+                                 octets_ligne - debut, nb_canaux, precedents);
+        else if (image && differences)
+            decoder_image_et_differences(lecteur, table, image + debut, differences + debut,
+                                         octets_ligne - debut, nb_canaux, precedents, decalage);
+        else if (image)
+            decoder_echantillons(lecteur, table, image + debut, octets_ligne - debut,
+                                 nb_canaux, precedents, decalage);
+        else
+            decoder_differences(lecteur, table, differences + debut, octets_ligne - debut);
+        if (decorrelation && !med)
+            noyaux->recorreler_couleurs(image, nb_pixels, decalage);
+        else if (decorrelation && ligne > 0)
+            noyaux->recorreler_couleurs(image - sorties->pas_image, nb_pixels, decalage);
+    }
+    if (decorrelation && med && nb_lignes > 0)
+        noyaux->recorreler_couleurs(sorties->image + (nb_lignes - 1) * sorties->pas_image,
+                                    nb_pixels, decalage);
+}
+
+/* Décodage de lignes prédites par les mêmes lignes de l'image précédente
+ * (DIF_OPTION_TEMPOREL), plages terminées à chaque ligne. Chaque lot de la
+ * référence est lu avant l'écriture du lot décodé : l'image peut être
+ * décodée sur place, par-dessus la précédente. */
+static void decoder_lignes_temporelles(LecteurBits *lecteur, LecteursEntrelaces *sous_flux,
+                                       const TableVLC *table,
+                                       const SortiesLignes *sorties, const unsigned char *reference,
+                                       size_t pas_reference, size_t nb_lignes, size_t octets_ligne,
+                                       unsigned int modes)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    int plages = (modes & DIF_MODE_PLAGES) != 0;
+    int decalage = decalage_modes(modes);
+    RestaurationLot restaurer_lot = restauration_lot(decalage);
+    int masque = decalage ? -1 : 0xFF;
+    int32_t valeurs[DIF_LOT_DECODAGE];
+    int8_t deltas[DIF_LOT_DECODAGE];
+    for (size_t ligne = 0; ligne < nb_lignes; ligne++) {
+        unsigned char *image = sorties->image ? sorties->image + ligne * sorties->pas_image : NULL;
+        unsigned char *differences = sorties->differences
+                                   ? sorties->differences + ligne * sorties->pas_differences : NULL;
+        const unsigned char *precedente = reference + ligne * pas_reference;
+        size_t plage = 0;
+        for (size_t debut = 0; debut < octets_ligne; debut += DIF_LOT_DECODAGE) {
+            size_t n = octets_ligne - debut < DIF_LOT_DECODAGE ? octets_ligne - debut : DIF_LOT_DECODAGE;
+            if (sous_flux)
+                plage = lire_deltas_entrelaces(sous_flux, table, deltas, n, plage, plages);
+            else if (plages)
+                plage = lire_deltas_plages(lecteur, table, deltas, n, plage);
+            else
+                for (size_t i = 0; i < n; i++)
+                    deltas[i] = lire_symbole(lecteur, table)->delta;
+            for (size_t i = 0; i < n; i++)
+                valeurs[i] = ((precedente[debut + i] >> decalage) + deltas[i]) & masque;
+            if (image) restaurer_lot(valeurs, image + debut, n);
+            if (differences) noyaux->visualiser_deltas(deltas, differences + debut, n);
+        }
+    }
+}
+
+/* Sous-flux d'une bande en mode Huffman : table des tailles des
+ * DIF_SOUS_FLUX - 1 premiers, le dernier occupe le reste de la bande */
+static int ouvrir_sous_flux(LecteursEntrelaces *sous_flux, const unsigned char *donnees, size_t taille) {
+    uint32_t tailles[DIF_SOUS_FLUX - 1];
+    if (taille < sizeof tailles) return DIF_ERR_FORMAT;
+    memcpy(tailles, donnees, sizeof tailles);
+    donnees += sizeof tailles;
+    taille -= sizeof tailles;
+    for (int i = 0; i < DIF_SOUS_FLUX; i++) {
+        size_t octets = i < DIF_SOUS_FLUX - 1 ? tailles[i] : taille;
+        if (octets > taille) return DIF_ERR_FORMAT;
+        initialiser_lecteur(&sous_flux->lecteurs[i], donnees, octets);
+        donnees += octets;
+        taille -= octets;
+    }
+    sous_flux->courant = 0;
+    return DIF_OK;
+}
+
+/* Tâche de décodage d'une bande de la vague */
+static void decoder_bande(void *contexte, int index) {
+    VagueBandes *vague = contexte;
+    int premiere = index * vague->hauteur_bande;
+    int nb_lignes = vague->nb_lignes - premiere < vague->hauteur_bande
+                  ? vague->nb_lignes - premiere : vague->hauteur_bande;
+    const unsigned char *donnees = vague->compresse + vague->positions[index];
+    size_t taille = vague->positions[index + 1] - vague->positions[index];
+    size_t octets_premiers = (vague->modes & DIF_OPTION_TEMPOREL) ? 0 : (size_t)vague->nb_canaux;
+    vague->erreurs[index] = DIF_OK;
+    if (taille < octets_premiers) {
+        vague->erreurs[index] = DIF_ERR_FORMAT;
+        return;
+    }
+    SortiesLignes sorties = vague->sorties;
+    if (sorties.image) sorties.image += (size_t)premiere * sorties.pas_image;
+    if (sorties.differences) sorties.differences += (size_t)premiere * sorties.pas_differences;
+    LecteurBits lecteur;
+    LecteursEntrelaces entrelaces, *sous_flux = NULL;
+    if (vague->modes & DIF_MODE_HUFFMAN) {
+        sous_flux = &entrelaces;
+        if (ouvrir_sous_flux(sous_flux, donnees + octets_premiers, taille - octets_premiers) != DIF_OK) {
+            vague->erreurs[index] = DIF_ERR_FORMAT;
+            return;
+        }
+    } else {
+        initialiser_lecteur(&lecteur, donnees + octets_premiers, taille - octets_premiers);
+    }
+    if (vague->modes & DIF_OPTION_TEMPOREL) {
+        decoder_lignes_temporelles(&lecteur, sous_flux, vague->table_vlc, &sorties,
+                                   vague->reference + (size_t)premiere * vague->pas_reference,
+                                   vague->pas_reference, (size_t)nb_lignes, vague->octets_ligne,
+                                   vague->modes);
+    } else {
+        int precedents[3];
+        for (int canal = 0; canal < vague->nb_canaux; canal++)
+            precedents[canal] = donnees[canal];
+        decoder_lignes(&lecteur, sous_flux, vague->table_vlc, &sorties, (size_t)nb_lignes,
+                       vague->octets_ligne, vague->nb_canaux, precedents, 1, vague->modes);
+    }
+    int depasse = 0;
+    if (sous_flux)
+        for (int i = 0; i < DIF_SOUS_FLUX; i++)
+            depasse |= lecteur_depasse(&sous_flux->lecteurs[i]);
+    else
+        depasse = lecteur_depasse(&lecteur);
+    if (depasse)
+        vague->erreurs[index] = DIF_ERR_FORMAT;
+}
+
+/* Lecture d'une valeur repliée sur 16 bits : niveau tiré des 3 premiers
+ * bits (préfixes 0, 10, 110, 111), puis charge de 0 à 16 bits */
+static inline unsigned int lire_valeur16(LecteurBits *lecteur, const Niveaux16 *niveaux) {
+    static const uint8_t niveaux_prefixes[8] = {0, 0, 0, 0, 1, 1, 2, 3};
+    static const uint8_t longueurs_prefixes[4] = {1, 2, 3, 3};
+    if (lecteur->bits_disponibles < 32)
+        recharger_lecteur(lecteur);
+    int niveau = niveaux_prefixes[lecteur->reservoir >> 61];
+    unsigned int charge = (unsigned int)((lecteur->reservoir << longueurs_prefixes[niveau]) >> 1
+                                         >> (63 - niveaux->bits[niveau]));
+    lecteur->reservoir <<= niveaux->longueur[niveau];
+    lecteur->bits_disponibles -= niveaux->longueur[niveau];
+    return niveaux->debut[niveau] + charge;
+}
+
+/* Image différentielle des échantillons sur 16 bits : écarts ramenés à
+ * l'échelle 8 bits (`echelle` : 1024 / (valeur_max + 1) en virgule fixe
+ * 16 bits), puis 255 - |4 delta| comme sur 8 bits */
+static void visualiser_ecarts16(const int32_t *ecarts, uint8_t *sortie, size_t n, uint32_t echelle) {
+    for (size_t i = 0; i < n; i++) {
+        uint64_t ecart = ((uint64_t)(uint32_t)abs(ecarts[i]) * echelle) >> 16;
+        sortie[i] = (uint8_t)(ecart >= 255 ? 0 : 255 - ecart);
+    }
+}
+
+/* Décodage de `taille` échantillons sur 16 bits vers l'image et/ou l'image
+ * différentielle (NULL si non demandée). Avec la ligne `haut` (mode MED),
+ * le premier pixel est prédit par celui du dessus et les suivants par le
+ * prédicteur MED ; avec la ligne `reference` de l'image précédente, chaque
+ * échantillon par celui qu'elle a à la même place (lu avant l'écriture du
+ * lot, qui peut la remplacer) ; sinon par l'échantillon précédent du
+ * canal. Les valeurs sont ramenées modulo 65536 (sans effet sur un flux
+ * valide avec perte). */
+static void decoder_echantillons16(LecteurBits *lecteur, const Niveaux16 *niveaux, uint16_t *sortie,
+                                   unsigned char *differences, const uint16_t *haut,
+                                   const uint16_t *reference, size_t taille, int nb_canaux,
+                                   int precedents[3], int decalage, uint32_t echelle)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    int32_t valeurs[DIF_LOT_DECODAGE];
+    int32_t ecarts[DIF_LOT_DECODAGE];
+    for (size_t debut = 0; debut < taille; debut += DIF_LOT_DECODAGE) {
+        size_t n = taille - debut < DIF_LOT_DECODAGE ? taille - debut : DIF_LOT_DECODAGE;
+        for (size_t i = 0; i < n; i += nb_canaux)
+            for (int canal = 0; canal < nb_canaux; canal++) {
+                size_t k = debut + i + canal;
+                int prediction = precedents[canal];
+                if (reference)
+                    prediction = reference[k] >> decalage;
+                else if (haut)
+                    prediction = k < (size_t)nb_canaux
+                               ? haut[k] >> decalage
+                               : predire_med(precedents[canal], haut[k] >> decalage,
+                                             haut[k - nb_canaux] >> decalage);
+                unsigned int valeur = lire_valeur16(lecteur, niveaux) & 0xFFFF;
+                int delta = (int)(valeur >> 1) ^ -(int)(valeur & 1);
+                precedents[canal] = (prediction + delta) & 0xFFFF;
+                valeurs[i + canal] = precedents[canal];
+                ecarts[i + canal] = delta;
+            }
+        if (sortie) noyaux->restaurer_valeurs16(valeurs, sortie + debut, n, decalage);
+        if (differences) visualiser_ecarts16(ecarts, differences + debut, n, echelle);
+    }
+}
+
+/* Décodage de lignes d'échantillons sur 16 bits en début de chaîne (bande),
+ * comme decoder_lignes ; `taille` échantillons par ligne. Avec les lignes
+ * `reference` de l'image précédente (DIF_OPTION_TEMPOREL), pas de pixels
+ * initiaux. */
+static void decoder_lignes16(LecteurBits *lecteur, const Niveaux16 *niveaux, const SortiesLignes *sorties,
+                             const unsigned char *reference, size_t pas_reference,
+                             size_t nb_lignes, size_t taille, int nb_canaux, int precedents[3],
+                             unsigned int modes, int valeur_max)
+{
+    const NoyauxDIF *noyaux = noyaux_dif();
+    int med = (modes & DIF_MODE_MED) != 0;
+    int decalage = decalage_modes(modes);
+    uint32_t echelle = (uint32_t)((1024u << 16) / ((unsigned int)valeur_max + 1u));
+    for (size_t ligne = 0; ligne < nb_lignes; ligne++) {
+        uint16_t *image = sorties->image
+                        ? (uint16_t *)(sorties->image + ligne * sorties->pas_image) : NULL;
+        unsigned char *differences = sorties->differences
+                                   ? sorties->differences + ligne * sorties->pas_differences : NULL;
+        const uint16_t *haut = med && ligne > 0 && image
+                             ? (const uint16_t *)(sorties->image + (ligne - 1) * sorties->pas_image) : NULL;
+        const uint16_t *precedente = reference
+                                   ? (const uint16_t *)(reference + ligne * pas_reference) : NULL;
+        size_t debut = 0;
+        if (ligne == 0 && !reference) {
+            int32_t premiers[3];
+            for (int canal = 0; canal < nb_canaux; canal++) {
+                premiers[canal] = precedents[canal];
+                if (differences) differences[canal] = 255;
+            }
+            if (image) noyaux->restaurer_valeurs16(premiers, image, (size_t)nb_canaux, decalage);
+            debut = (size_t)nb_canaux;
+        }
+        decoder_echantillons16(lecteur, niveaux, image ? image + debut : NULL,
+                               differences ? differences + debut : NULL, haut, precedente,
+                               taille - debut, nb_canaux, precedents, decalage, echelle);
+    }
+}
+
+/* Tâche de décodage d'une bande d'échantillons sur 16 bits */
+static void decoder_bande16(void *contexte, int index) {
+    VagueBandes *vague = contexte;
+    int premiere = index * vague->hauteur_bande;
+    int nb_lignes = vague->nb_lignes - premiere < vague->hauteur_bande
+                  ? vague->nb_lignes - premiere : vague->hauteur_bande;
+    const unsigned char *donnees = vague->compresse + vague->positions[index];
+    size_t taille = vague->positions[index + 1] - vague->positions[index];
+    int temporel = (vague->modes & DIF_OPTION_TEMPOREL) != 0;
+    size_t octets_premiers = temporel ? 0 : vague->nb_canaux * sizeof(uint16_t);
+    vague->erreurs[index] = DIF_OK;
+    if (taille < octets_premiers) {
+        vague->erreurs[index] = DIF_ERR_FORMAT;
+        return;
+    }
+    int precedents[3] = {0};
+    for (size_t canal = 0; canal < octets_premiers / sizeof(uint16_t); canal++) {
+        uint16_t premier;
+        memcpy(&premier, donnees + canal * sizeof premier, sizeof premier);
+        precedents[canal] = premier;
+    }
+    SortiesLignes sorties = vague->sorties;
+    if (sorties.image) sorties.image += (size_t)premiere * sorties.pas_image;
+    if (sorties.differences) sorties.differences += (size_t)premiere * sorties.pas_differences;
+    LecteurBits lecteur;
+    initialiser_lecteur(&lecteur, donnees + octets_premiers, taille - octets_premiers);
+    decoder_lignes16(&lecteur, vague->niveaux, &sorties,
+                     temporel ? vague->reference + (size_t)premiere * vague->pas_reference : NULL,
+                     vague->pas_reference, (size_t)nb_lignes, vague->octets_ligne / 2,
+                     vague->nb_canaux, precedents, vague->modes, vague->valeur_max);
+    if (lecteur_depasse(&lecteur))
+        vague->erreurs[index] = DIF_ERR_FORMAT;
+}
+
+/* Région d'un décodage partiel : lignes [premiere, premiere + nb_lignes[
+ * de l'image, octets [debut, debut + octets[ de chacune */
+typedef struct {
+    int premiere;
+    int nb_lignes;
+    size_t debut;
+    size_t octets;
+} RegionDIF;
+
+/* Vignette d'un décodage réduit : chaque pixel est la moyenne d'un bloc de
+ * facteur x facteur pixels de l'image (blocs tronqués aux bords droit et
+ * bas). Chaque ligne décodée est réduite aussitôt en sommes par bloc,
+ * rangées par plan, moyennées en une ligne de la vignette toutes les
+ * `facteur` lignes. */
+typedef struct {
+    int facteur;
+    int largeur;              /* largeur de l'image décodée */
+    int hauteur;
+    int nb_canaux;
+    int seize_bits;
+    int largeur_vignette;
+    void *sommes;             /* largeur_vignette sommes par canal : uint16_t sur 8
+                                 bits (64 x 255 au plus), uint32_t sur 16 bits */
+    unsigned char *ligne;     /* ligne moyenne avant livraison */
+    int lignes_accumulees;
+    int rang;                 /* lignes de la vignette déjà livrées */
+} VignetteDIF;
+
+/* Lignes décodées : écrites par blocs dans un fichier, ou directement dans
+ * l'image de l'appelant (recadrée sur `region`, ou réduite en `vignette`,
+ * si elles sont fournies) */
+typedef struct {
+    FILE *fichier;
+    unsigned char *pixels;
+    size_t pas;
+    size_t octets_ligne;
+    size_t pas_plan;          /* non nul : image de l'appelant en plans séparés */
+    int gros_boutiste;        /* fichier PNM d'échantillons sur 16 bits */
+    const RegionDIF *region;
+    VignetteDIF *vignette;
+    unsigned char *bloc;
+} DestinationLignes;
+
+/* Vrai si les lignes sont décodées dans le bloc de la destination */
+static int destination_par_bloc(const DestinationLignes *destination) {
+    return destination->fichier || destination->pas_plan || destination->region ||
+           destination->vignette;
+}
+
+/* Destinations des deux images d'un décodage (NULL si non demandée) */
+typedef struct {
+    DestinationLignes *image;
+    DestinationLignes *differences;
+} DestinationsDIF;
+
+/* Blocs d'écriture pris dans les zones du contexte (fichiers et plans seulement) */
+static int preparer_destinations(dif_context *contexte, const DestinationsDIF *destinations,
+                                 size_t lignes_max)
+{
+    DestinationLignes *liste[2] = { destinations->image, destinations->differences };
+    ZoneDIF *zones[2] = { &contexte->lignes, &contexte->differences };
+    for (int i = 0; i < 2; i++) {
+        if (!liste[i]) continue;
+        liste[i]->bloc = NULL;
+        if (!destination_par_bloc(liste[i])) continue;
+        liste[i]->bloc = reserver_zone(zones[i], lignes_max * liste[i]->octets_ligne);
+        if (!liste[i]->bloc) return DIF_ERR_ALLOC;
+    }
+    return DIF_OK;
+}
+
+/* Emplacement des lignes à décoder à partir de la ligne `ligne` */
+static unsigned char *lignes_destination(DestinationLignes *destination, int ligne, size_t *pas) {
+    if (!destination) return NULL;
+    if (destination_par_bloc(destination)) {
+        *pas = destination->octets_ligne;
+        return destination->bloc;
+    }
+    *pas = destination->pas;
+    return destination->pixels + (size_t)ligne * destination->pas;
+}
+
+/* Sorties du bloc de lignes commençant à la ligne `ligne` */
+static SortiesLignes sorties_destinations(const DestinationsDIF *destinations, int ligne) {
+    SortiesLignes sorties = {0};
+    sorties.image = lignes_destination(destinations->image, ligne, &sorties.pas_image);
+    sorties.differences = lignes_destination(destinations->differences, ligne, &sorties.pas_differences);
+    return sorties;
+}
+
+/* Livraison des lignes décodées qui coupent la région de la destination :
+ * colonnes de la région recopiées (ou séparées en plans) dans l'image de
+ * l'appelant */
+static void livrer_region(const DestinationLignes *destination, int ligne, size_t nb_lignes) {
+    const RegionDIF *region = destination->region;
+    const NoyauxDIF *noyaux = noyaux_dif();
+    for (size_t i = 0; i < nb_lignes; i++) {
+        int rang = ligne + (int)i - region->premiere;
+        if (rang < 0 || rang >= region->nb_lignes) continue;
+        const unsigned char *source = destination->bloc + i * destination->octets_ligne + region->debut;
+        unsigned char *cible = destination->pixels + (size_t)rang * destination->pas;
+        if (destination->pas_plan) {
+            unsigned char *const plans[3] = { cible, cible + destination->pas_plan,
+                                              cible + 2 * destination->pas_plan };
+            noyaux->separer_plans(source, region->octets / 3, plans);
+        } else {
+            memcpy(cible, source, region->octets);
+        }
+    }
+}
+
+/* Ajout des sommes par bloc d'une ligne décodée */
+static void accumuler_vignette(VignetteDIF *vignette, const unsigned char *ligne) {
+    size_t pas_plan = (size_t)vignette->largeur_vignette;
+    int nb_canaux = vignette->nb_canaux;
+    if (!vignette->seize_bits) {
+        noyaux_dif()->sommer_blocs(ligne, (size_t)vignette->largeur, nb_canaux, vignette->facteur,
+                                   vignette->sommes, pas_plan);
+    } else {
+        const uint16_t *echantillons = (const uint16_t *)ligne;
+        uint32_t *sommes = vignette->sommes;
+        for (int x = 0, bloc = 0; x < vignette->largeur; bloc++) {
+            int fin = x + vignette->facteur < vignette->largeur ? x + vignette->facteur : vignette->largeur;
+            for (; x < fin; x++)
+                for (int canal = 0; canal < nb_canaux; canal++)
+                    sommes[canal * pas_plan + bloc] += echantillons[(size_t)x * nb_canaux + canal];
+        }
+    }
+    vignette->lignes_accumulees++;
+}
+
+/* Moyennes arrondies des blocs dans la ligne de la vignette (pixels
+ * entrelacés), sommes remises à zéro */
+static void moyenner_vignette(VignetteDIF *vignette) {
+    int nb_canaux = vignette->nb_canaux;
+    size_t pas_plan = (size_t)vignette->largeur_vignette;
+    const uint16_t *sommes8 = vignette->sommes;
+    const uint32_t *sommes16 = vignette->sommes;
+    size_t i = 0;
+    for (int bloc = 0; bloc < vignette->largeur_vignette; bloc++) {
+        int colonnes = vignette->largeur - bloc * vignette->facteur;
+        if (colonnes > vignette->facteur) colonnes = vignette->facteur;
+        uint32_t effectif = (uint32_t)colonnes * (uint32_t)vignette->lignes_accumulees;
+        for (int canal = 0; canal < nb_canaux; canal++, i++) {
+            size_t k = canal * pas_plan + bloc;
+            uint32_t somme = vignette->seize_bits ? sommes16[k] : sommes8[k];
+            uint32_t moyenne = (somme + effectif / 2) / effectif;
+            if (vignette->seize_bits)
+                ((uint16_t *)vignette->ligne)[i] = (uint16_t)moyenne;
+            else
+                vignette->ligne[i] = (unsigned char)moyenne;
+        }
+    }
+    memset(vignette->sommes, 0,
+           pas_plan * nb_canaux * (vignette->seize_bits ? sizeof *sommes16 : sizeof *sommes8));
+    vignette->lignes_accumulees = 0;
+}
+
+/* Livraison des lignes décodées dans la vignette : une ligne réduite est
+ * écrite (fichier, image de l'appelant ou plans) toutes les `facteur`
+ * lignes, et après la dernière ligne de l'image */
+static int livrer_vignette(DestinationLignes *destination, int ligne, size_t nb_lignes) {
+    VignetteDIF *vignette = destination->vignette;
+    size_t echantillons = (size_t)vignette->largeur_vignette * vignette->nb_canaux;
+    size_t octets = echantillons * (vignette->seize_bits ? 2 : 1);
+    for (size_t i = 0; i < nb_lignes; i++) {
+        accumuler_vignette(vignette, destination->bloc + i * destination->octets_ligne);
+        int suivante = ligne + (int)i + 1;
+        if (suivante % vignette->facteur && suivante != vignette->hauteur) continue;
+        moyenner_vignette(vignette);
+        if (destination->fichier) {
+            if (destination->gros_boutiste)
+                ecrire_gros_boutistes16(vignette->ligne, vignette->ligne, echantillons);
+            if (fwrite(vignette->ligne, 1, octets, destination->fichier) != octets)
+                return DIF_ERR_IO;
+            continue;
+        }
+        unsigned char *cible = destination->pixels + (size_t)vignette->rang++ * destination->pas;
+        if (destination->pas_plan) {
+            unsigned char *const plans[3] = { cible, cible + destination->pas_plan,
+                                              cible + 2 * destination->pas_plan };
+            noyaux_dif()->separer_plans(vignette->ligne, (size_t)vignette->largeur_vignette, plans);
+        } else {
+            memcpy(cible, vignette->ligne, octets);
+        }
+    }
+    return DIF_OK;
+}
+
+/* Livraison de `nb_lignes` lignes décodées à partir de la ligne `ligne` :
+ * écriture dans le fichier, recadrage, réduction ou séparation en plans */
+static int livrer_lignes(DestinationLignes *destination, int ligne, size_t nb_lignes) {
+    if (!destination) return DIF_OK;
+    if (destination->region) {
+        livrer_region(destination, ligne, nb_lignes);
+        return DIF_OK;
+    }
+    if (destination->vignette)
+        return livrer_vignette(destination, ligne, nb_lignes);
+    if (destination->gros_boutiste)
+        ecrire_gros_boutistes16(destination->bloc, destination->bloc,
+                                nb_lignes * destination->octets_ligne / 2);
+    if (destination->fichier &&
+        fwrite(destination->bloc, destination->octets_ligne, nb_lignes, destination->fichier) != nb_lignes)
+        return DIF_ERR_IO;
+    if (destination->pas_plan) {
+        const NoyauxDIF *noyaux = noyaux_dif();
+        for (size_t i = 0; i < nb_lignes; i++) {
+            unsigned char *rouge = destination->pixels + (ligne + i) * destination->pas;
+            unsigned char *const plans[3] = { rouge, rouge + destination->pas_plan,
+                                              rouge + 2 * destination->pas_plan };
+            noyaux->separer_plans(destination->bloc + i * destination->octets_ligne,
+                                  destination->octets_ligne / 3, plans);
+        }
+    }
+    return DIF_OK;
+}
+
+static int livrer_destinations(const DestinationsDIF *destinations, int ligne, size_t nb_lignes) {
+    int err = livrer_lignes(destinations->image, ligne, nb_lignes);
+    return err == DIF_OK ? livrer_lignes(destinations->differences, ligne, nb_lignes) : err;
+}
+
+/* Décodage d'un fichier en bandes : chaque vague est lue d'un bloc, décodée
+ * en parallèle puis livrée dans l'ordre. Avec une région, la table des
+ * positions sert d'index : les bandes qui précèdent ses lignes sont
+ * sautées, le décodage s'arrête à sa dernière ligne. */
+static int decoder_bandes(dif_context *contexte, DecodeurDIF *dec, const DestinationsDIF *destinations,
+                          const RegionDIF *region)
+{
+    const EnteteDIF *entete = &dec->entete;
+    PoolThreads *pool = pool_contexte(contexte);
+    if (!pool) return DIF_ERR_ALLOC;
+    int debut = region ? region->premiere / entete->hauteur_bande * entete->hauteur_bande : 0;
+    int fin = region ? region->premiere + region->nb_lignes : entete->hauteur;
+    uint32_t bande = (uint32_t)(debut / entete->hauteur_bande);
+    uint32_t bandes_utiles = (uint32_t)((fin - 1) / entete->hauteur_bande) + 1 - bande;
+    int bandes_par_vague = 2 * taille_pool(pool);
+    if ((uint32_t)bandes_par_vague > bandes_utiles) bandes_par_vague = (int)bandes_utiles;
+    int seize_bits = (entete->options & DIF_OPTION_16BITS) != 0;
+    size_t octets_premiers = entete->nb_canaux * octets_echantillon(entete->valeur_max);
+    size_t octets_ligne = (size_t)entete->largeur * octets_premiers;
+    size_t octets_bande = octets_ligne * entete->hauteur_bande;
+    unsigned char *compresse = NULL;
+    if (dec->source.fichier)
+        compresse = reserver_zone(&contexte->bandes,
+                                  taille_max_bande(octets_premiers, octets_bande, entete->options) *
+                                  bandes_par_vague);
+    uint64_t *positions = reserver_zone(&contexte->positions_vague, (bandes_par_vague + 1) * sizeof *positions);
+    int *erreurs = reserver_zone(&contexte->erreurs, bandes_par_vague * sizeof *erreurs);
+    int err = ((compresse || !dec->source.fichier) && positions && erreurs) ? DIF_OK : DIF_ERR_ALLOC;
+    if (err == DIF_OK)
+        err = preparer_destinations(contexte, destinations,
+                                    (size_t)bandes_par_vague * entete->hauteur_bande);
+    if (err == DIF_OK && bande && !sauter_octets(&dec->source, dec->positions[bande]))
+        err = DIF_ERR_FORMAT;
+
+    VagueBandes vague = { NULL, dec->table, seize_bits ? &dec->niveaux : NULL, entete->valeur_max,
+                          NULL, 0, octets_ligne, entete->nb_canaux, entete->hauteur_bande, 0,
+                          entete->options, NULL, NULL, NULL, positions, {0}, erreurs, NULL,
+                          dec->pas_reference };
+    for (int ligne = debut; ligne < fin && err == DIF_OK; ) {
+        int nb_lignes = fin - ligne;
+        if (nb_lignes > bandes_par_vague * entete->hauteur_bande)
+            nb_lignes = bandes_par_vague * entete->hauteur_bande;
+        int nb_bandes = (nb_lignes + entete->hauteur_bande - 1) / entete->hauteur_bande;
+        for (int i = 0; i <= nb_bandes; i++)
+            positions[i] = dec->positions[bande + i] - dec->positions[bande];
+        vague.compresse = prendre_octets(&dec->source, compresse, positions[nb_bandes]);
+        if (!vague.compresse) {
+            err = DIF_ERR_FORMAT;
+            break;
+        }
+        vague.sorties = sorties_destinations(destinations, ligne);
+        vague.nb_lignes = nb_lignes;
+        if (dec->reference)
+            vague.reference = dec->reference + (size_t)ligne * dec->pas_reference;
+        executer_pool(pool, nb_bandes, seize_bits ? decoder_bande16 : decoder_bande, &vague);
+        err = erreur_vague(&vague, nb_bandes);
+        if (err == DIF_OK)
+            err = livrer_destinations(destinations, ligne, (size_t)nb_lignes);
+        bande += nb_bandes;
+        ligne += nb_lignes;
+    }
+    return err;
+}
+
+/* Décodage en flux du fichier classique : chaque bloc de lignes est livré
+ * dès qu'il est complet. Sans index, une région est décodée depuis la
+ * première ligne ; le décodage s'arrête à sa dernière ligne. */
+static int decoder_classique(dif_context *contexte, DecodeurDIF *dec, const DestinationsDIF *destinations,
+                             const RegionDIF *region)
+{
+    int nb_canaux = dec->entete.nb_canaux;
+    size_t octets_ligne = (size_t)dec->entete.largeur * nb_canaux;
+    size_t lignes_par_bloc = DIF_TAILLE_BLOC / octets_ligne;
+    if (lignes_par_bloc == 0) lignes_par_bloc = 1;
+    int err = preparer_destinations(contexte, destinations, lignes_par_bloc);
+
+    int precedents[3];
+    for (int canal = 0; canal < nb_canaux; canal++)
+        precedents[canal] = dec->entete.pixels_initiaux[canal];
+    int fin = region ? region->premiere + region->nb_lignes : dec->entete.hauteur;
+    for (int ligne = 0; ligne < fin && err == DIF_OK; ) {
+        size_t nb_lignes = (size_t)(fin - ligne) < lignes_par_bloc ? (size_t)(fin - ligne) : lignes_par_bloc;
+        SortiesLignes sorties = sorties_destinations(destinations, ligne);
+        decoder_lignes(&dec->lecteur, NULL, dec->table, &sorties, nb_lignes, octets_ligne,
+                       nb_canaux, precedents, ligne == 0, 0);
+        if (lecteur_depasse(&dec->lecteur))
+            err = DIF_ERR_FORMAT;
+        else
+            err = livrer_destinations(destinations, ligne, nb_lignes);
+        ligne += (int)nb_lignes;
+    }
+    return err;
+}
+
+/* Décodage de l'image (classique ou en bandes) vers ses destinations, ou
+ * des lignes de `region` seulement ; l'image différentielle reste sur 8 bits.
+ * Une image prédite par la précédente ne se décode que dans sa séquence. */
+static int decoder_image(dif_context *contexte, DecodeurDIF *dec, const DestinationsDIF *destinations,
+                         const RegionDIF *region)
+{
+    if ((dec->entete.options & DIF_OPTION_TEMPOREL) && !dec->reference)
+        return DIF_ERR_FORMAT;
+    size_t nb_echantillons = (size_t)dec->entete.largeur * dec->entete.nb_canaux;
+    if (destinations->image)
+        destinations->image->octets_ligne = nb_echantillons * octets_echantillon(dec->entete.valeur_max);
+    if (destinations->differences) destinations->differences->octets_ligne = nb_echantillons;
+    if (dec->entete.nb_bandes)
+        return decoder_bandes(contexte, dec, destinations, region);
+    return decoder_classique(contexte, dec, destinations, region);
+}
+
+/* Vignette de l'image réduite d'un facteur 2, 4 ou 8 : ligne de sommes et
+ * ligne moyenne prises dans la zone du contexte */
+static int preparer_vignette(dif_context *contexte, VignetteDIF *vignette, const EnteteDIF *entete,
+                             int facteur)
+{
+    vignette->facteur = facteur;
+    vignette->largeur = entete->largeur;
+    vignette->hauteur = entete->hauteur;
+    vignette->nb_canaux = entete->nb_canaux;
+    vignette->seize_bits = entete->valeur_max > 255;
+    vignette->largeur_vignette = (entete->largeur + facteur - 1) / facteur;
+    vignette->lignes_accumulees = 0;
+    vignette->rang = 0;
+    size_t echantillons = (size_t)vignette->largeur_vignette * entete->nb_canaux;
+    size_t octets_sommes = echantillons * (vignette->seize_bits ? sizeof(uint32_t) : sizeof(uint16_t));
+    vignette->sommes = reserver_zone(&contexte->vignette, octets_sommes + echantillons * 2);
+    if (!vignette->sommes) return DIF_ERR_ALLOC;
+    memset(vignette->sommes, 0, octets_sommes);
+    vignette->ligne = (unsigned char *)vignette->sommes + octets_sommes;
+    return DIF_OK;
+}
+
+/* Dimensions d'une image DIF en mémoire, sans la décoder */
+int dif_info_mem(const unsigned char *donnees, size_t taille, FormatImageDIF *format) {
+    SourceOctets source = { donnees, taille, 0, NULL };
+    EnteteDIF entete;
+    if (!donnees || !format) return DIF_ERR_FORMAT;
+    int err = lire_entete_dif(&source, &entete);
+    if (err != DIF_OK) return err;
+    format->largeur = entete.largeur;
+    format->hauteur = entete.hauteur;
+    format->nb_canaux = entete.nb_canaux;
+    format->pas = (size_t)entete.largeur * entete.nb_canaux * octets_echantillon(entete.valeur_max);
+    format->plans = 0;
+    format->valeur_max = entete.valeur_max;
+    return DIF_OK;
+}
+
+/* Décodage en mémoire de toute l'image, seulement du rectangle
+ * (x, y, largeur, hauteur) s'il est fourni, ou de sa vignette réduite
+ * d'un facteur 2, 4 ou 8 (`facteur` à 1 sinon) */
+static int decoder_memoire(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                           const int rectangle[4], int facteur, FormatImageDIF *format,
+                           TamponDIF *sortie)
+{
+    if (!donnees || !format || !sortie) return DIF_ERR_FORMAT;
+    preparer_tampon(sortie);
+    DecodeurDIF dec;
+    dec.source = (SourceOctets){ donnees, taille, 0, NULL };
+    int err = ouvrir_decodeur(contexte, &dec);
+    if (err != DIF_OK) return err;
+    int x = 0, y = 0, largeur = dec.entete.largeur, hauteur = dec.entete.hauteur;
+    if (rectangle) {
+        x = rectangle[0];
+        y = rectangle[1];
+        largeur = rectangle[2];
+        hauteur = rectangle[3];
+        if (x < 0 || y < 0 || largeur <= 0 || hauteur <= 0 ||
+            largeur > dec.entete.largeur - x || hauteur > dec.entete.hauteur - y)
+            return DIF_ERR_FORMAT;
+    }
+    VignetteDIF vignette;
+    if (facteur > 1) {
+        err = preparer_vignette(contexte, &vignette, &dec.entete, facteur);
+        if (err != DIF_OK) return err;
+        largeur = vignette.largeur_vignette;
+        hauteur = (hauteur + facteur - 1) / facteur;
+    }
+    size_t octets = octets_echantillon(dec.entete.valeur_max);
+    size_t octets_pixel = dec.entete.nb_canaux * octets;
+    size_t octets_ligne = (size_t)dec.entete.largeur * octets_pixel;
+    size_t pas, pas_plan;
+    err = verifier_format(format, largeur, hauteur, dec.entete.nb_canaux, octets, &pas, &pas_plan);
+    size_t taille_image = taille_format(largeur, hauteur, dec.entete.nb_canaux, octets, pas, pas_plan);
+    if (err == DIF_OK)
+        err = agrandir_tampon(sortie, taille_image);
+    if (err == DIF_OK) {
+        RegionDIF region = { y, hauteur, (size_t)x * octets_pixel, (size_t)largeur * octets_pixel };
+        DestinationLignes image = { NULL, sortie->donnees, pas, octets_ligne, pas_plan, 0,
+                                    rectangle ? &region : NULL, facteur > 1 ? &vignette : NULL,
+                                    NULL };
+        DestinationsDIF destinations = { &image, NULL };
+        err = decoder_image(contexte, &dec, &destinations, image.region);
+    }
+    format->largeur = largeur;
+    format->hauteur = hauteur;
+    format->nb_canaux = dec.entete.nb_canaux;
+    format->pas = pas;
+    format->valeur_max = dec.entete.valeur_max;
+    if (err == DIF_OK) sortie->taille = taille_image;
+    return err;
+}
+
+/* Décodage d'une image DIF en mémoire vers un tampon de pixels entrelacés,
+ * avec un contexte réutilisable */
+int dif_decode_mem_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                       FormatImageDIF *format, TamponDIF *sortie)
+{
+    return decoder_memoire(contexte, donnees, taille, NULL, 1, format, sortie);
+}
+
+/* Décodage d'une image DIF en mémoire vers un tampon de pixels entrelacés */
+int dif_decode_mem(const unsigned char *donnees, size_t taille, FormatImageDIF *format,
+                   TamponDIF *sortie, const OptionsDIF *options)
+{
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = dif_decode_mem_ctx(&contexte, donnees, taille, format, sortie);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Décodage d'une région d'une image DIF en mémoire, avec un contexte
+ * réutilisable */
+int dif_decode_region_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                          int x, int y, int largeur, int hauteur,
+                          FormatImageDIF *format, TamponDIF *sortie)
+{
+    const int rectangle[4] = { x, y, largeur, hauteur };
+    return decoder_memoire(contexte, donnees, taille, rectangle, 1, format, sortie);
+}
+
+/* Décodage d'une région d'une image DIF en mémoire */
+int dif_decode_region(const unsigned char *donnees, size_t taille, int x, int y, int largeur,
+                      int hauteur, FormatImageDIF *format, TamponDIF *sortie, const OptionsDIF *options)
+{
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = dif_decode_region_ctx(&contexte, donnees, taille, x, y, largeur, hauteur, format, sortie);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Décodage d'une vignette d'une image DIF en mémoire, avec un contexte
+ * réutilisable */
+int dif_decode_vignette_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                            int facteur, FormatImageDIF *format, TamponDIF *sortie)
+{
+    if (facteur != 2 && facteur != 4 && facteur != 8) return DIF_ERR_FORMAT;
+    return decoder_memoire(contexte, donnees, taille, NULL, facteur, format, sortie);
+}
+
+/* Décodage d'une vignette d'une image DIF en mémoire */
+int dif_decode_vignette(const unsigned char *donnees, size_t taille, int facteur,
+                        FormatImageDIF *format, TamponDIF *sortie, const OptionsDIF *options)
+{
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = dif_decode_vignette_ctx(&contexte, donnees, taille, facteur, format, sortie);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Création d'un fichier PNM et écriture de son en-tête */
+static FILE *creer_pnm(const char *chemin, int nb_canaux, int largeur, int hauteur, int valeur_max) {
+    FILE *fichier = ouvrir_sortie(chemin);
+    if (fichier) {
+        fprintf(fichier, nb_canaux == 1 ? "P5\n" : "P6\n");
+        fprintf(fichier, "%d %d\n%d\n", largeur, hauteur, valeur_max);
+    }
+    return fichier;
+}
+
+/* Décodage vers des fichiers PNM : image reconstruite et/ou image
+ * différentielle (chemin NULL si non demandée), en une seule passe ; image
+ * reconstruite réduite en vignette si `facteur` vaut 2, 4 ou 8 */
+static int decoder_vers_pnm(dif_context *contexte, const char *fichier_dif, const char *fichier_pnm,
+                            const char *fichier_raw, int facteur)
+{
+    DecodeurDIF dec;
+    if (ouvrir_source(&dec.source, fichier_dif) != DIF_OK) return DIF_ERR_IO;
+    int err = ouvrir_decodeur(contexte, &dec);
+    if (err != DIF_OK) {
+        fermer_source(&dec.source);
+        return err;
+    }
+    const EnteteDIF *entete = &dec.entete;
+    VignetteDIF vignette;
+    int largeur = entete->largeur, hauteur = entete->hauteur;
+    if (facteur > 1) {
+        err = preparer_vignette(contexte, &vignette, entete, facteur);
+        largeur = vignette.largeur_vignette;
+        hauteur = (hauteur + facteur - 1) / facteur;
+    }
+    DestinationLignes image = { NULL, NULL, 0, 0, 0, entete->valeur_max > 255, NULL,
+                                facteur > 1 ? &vignette : NULL, NULL };
+    DestinationLignes differences = { NULL, NULL, 0, 0, 0, 0, NULL, NULL, NULL };
+    DestinationsDIF destinations = { fichier_pnm ? &image : NULL, fichier_raw ? &differences : NULL };
+    if (err == DIF_OK && fichier_pnm &&
+        !(image.fichier = creer_pnm(fichier_pnm, entete->nb_canaux, largeur, hauteur, entete->valeur_max)))
+        err = DIF_ERR_IO;
+    if (err == DIF_OK && fichier_raw &&
+        !(differences.fichier = creer_pnm(fichier_raw, entete->nb_canaux, entete->largeur,
+                                          entete->hauteur, 255)))
+        err = DIF_ERR_IO;
+    if (err == DIF_OK)
+        err = decoder_image(contexte, &dec, &destinations, NULL);
+    if (image.fichier && fermer_sortie(image.fichier, fichier_pnm) != DIF_OK) err = DIF_ERR_IO;
+    if (differences.fichier && fermer_sortie(differences.fichier, fichier_raw) != DIF_OK) err = DIF_ERR_IO;
+    if (err != DIF_OK) {
+        if (image.fichier) supprimer_sortie(fichier_pnm);
+        if (differences.fichier) supprimer_sortie(fichier_raw);
+    }
+    fermer_source(&dec.source);
+    return err;
+}
+
+/* Décodage DIF vers PNM avec un contexte réutilisable */
+int diftopnm_ctx(dif_context *contexte, const char *fichier_dif, const char *fichier_pnm) {
+    return decoder_vers_pnm(contexte, fichier_dif, fichier_pnm, NULL, 1);
+}
+
+/* Décodage DIF raw (image différentielle) avec un contexte réutilisable */
+int diftopnm_raw_ctx(dif_context *contexte, const char *fichier_dif, const char *fichier_pnm) {
+    return decoder_vers_pnm(contexte, fichier_dif, NULL, fichier_pnm, 1);
+}
+
+/* Décodage DIF vers l'image reconstruite et l'image différentielle à la
+ * fois (un seul décodage VLC), avec un contexte réutilisable */
+int diftopnm_et_raw_ctx(dif_context *contexte, const char *fichier_dif, const char *fichier_pnm,
+                        const char *fichier_raw)
+{
+    return decoder_vers_pnm(contexte, fichier_dif, fichier_pnm, fichier_raw, 1);
+}
+
+/* Vignette d'une image DIF vers PNM avec un contexte réutilisable */
+int diftopnm_vignette_ctx(dif_context *contexte, const char *fichier_dif, const char *fichier_pnm,
+                          int facteur)
+{
+    if (facteur != 2 && facteur != 4 && facteur != 8) return DIF_ERR_FORMAT;
+    return decoder_vers_pnm(contexte, fichier_dif, fichier_pnm, NULL, facteur);
+}
+
+/* Vignette d'une image DIF vers PNM */
+int diftopnm_vignette(const char *fichier_dif, const char *fichier_pnm, int facteur) {
+    dif_context contexte;
+    initialiser_contexte(&contexte, NULL);
+    int err = diftopnm_vignette_ctx(&contexte, fichier_dif, fichier_pnm, facteur);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Décodage DIF vers PNM avec options */
+int diftopnm_options(const char *fichier_dif, const char *fichier_pnm, const OptionsDIF *options) {
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = decoder_vers_pnm(&contexte, fichier_dif, fichier_pnm, NULL, 1);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Décodage DIF vers PNM */
+int diftopnm(const char* fichier_dif, const char* fichier_pnm){
+    return diftopnm_options(fichier_dif, fichier_pnm, NULL);
+}
+
+/* Décodage DIF raw (image différentielle) */
+int diftopnm_raw(const char* fichier_dif, const char* fichier_pnm)
+{
+    dif_context contexte;
+    initialiser_contexte(&contexte, NULL);
+    int err = decoder_vers_pnm(&contexte, fichier_dif, NULL, fichier_pnm, 1);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Décodage DIF vers l'image reconstruite et l'image différentielle en une passe */
+int diftopnm_et_raw(const char *fichier_dif, const char *fichier_pnm, const char *fichier_raw) {
+    dif_context contexte;
+    initialiser_contexte(&contexte, NULL);
+    int err = decoder_vers_pnm(&contexte, fichier_dif, fichier_pnm, fichier_raw, 1);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Séquence DIF : en-tête de TAILLE_ENTETE_SEQUENCE octets (magic, version,
+ * nombre de canaux, largeur, hauteur, valeur maximale, intervalle entre
+ * deux images intra, nombre d'images), table de nb_images + 1 positions sur
+ * 64 bits relatives à la fin de la table, puis les images, chacune un
+ * fichier étendu complet. Une image prédite par la précédente porte
+ * DIF_OPTION_TEMPOREL ; la première est toujours intra. */
+typedef struct {
+    int nb_canaux;
+    int largeur;
+    int hauteur;
+    int valeur_max;
+    int intervalle_cles;
+    uint32_t nb_images;
+    const unsigned char *table;     /* positions des images (non alignées) */
+    const unsigned char *images;
+    size_t taille_images;
+} SequenceDIF;
+
+static uint64_t position_image(const SequenceDIF *sequence, uint32_t index) {
+    uint64_t position;
+    memcpy(&position, sequence->table + (size_t)index * sizeof position, sizeof position);
+    return position;
+}
+
+/* Lecture et vérification de l'en-tête et de la table des positions
+ * (croissantes, dans les données) */
+static int lire_sequence(const unsigned char *donnees, size_t taille, SequenceDIF *sequence) {
+    if (!donnees || taille < TAILLE_ENTETE_SEQUENCE) return DIF_ERR_FORMAT;
+    uint16_t magique, largeur, hauteur, valeur_max, intervalle;
+    memcpy(&magique, donnees, 2);
+    memcpy(&largeur, donnees + 4, 2);
+    memcpy(&hauteur, donnees + 6, 2);
+    memcpy(&valeur_max, donnees + 8, 2);
+    memcpy(&intervalle, donnees + 10, 2);
+    memcpy(&sequence->nb_images, donnees + 12, 4);
+    if (magique != DIF_MAGIC_SEQUENCE || donnees[2] != DIF_VERSION_SEQUENCE ||
+        (donnees[3] != 1 && donnees[3] != 3) || largeur == 0 || hauteur == 0 || valeur_max < 255 ||
+        sequence->nb_images == 0 || sequence->nb_images > INT32_MAX ||
+        (taille - TAILLE_ENTETE_SEQUENCE) / sizeof(uint64_t) <= sequence->nb_images)
+        return DIF_ERR_FORMAT;
+    sequence->nb_canaux = donnees[3];
+    sequence->largeur = largeur;
+    sequence->hauteur = hauteur;
+    sequence->valeur_max = valeur_max;
+    sequence->intervalle_cles = intervalle;
+    sequence->table = donnees + TAILLE_ENTETE_SEQUENCE;
+    size_t taille_table = (sequence->nb_images + (size_t)1) * sizeof(uint64_t);
+    sequence->images = sequence->table + taille_table;
+    sequence->taille_images = taille - TAILLE_ENTETE_SEQUENCE - taille_table;
+    if (position_image(sequence, 0) != 0) return DIF_ERR_FORMAT;
+    for (uint32_t i = 1; i <= sequence->nb_images; i++)
+        if (position_image(sequence, i) < position_image(sequence, i - 1))
+            return DIF_ERR_FORMAT;
+    return position_image(sequence, sequence->nb_images) <= sequence->taille_images
+         ? DIF_OK : DIF_ERR_FORMAT;
+}
+
+/* Vrai si l'image `index` se décode sans la précédente (octet d'options de
+ * son en-tête étendu) ; une image tronquée est laissée au décodeur */
+static int image_intra(const SequenceDIF *sequence, uint32_t index) {
+    uint64_t debut = position_image(sequence, index);
+    if (position_image(sequence, index + 1) - debut <= 12) return 1;
+    return !(sequence->images[debut + 12] & DIF_OPTION_TEMPOREL);
+}
+
+/* Empreinte (FNV-1a) de l'en-tête et de la table d'une séquence */
+static uint64_t empreinte_sequence(const SequenceDIF *sequence) {
+    const unsigned char *octets = sequence->table - TAILLE_ENTETE_SEQUENCE;
+    size_t taille = TAILLE_ENTETE_SEQUENCE + (sequence->nb_images + (size_t)1) * sizeof(uint64_t);
+    uint64_t empreinte = 0xCBF29CE484222325u;
+    for (size_t i = 0; i < taille; i++)
+        empreinte = (empreinte ^ octets[i]) * 0x100000001B3u;
+    return empreinte;
+}
+
+static size_t octets_ligne_sequence(const SequenceDIF *sequence) {
+    return (size_t)sequence->largeur * sequence->nb_canaux * octets_echantillon(sequence->valeur_max);
+}
+
+/* Décodage de l'image `index` dans `pixels` (lignes contiguës, entrelacées) ;
+ * une image temporelle est prédite par le contenu de `pixels`, l'image
+ * précédente (`reference` vrai), et décodée sur place */
+static int decoder_image_sequence(dif_context *contexte, const SequenceDIF *sequence, uint32_t index,
+                                  unsigned char *pixels, int reference)
+{
+    uint64_t debut = position_image(sequence, index);
+    DecodeurDIF dec;
+    dec.source = (SourceOctets){ sequence->images + debut,
+                                 (size_t)(position_image(sequence, index + 1) - debut), 0, NULL };
+    int err = ouvrir_decodeur(contexte, &dec);
+    if (err != DIF_OK) return err;
+    if (dec.entete.nb_canaux != sequence->nb_canaux || dec.entete.largeur != sequence->largeur ||
+        dec.entete.hauteur != sequence->hauteur || dec.entete.valeur_max != sequence->valeur_max)
+        return DIF_ERR_FORMAT;
+    size_t octets_ligne = octets_ligne_sequence(sequence);
+    dec.reference = reference ? pixels : NULL;
+    dec.pas_reference = octets_ligne;
+    DestinationLignes image = { NULL, pixels, octets_ligne, octets_ligne, 0, 0, NULL, NULL, NULL };
+    DestinationsDIF destinations = { &image, NULL };
+    return decoder_image(contexte, &dec, &destinations, NULL);
+}
+
+/* Image `index` décodée dans la zone `sequence` du contexte, depuis la
+ * dernière image intra qui la précède, ou depuis l'image déjà décodée de la
+ * même séquence si elle est plus proche (lecture dans l'ordre : une image
+ * décodée par appel) */
+static int decoder_sequence(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                            const SequenceDIF *sequence, uint32_t index, unsigned char **pixels)
+{
+    uint32_t premiere = index;
+    while (premiere > 0 && !image_intra(sequence, premiere)) premiere--;
+    uint64_t empreinte = empreinte_sequence(sequence);
+    int suite = contexte->sequence_donnees == donnees && contexte->sequence_taille == taille &&
+                contexte->sequence_empreinte == empreinte &&
+                contexte->sequence_image >= premiere && contexte->sequence_image <= index;
+    *pixels = reserver_zone(&contexte->sequence, octets_ligne_sequence(sequence) * sequence->hauteur);
+    if (!*pixels) return DIF_ERR_ALLOC;
+    if (suite) premiere = contexte->sequence_image + 1;
+    int err = DIF_OK;
+    for (uint32_t image = premiere; image <= index && err == DIF_OK; image++) {
+        contexte->sequence_donnees = NULL;
+        err = decoder_image_sequence(contexte, sequence, image, *pixels, suite || image > premiere);
+        if (err == DIF_OK) {
+            contexte->sequence_donnees = donnees;
+            contexte->sequence_taille = taille;
+            contexte->sequence_empreinte = empreinte;
+            contexte->sequence_image = image;
+        }
+    }
+    return err;
+}
+
+/* Format et nombre d'images d'une séquence DIF en mémoire, sans la décoder */
+int dif_info_sequence(const unsigned char *donnees, size_t taille, FormatImageDIF *format,
+                      int *nb_images)
+{
+    SequenceDIF sequence;
+    if (!format) return DIF_ERR_FORMAT;
+    int err = lire_sequence(donnees, taille, &sequence);
+    if (err != DIF_OK) return err;
+    format->largeur = sequence.largeur;
+    format->hauteur = sequence.hauteur;
+    format->nb_canaux = sequence.nb_canaux;
+    format->pas = octets_ligne_sequence(&sequence);
+    format->plans = 0;
+    format->valeur_max = sequence.valeur_max;
+    if (nb_images) *nb_images = (int)sequence.nb_images;
+    return DIF_OK;
+}
+
+/* Décodage en mémoire de l'image `index` d'une séquence, avec un contexte
+ * réutilisable */
+int dif_decode_sequence_ctx(dif_context *contexte, const unsigned char *donnees, size_t taille,
+                            int index, FormatImageDIF *format, TamponDIF *sortie)
+{
+    if (!format || !sortie) return DIF_ERR_FORMAT;
+    preparer_tampon(sortie);
+    SequenceDIF sequence;
+    int err = lire_sequence(donnees, taille, &sequence);
+    if (err != DIF_OK) return err;
+    if (index < 0 || (uint32_t)index >= sequence.nb_images) return DIF_ERR_FORMAT;
+    size_t octets = octets_echantillon(sequence.valeur_max);
+    size_t octets_ligne = octets_ligne_sequence(&sequence);
+    size_t pas, pas_plan;
+    err = verifier_format(format, sequence.largeur, sequence.hauteur, sequence.nb_canaux, octets,
+                          &pas, &pas_plan);
+    size_t taille_image = taille_format(sequence.largeur, sequence.hauteur, sequence.nb_canaux, octets,
+                                        pas, pas_plan);
+    if (err == DIF_OK)
+        err = agrandir_tampon(sortie, taille_image);
+    unsigned char *pixels = NULL;
+    if (err == DIF_OK)
+        err = decoder_sequence(contexte, donnees, taille, &sequence, (uint32_t)index, &pixels);
+    if (err == DIF_OK) {
+        const NoyauxDIF *noyaux = noyaux_dif();
+        for (int ligne = 0; ligne < sequence.hauteur; ligne++) {
+            const unsigned char *source = pixels + (size_t)ligne * octets_ligne;
+            unsigned char *cible = sortie->donnees + (size_t)ligne * pas;
+            if (pas_plan) {
+                unsigned char *const plans[3] = { cible, cible + pas_plan, cible + 2 * pas_plan };
+                noyaux->separer_plans(source, (size_t)sequence.largeur, plans);
+            } else {
+                memcpy(cible, source, octets_ligne);
+            }
+        }
+        sortie->taille = taille_image;
+    }
+    format->largeur = sequence.largeur;
+    format->hauteur = sequence.hauteur;
+    format->nb_canaux = sequence.nb_canaux;
+    format->pas = pas;
+    format->valeur_max = sequence.valeur_max;
+    return err;
+}
+
+/* Décodage en mémoire de l'image `index` d'une séquence */
+int dif_decode_sequence(const unsigned char *donnees, size_t taille, int index, FormatImageDIF *format,
+                        TamponDIF *sortie, const OptionsDIF *options)
+{
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = dif_decode_sequence_ctx(&contexte, donnees, taille, index, format, sortie);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Encodeur de séquence : en-tête écrit, puis une image à la fois ; la
+ * table des positions des images est réécrite à la fin */
+typedef struct {
+    FluxBits *flux;
+    SequenceDIF sequence;
+    size_t debut_table;     /* positions dans le flux */
+    size_t debut_images;
+    uint64_t *positions;
+} EncodeurSequence;
+
+static int commencer_sequence(dif_context *contexte, EncodeurSequence *encodeur, FluxBits *flux,
+                              int largeur, int hauteur, int nb_canaux, int valeur_max, int nb_images)
+{
+    int intervalle = contexte->options.intervalle_cles;
+    if (intervalle <= 0) intervalle = DIF_INTERVALLE_CLES;
+    if (intervalle > 65535) intervalle = 65535;
+    SequenceDIF *sequence = &encodeur->sequence;
+    *sequence = (SequenceDIF){ nb_canaux, largeur, hauteur, valeur_max, intervalle,
+                               (uint32_t)nb_images, NULL, NULL, 0 };
+    size_t taille_table = ((size_t)nb_images + 1) * sizeof(uint64_t);
+    encodeur->flux = flux;
+    encodeur->positions = reserver_zone(&contexte->images, taille_table);
+    if (!encodeur->positions) return DIF_ERR_ALLOC;
+    memset(encodeur->positions, 0, taille_table);
+    uint8_t entete[TAILLE_ENTETE_SEQUENCE];
+    uint16_t champs[5] = { DIF_MAGIC_SEQUENCE, (uint16_t)largeur, (uint16_t)hauteur,
+                           (uint16_t)valeur_max, (uint16_t)intervalle };
+    uint32_t nombre = (uint32_t)nb_images;
+    memcpy(entete, &champs[0], 2);
+    entete[2] = DIF_VERSION_SEQUENCE;
+    entete[3] = (uint8_t)nb_canaux;
+    memcpy(entete + 4, &champs[1], 8);
+    memcpy(entete + 12, &nombre, 4);
+    int err = ecrire_octets(flux, entete, sizeof entete);
+    encodeur->debut_table = position_flux(flux);
+    if (err == DIF_OK) err = ecrire_octets(flux, encodeur->positions, taille_table);
+    encodeur->debut_images = position_flux(flux);
+    return err;
+}
+
+/* Encodage de l'image `index`, prédite par `precedente` (même format) si
+ * ce n'est pas une image intra imposée par l'intervalle */
+static int ajouter_image_sequence(dif_context *contexte, EncodeurSequence *encodeur, SourceLignes *source,
+                                  const SourceLignes *precedente, int index)
+{
+    const SequenceDIF *sequence = &encodeur->sequence;
+    source->reference = NULL;
+    if (index % sequence->intervalle_cles != 0) {
+        /* échantillons de l'image précédente tels quels (sans décorrélation) */
+        SourceLignes lignes = *precedente;
+        lignes.decorrelation = 0;
+        if (!source_par_bloc(&lignes)) {
+            source->reference = lignes.pixels;
+            source->pas_reference = lignes.pas;
+        } else {
+            /* plans séparés : image précédente entrelacée dans la zone du contexte */
+            unsigned char *reference = reserver_zone(&contexte->reference,
+                                                     lignes.octets_ligne * sequence->hauteur);
+            if (!reference) return DIF_ERR_ALLOC;
+            for (int ligne = 0; ligne < sequence->hauteur; ligne++)
+                preparer_ligne(&lignes, ligne, reference + (size_t)ligne * lignes.octets_ligne);
+            source->reference = reference;
+            source->pas_reference = lignes.octets_ligne;
+        }
+    }
+    int err = encoder_bandes(contexte, source, encodeur->flux, sequence->largeur, sequence->hauteur,
+                             sequence->nb_canaux, 0);
+    encodeur->positions[index + 1] = position_flux(encodeur->flux) - encodeur->debut_images;
+    return err;
+}
+
+static int terminer_sequence(EncodeurSequence *encodeur) {
+    int err = vider_flux(encodeur->flux);
+    if (err == DIF_OK)
+        err = reecrire_flux(encodeur->flux, encodeur->debut_table, encodeur->positions,
+                            (encodeur->sequence.nb_images + (size_t)1) * sizeof(uint64_t));
+    return err;
+}
+
+/* Encodage d'une séquence d'images en mémoire (même format pour toutes),
+ * avec un contexte réutilisable */
+int dif_encode_sequence_ctx(dif_context *contexte, const unsigned char *const *images, int nb_images,
+                            const FormatImageDIF *format, TamponDIF *sortie)
+{
+    size_t pas, pas_plan;
+    if (!images || !format || !sortie || nb_images <= 0) return DIF_ERR_FORMAT;
+    sortie->taille = 0;
+    int valeur_max = format->valeur_max ? format->valeur_max : 255;
+    if (valeur_max < 255 || valeur_max > 65535) return DIF_ERR_FORMAT;
+    size_t octets = octets_echantillon(valeur_max);
+    int err = verifier_format(format, format->largeur, format->hauteur, format->nb_canaux, octets,
+                              &pas, &pas_plan);
+    if (err != DIF_OK) return err;
+    FluxBits flux;
+    initialiser_flux_tampon(&flux, sortie);
+    EncodeurSequence encodeur;
+    err = commencer_sequence(contexte, &encodeur, &flux, format->largeur, format->hauteur,
+                             format->nb_canaux, valeur_max, nb_images);
+    SourceLignes sources[2];
+    for (int index = 0; index < nb_images && err == DIF_OK; index++) {
+        SourceLignes *source = &sources[index % 2];
+        *source = (SourceLignes){ NULL, images[index], pas,
+                                  (size_t)format->largeur * format->nb_canaux * octets, pas_plan,
+                                  0, 1, valeur_max, 0, NULL, NULL, 0 };
+        if (!images[index])
+            err = DIF_ERR_FORMAT;
+        else
+            err = ajouter_image_sequence(contexte, &encodeur, source, &sources[(index + 1) % 2], index);
+    }
+    if (err == DIF_OK) err = terminer_sequence(&encodeur);
+    if (err == DIF_OK) sortie->taille = flux.position;
+    return err;
+}
+
+/* Encodage d'une séquence d'images en mémoire */
+int dif_encode_sequence(const unsigned char *const *images, int nb_images, const FormatImageDIF *format,
+                        TamponDIF *sortie, const OptionsDIF *options)
+{
+    dif_context contexte;
+    initialiser_contexte(&contexte, options);
+    int err = dif_encode_sequence_ctx(&contexte, images, nb_images, format, sortie);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Encodage d'une séquence depuis des fichiers image (formats de lire_image,
+ * mêmes dimensions et type) avec un contexte réutilisable : deux images
+ * seulement en mémoire à la fois, la courante et sa prédiction */
+int pnmtodif_sequence_ctx(dif_context *contexte, const char *const *chemins_images, int nb_images,
+                          const char *chemin_dif)
+{
+    if (!chemins_images || nb_images <= 0) return DIF_ERR_FORMAT;
+    ImagePNM images[2] = {{0}};
+    int err = lire_image(chemins_images[0], &images[0]);
+    if (err != DIF_OK) return err;
+    int largeur = images[0].largeur, hauteur = images[0].hauteur, nb_canaux = images[0].type;
+    int valeur_max = images[0].valeur_max > 255 ? images[0].valeur_max : 255;
+    size_t octets_ligne = (size_t)largeur * nb_canaux * octets_echantillon(valeur_max);
+    FILE *fichier = ouvrir_sortie(chemin_dif);
+    if (!fichier) {
+        liberer_pnm(&images[0]);
+        return DIF_ERR_IO;
+    }
+    /* table des images réécrite à la fin : vers un tube, encodage en mémoire */
+    TamponDIF memoire = {0};
+    FluxBits flux;
+    if (chemin_standard(chemin_dif) || !sortie_positionnable(fichier)) {
+        initialiser_flux_tampon(&flux, &memoire);
+    } else {
+        err = initialiser_flux_ecriture(&flux, &contexte->fichier, DIF_TAILLE_TAMPON);
+        flux.fichier = fichier;
+    }
+    EncodeurSequence encodeur;
+    if (err == DIF_OK)
+        err = commencer_sequence(contexte, &encodeur, &flux, largeur, hauteur, nb_canaux, valeur_max,
+                                 nb_images);
+    SourceLignes sources[2];
+    for (int index = 0; index < nb_images && err == DIF_OK; index++) {
+        ImagePNM *image = &images[index % 2];
+        if (index > 0) {
+            liberer_pnm(image);
+            err = lire_image(chemins_images[index], image);
+            if (err == DIF_OK &&
+                (image->largeur != largeur || image->hauteur != hauteur || image->type != nb_canaux ||
+                 (image->valeur_max > 255 ? image->valeur_max : 255) != valeur_max))
+                err = DIF_ERR_FORMAT;
+            if (err != DIF_OK) break;
+        }
+        sources[index % 2] = (SourceLignes){ NULL, image->donnees, octets_ligne, octets_ligne, 0, 0, 1,
+                                             valeur_max, 0, NULL, NULL, 0 };
+        err = ajouter_image_sequence(contexte, &encodeur, &sources[index % 2],
+                                     &sources[(index + 1) % 2], index);
+    }
+    if (err == DIF_OK) err = terminer_sequence(&encodeur);
+    if (err == DIF_OK && flux.tampon && fwrite(memoire.donnees, 1, flux.position, fichier) != flux.position)
+        err = DIF_ERR_IO;
+    free(memoire.donnees);
+    liberer_pnm(&images[0]);
+    liberer_pnm(&images[1]);
+    if (fermer_sortie(fichier, chemin_dif) != DIF_OK) err = DIF_ERR_IO;
+    if (err != DIF_OK) supprimer_sortie(chemin_dif);
+    return err;
+}
+
+/* Encodage d'une séquence depuis des fichiers image */
+int pnmtodif_sequence(const char *const *chemins_images, int nb_images, const char *chemin_dif) {
+    dif_context contexte;
+    initialiser_contexte(&contexte, NULL);
+    int err = pnmtodif_sequence_ctx(&contexte, chemins_images, nb_images, chemin_dif);
+    liberer_contexte(&contexte);
+    return err;
+}
+
+/* Vrai si `motif` contient exactement une conversion %d (largeur et
+ * remplissage par des 0 permis), les autres % étant doublés */
+static int motif_valide(const char *motif) {
+    int conversions = 0;
+    for (const char *p = motif; *p; p++) {
+        if (*p != '%') continue;
+        if (*++p == '%') continue;
+        while (*p >= '0' && *p <= '9') p++;
+        if (*p != 'd') return 0;
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+/* Écriture d'une image décodée (lignes contiguës) dans un fichier PNM */
+static int ecrire_image_pnm(dif_context *contexte, const char *chemin, const SequenceDIF *sequence,
+                            const unsigned char *pixels)
+{
+    FILE *fichier = creer_pnm(chemin, sequence->nb_canaux, sequence->largeur, sequence->hauteur,
+                              sequence->valeur_max);
+    if (!fichier) return DIF_ERR_IO;
+    size_t octets_ligne = octets_ligne_sequence(sequence);
+    size_t hauteur = (size_t)sequence->hauteur;
+    int err = DIF_OK;
+    if (sequence->valeur_max > 255) {
+        /* ordre PNM ligne par ligne : l'image sert encore de prédiction */
+        unsigned char *ligne = reserver_zone(&contexte->lignes, octets_ligne);
+        if (!ligne) err = DIF_ERR_ALLOC;
+        for (size_t y = 0; y < hauteur && err == DIF_OK; y++) {
+            ecrire_gros_boutistes16(pixels + y * octets_ligne, ligne, octets_ligne / 2);
+            if (fwrite(ligne, 1, octets_ligne, fichier) != octets_ligne) err = DIF_ERR_IO;
+        }
+    } else if (fwrite(pixels, octets_ligne, hauteur, fichier) != hauteur) {
+        err = DIF_ERR_IO;
+    }
+    if (fermer_sortie(fichier, chemin) != DIF_OK) err = DIF_ERR_IO;
+    if (err != DIF_OK) supprimer_sortie(chemin);
+    return err;
+}
+
+/* Décodage d'une séquence vers des fichiers PNM : l'image `index`, ou
+ * toutes (index < 0, chemin_pnm est alors un motif). Le fichier est lu par
+ * une seule projection ; l'entrée standard ou un tube, en entier d'abord. */
+static int decoder_sequence_vers_pnm(dif_context *contexte, const char *chemin_dif, int index,
+                                     const char *chemin_pnm)
+{
+    if (index < 0 && !motif_valide(chemin_pnm)) return DIF_ERR_FORMAT;
+    SourceOctets source;
+    if (ouvrir_source(&source, chemin_dif) != DIF_OK) return DIF_ERR_IO;
+    const unsigned char *donnees = source.donnees;
+    size_t taille = source.taille;
+    unsigned char *lu = NULL;
+    int err = DIF_OK;
+    if (source.fichier) {
+        err = lire_fichier_complet(source.fichier, &lu, &taille);
+        donnees = lu;
+    }
+    SequenceDIF sequence;
+    if (err == DIF_OK) err = lire_sequence(donnees, taille, &sequence);
+    if (err == DIF_OK && index >= 0 && (uint32_t)index >= sequence.nb_images) err = DIF_ERR_FORMAT;
+    uint32_t premiere = index < 0 ? 0 : (uint32_t)index;
+    uint32_t derniere = err != DIF_OK ? 0 : index < 0 ? sequence.nb_images - 1 : (uint32_t)index;
+    for (uint32_t image = premiere; image <= derniere && err == DIF_OK; image++) {
+        unsigned char *pixels;
+        err = decoder_sequence(contexte, donnees, taille, &sequence, image, &pixels);
+        char chemin[4096];
+        const char *sortie = chemin_pnm;
+        if (err == DIF_OK && index < 0) {
+            int n = snprintf(chemin, sizeof chemin, chemin_pnm, (int)image);
+            if (n < 0 || (size_t)n >= sizeof chemin) err = DIF_ERR_FORMAT;
+            sortie = chemin;
+        }
+        if (err == DIF_OK) err = ecrire_image_pnm(contexte, sortie, &sequence, pixels);
+    }
+    /* les données ne survivent pas à l'appel */
+    contexte->sequence_donnees = NULL;
+    free(lu);
+    fermer_source(&source);
+    return err;
+}
+
+/* Décodage de toutes les images d'une séquence vers PNM avec un contexte
+ * réutilisable */
+int diftopnm_sequence_ctx(dif_context *contexte, const char *chemin_dif, const char *motif_pnm) {
+    return decoder_sequence_vers_pnm(contexte, chemin_dif, -1, motif_pnm);
+}
+
+/* Décodage de l'image `index` d'une séquence vers PNM */
+int diftopnm_image_sequence_ctx(dif_context *contexte, const char *chemin_dif, int index,
+                                const char *chemin_pnm)
+{
+    if (index < 0) return DIF_ERR_FORMAT;
+    return decoder_sequence_vers_pnm(contexte, chemin_dif, index, chemin_pnm);
+}
+
+/* Décodage de toutes les images d'une séquence vers PNM */
+int diftopnm_sequence(const char *chemin_dif, const char *motif_pnm) {
+    dif_context contexte;
+    initialiser_contexte(&contexte, NULL);
+    int err = diftopnm_sequence_ctx(&contexte, chemin_dif, motif_pnm);
+    liberer_contexte(&contexte);
+    return err;
+}
@@ -0,0 +1,210 @@
+#ifndef CODEC_INTERNE_H
+#define CODEC_INTERNE_H
+#include "../include/codec.h"
+#include <stdio.h>
+
+/* Déclarations internes à la bibliothèque (partagées avec les benchmarks) */
+
+/* Nombre de bits lus d'un coup : préfixe (3) + charge utile (8),
+ * soit aussi la longueur du plus long mot de code */
+#define DIF_BITS_LUT 11
+
+/* Tailles des tampons de l'encodeur en flux (indépendantes de l'image) */
+#define DIF_TAILLE_BLOC   (1u << 18)   /* lignes brutes lues d'un coup */
+#define DIF_TAILLE_TAMPON (1u << 16)   /* flux compressé avant écriture */
+#define DIF_SEGMENT       16384        /* échantillons entre deux contrôles du tampon */
+
+/* Entrée de la table de décodage VLC */
+typedef struct {
+    uint8_t niveau;
+    uint8_t charge;
+    uint8_t longueur;   /* bits consommés (préfixe + charge) */
+    int8_t  delta;      /* delta déplié, DIF_DELTA_PLAGE pour l'annonce d'une plage */
+} EntreeVLC;
+
+/* Mode plages (DIF_MODE_PLAGES) : le symbole 0 annonce une plage de
+ * DIF_PLAGE_MIN à DIF_PLAGE_MAX deltas nuls, dont la longueur suit en
+ * Exp-Golomb d'ordre 0 (31 bits au plus) ; la valeur repliée v est codée
+ * par le symbole v + 1. Les plages ne débordent pas d'une ligne. */
+#define DIF_DELTA_PLAGE (-128)
+#define DIF_PLAGE_MIN   2
+#define DIF_PLAGE_MAX   (DIF_PLAGE_MIN + 65534)
+
+/* Delta décodé d'un symbole (valeur repliée, ou annonce de plage) */
+static inline int8_t delta_symbole(unsigned int symbole, int plages) {
+    if (!plages) return (int8_t)deplier_delta((unsigned char)symbole);
+    return symbole ? (int8_t)deplier_delta((unsigned char)(symbole - 1)) : DIF_DELTA_PLAGE;
+}
+
+/* Table indexée par les DIF_BITS_LUT prochains bits du flux */
+typedef struct {
+    EntreeVLC entrees[1 << DIF_BITS_LUT];
+} TableVLC;
+
+/* Lecteur de bits avec réservoir 64 bits (bits alignés à gauche).
+ * Les données viennent soit d'un tampon complet, soit d'un fichier lu par blocs. */
+typedef struct {
+    const unsigned char *donnees;
+    size_t taille;
+    size_t position;
+    uint64_t reservoir;
+    int bits_disponibles;
+    size_t octets_fantomes;   /* octets nuls ajoutés après la fin du flux */
+    FILE *fichier;            /* source des blocs suivants (NULL une fois épuisée) */
+    unsigned char *bloc;
+    size_t capacite;
+} LecteurBits;
+
+/* Table d'encodage : mot de code complet (préfixe puis charge) par valeur repliée */
+typedef struct {
+    uint16_t code[256];
+    uint8_t longueur[256];
+} TableCodes;
+
+/* Pool de threads (parallele.c) */
+typedef struct PoolThreads PoolThreads;
+int nombre_coeurs(void);
+PoolThreads *creer_pool(int nb_threads);
+int taille_pool(const PoolThreads *pool);
+void executer_pool(PoolThreads *pool, int nb_taches,
+                   void (*tache)(void *contexte, int index), void *contexte);
+void detruire_pool(PoolThreads *pool);
+
+/* Noyaux vectorisables (noyaux.c), choisis à l'exécution selon le processeur */
+enum { DIF_NOYAUX_SCALAIRE, DIF_NOYAUX_SSE2, DIF_NOYAUX_AVX2 };
+typedef struct {
+    const char *nom;
+    /* valeurs repliées des différences avec l'échantillon nb_canaux plus tôt,
+     * échantillons décalés de `decalage` bits (1 : réduits, 0 : sans perte) */
+    void (*replier_differences)(const uint8_t *donnees, size_t n, int nb_canaux, int decalage,
+                                uint8_t *replies);
+    /* valeurs repliées des résidus du prédicteur MED (ligne précédente fournie) */
+    void (*replier_residus_med)(const uint8_t *ligne, const uint8_t *precedente, size_t n,
+                                int nb_canaux, int decalage, uint8_t *replies);
+    /* valeurs repliées des écarts avec la même ligne de l'image précédente
+     * (séquences, DIF_OPTION_TEMPOREL) */
+    void (*replier_ecarts_temporels)(const uint8_t *ligne, const uint8_t *reference, size_t n,
+                                     int decalage, uint8_t *replies);
+    /* image différentielle 255 - |4 delta| */
+    void (*visualiser_deltas)(const int8_t *deltas, uint8_t *sortie, size_t n);
+    /* échantillons restaurés 2v limités à [0,255] */
+    void (*restaurer_valeurs)(const int32_t *valeurs, uint8_t *sortie, size_t n);
+    /* mode sans perte : échantillons v modulo 256 */
+    void (*tronquer_valeurs)(const int32_t *valeurs, uint8_t *sortie, size_t n);
+    /* pixels RGB entrelacés vers trois plans, et inversement */
+    void (*separer_plans)(const uint8_t *entrelace, size_t nb_pixels, uint8_t *const plans[3]);
+    void (*entrelacer_plans)(const uint8_t *const plans[3], size_t nb_pixels, uint8_t *entrelace);
+    /* décorrélation G, R - G, B - G des pixels RGB (source et destination
+     * peuvent être confondues) et son inverse sur place */
+    void (*decorreler_couleurs)(const uint8_t *source, uint8_t *destination, size_t nb_pixels,
+                                int decalage);
+    void (*recorreler_couleurs)(uint8_t *pixels, size_t nb_pixels, int decalage);
+    /* vignettes : somme de chaque canal sur chaque bloc de `facteur` pixels
+     * (2, 4 ou 8, dernier bloc tronqué) ajoutée à sommes[canal * pas_plan + bloc] */
+    void (*sommer_blocs)(const uint8_t *ligne, size_t nb_pixels, int nb_canaux, int facteur,
+                         uint16_t *sommes, size_t pas_plan);
+    /* échantillons sur 16 bits : mêmes repliements sur 16 bits, et
+     * restauration 2v limitée à [0,65534] (v modulo 65536 si `decalage` nul) */
+    void (*replier_differences16)(const uint16_t *donnees, size_t n, int nb_canaux, int decalage,
+                                  uint16_t *replies);
+    void (*replier_residus_med16)(const uint16_t *ligne, const uint16_t *precedente, size_t n,
+                                  int nb_canaux, int decalage, uint16_t *replies);
+    void (*replier_ecarts_temporels16)(const uint16_t *ligne, const uint16_t *reference, size_t n,
+                                       int decalage, uint16_t *replies);
+    void (*restaurer_valeurs16)(const int32_t *valeurs, uint16_t *sortie, size_t n, int decalage);
+} NoyauxDIF;
+const NoyauxDIF *noyaux_niveau(int niveau);
+const NoyauxDIF *noyaux_dif(void);
+
+/* Version de l'en-tête étendu (magic DIF_MAGIC_*_EXT) */
+#define DIF_VERSION_ETENDUE 1
+/* Modes reconnus par le décodeur ; tout autre bit d'options est refusé */
+#define DIF_MODES_CONNUS (DIF_MODE_MED | DIF_MODE_DECORRELATION | DIF_MODE_PLAGES | \
+                          DIF_MODE_HUFFMAN | DIF_MODE_SANS_PERTE)
+/* Bit d'options posé par l'encodeur (pas un mode) : échantillons sur 16
+ * bits, valeur maximale sur 2 octets après l'en-tête étendu */
+#define DIF_OPTION_16BITS 0x20u
+/* Bit d'options posé par l'encodeur de séquences (pas un mode) : chaque
+ * échantillon est prédit par l'échantillon co-localisé de l'image
+ * précédente ; exclut les prédictions intra MED et la décorrélation, pas
+ * de pixels initiaux en tête des bandes */
+#define DIF_OPTION_TEMPOREL 0x40u
+/* Modes compatibles avec la prédiction temporelle */
+#define DIF_MODES_TEMPORELS (DIF_MODE_PLAGES | DIF_MODE_HUFFMAN | DIF_MODE_SANS_PERTE)
+/* Modes compatibles avec les échantillons sur 16 bits */
+#define DIF_MODES_16BITS (DIF_MODE_MED | DIF_MODE_SANS_PERTE)
+/* Sous-flux entrelacés d'une bande en mode DIF_MODE_HUFFMAN : le symbole
+ * k de la bande est codé dans le sous-flux k % DIF_SOUS_FLUX, que le
+ * décodeur lit de front (chaînes de dépendances indépendantes) */
+#define DIF_SOUS_FLUX 4
+/* Hauteur des bandes quand un mode impose le fichier étendu sans -b */
+#define DIF_HAUTEUR_BANDE_MODES 128
+/* Version de l'en-tête des séquences (magic DIF_MAGIC_SEQUENCE) et
+ * intervalle par défaut entre deux images intra (points d'entrée du décodage) */
+#define DIF_VERSION_SEQUENCE 1
+#define DIF_INTERVALLE_CLES 32
+
+/* plages non nul : symboles du mode DIF_MODE_PLAGES */
+int construire_table_vlc(TableVLC *table, const uint8_t bits_niveaux[4], int plages);
+int construire_table_codes(TableCodes *table, const uint8_t bits_niveaux[4]);
+
+/* Codes de Huffman canoniques (huffman.c) : longueurs de 1 à DIF_BITS_LUT
+ * bits par symbole, rangées sur 4 bits dans l'en-tête étendu */
+#define DIF_TAILLE_LONGUEURS 128
+void longueurs_huffman(const uint64_t histogramme[256], uint8_t longueurs[256]);
+int construire_codes_huffman(TableCodes *table, const uint8_t longueurs[256]);
+int construire_table_vlc_huffman(TableVLC *table, const uint8_t longueurs[256], int plages);
+void initialiser_lecteur(LecteurBits *lecteur, const unsigned char *donnees, size_t taille);
+void initialiser_lecteur_fichier(LecteurBits *lecteur, FILE *fichier,
+                                 unsigned char *bloc, size_t capacite);
+void recharger_lecteur(LecteurBits *lecteur);
+
+/* Lecture complète d'un fichier ouvert, tube compris (formats.c) */
+int lire_fichier_complet(FILE *fichier, unsigned char **donnees, size_t *taille);
+
+/* Octets d'un fichier (DIF ou PNM) : projection en mémoire, tampon de
+ * l'appelant ou fichier lu séquentiellement */
+typedef struct {
+    const unsigned char *donnees;
+    size_t taille;
+    size_t position;
+    FILE *fichier;
+} SourceOctets;
+
+/* Caractère suivant de la source, EOF à la fin */
+static inline int caractere_suivant(SourceOctets *source) {
+    if (source->fichier) return fgetc(source->fichier);
+    return source->position < source->taille ? source->donnees[source->position++] : EOF;
+}
+
+/* En-têtes PNM et PAM, partagés par le codec et les lecteurs d'images
+ * (codec.c) : valeur maximale de 1 à 65535, la source est laissée sur le
+ * premier pixel */
+int ignorer_commentaires(SourceOctets *source);
+int lire_entier_pnm(SourceOctets *source, int *valeur);
+int lire_entete_pnm(SourceOctets *source, int *largeur, int *hauteur, int *nb_canaux,
+                    int *valeur_max, int *ascii);
+
+/* Échantillon lu avec une valeur maximale `maximum` inférieure à 255,
+ * ramené sur 0..255 */
+static inline unsigned char ramener_echantillon(unsigned int valeur, unsigned int maximum) {
+    if (valeur > maximum) valeur = maximum;
+    return (unsigned char)((valeur * 255 + maximum / 2) / maximum);
+}
+
+/* Décodage d'un symbole : un accès table, un décalage */
+static inline const EntreeVLC *lire_symbole(LecteurBits *lecteur, const TableVLC *table) {
+    if (lecteur->bits_disponibles < DIF_BITS_LUT)
+        recharger_lecteur(lecteur);
+    const EntreeVLC *entree = &table->entrees[lecteur->reservoir >> (64 - DIF_BITS_LUT)];
+    lecteur->reservoir <<= entree->longueur;
+    lecteur->bits_disponibles -= entree->longueur;
+    return entree;
+}
+
+/* Vrai si le décodage a consommé des bits au-delà de la fin du flux */
+static inline int lecteur_depasse(const LecteurBits *lecteur) {
+    return (size_t)lecteur->bits_disponibles < 8 * lecteur->octets_fantomes;
+}
+
+#endif
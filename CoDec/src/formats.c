@@ -0,0 +1,420 @@
+#include "codec_interne.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Lecture en mémoire des formats d'image courants vers ImagePNM, sans
+ * conversion externe : PNM binaires et ASCII (P2, P3, P5, P6), PAM (P7),
+ * BMP non compressé et TGA (brut ou RLE). Une valeur maximale inférieure à
+ * 255 est ramenée à 255, au-delà les échantillons restent sur 16 bits ; la
+ * transparence est ignorée. */
+
+static inline uint16_t lire16(const unsigned char *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t lire32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* Contenu d'un fichier ouvert, lu jusqu'à sa fin (tube compris) dans un
+ * tampon alloué */
+int lire_fichier_complet(FILE *fichier, unsigned char **donnees, size_t *taille) {
+    struct stat st;
+    size_t capacite = 1 << 16, lus = 0;
+    if (fstat(fileno(fichier), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        capacite = (size_t)st.st_size + 1;
+    unsigned char *tampon = NULL;
+    int err = DIF_OK;
+    for (;;) {
+        if (lus == capacite || !tampon) {
+            if (tampon) capacite *= 2;
+            unsigned char *agrandi = realloc(tampon, capacite);
+            if (!agrandi) {
+                err = DIF_ERR_ALLOC;
+                break;
+            }
+            tampon = agrandi;
+        }
+        size_t n = fread(tampon + lus, 1, capacite - lus, fichier);
+        lus += n;
+        if (n == 0) {
+            if (ferror(fichier)) err = DIF_ERR_IO;
+            break;
+        }
+    }
+    if (err != DIF_OK) {
+        free(tampon);
+        return err;
+    }
+    *donnees = tampon;
+    *taille = lus;
+    return DIF_OK;
+}
+
+/* Contenu complet d'un fichier (entrée standard pour "-") dans un tampon alloué */
+static int charger_fichier(const char *chemin, unsigned char **donnees, size_t *taille) {
+    int standard = !strcmp(chemin, "-");
+    FILE *fichier = standard ? stdin : fopen(chemin, "rb");
+    if (!fichier) return DIF_ERR_IO;
+    int err = lire_fichier_complet(fichier, donnees, taille);
+    if (!standard) fclose(fichier);
+    return err;
+}
+
+/* Allocation des échantillons d'une image (dimensions limitées à 65535 comme
+ * pour les PNM) ; valeur maximale de l'image 255, ou `maximum` au-delà */
+static int creer_image(ImagePNM *image, long largeur, long hauteur, int nb_canaux, unsigned int maximum) {
+    if (largeur <= 0 || hauteur <= 0 || largeur > 65535 || hauteur > 65535)
+        return DIF_ERR_FORMAT;
+    image->largeur = (uint16_t)largeur;
+    image->hauteur = (uint16_t)hauteur;
+    image->type = (uint8_t)nb_canaux;
+    image->valeur_max = (uint16_t)(maximum > 255 ? maximum : 255);
+    size_t octets = image->valeur_max > 255 ? 2 : 1;
+    image->donnees = malloc((size_t)largeur * hauteur * nb_canaux * octets);
+    return image->donnees ? DIF_OK : DIF_ERR_ALLOC;
+}
+
+/* Rangement de l'échantillon `index` lu avec la valeur maximale `maximum` */
+static inline void ranger_echantillon(ImagePNM *image, size_t index, unsigned int valeur,
+                                      unsigned int maximum)
+{
+    if (valeur > maximum) valeur = maximum;
+    if (image->valeur_max > 255)
+        ((uint16_t *)image->donnees)[index] = (uint16_t)valeur;
+    else if (maximum == 255)
+        image->donnees[index] = (unsigned char)valeur;
+    else
+        image->donnees[index] = ramener_echantillon(valeur, maximum);
+}
+
+/* ---------- PNM et PAM ---------- */
+
+/* Mot suivant d'un en-tête PAM, tronqué à `taille` - 1 caractères ; renvoie
+ * le blanc qui le termine, consommé */
+static int lire_mot(SourceOctets *lecture, char *mot, size_t taille) {
+    size_t longueur = 0;
+    int caractere = ignorer_commentaires(lecture);
+    while (caractere != EOF && !isspace(caractere)) {
+        if (longueur + 1 < taille) mot[longueur++] = (char)caractere;
+        caractere = caractere_suivant(lecture);
+    }
+    mot[longueur] = '\0';
+    return caractere;
+}
+
+/* Échantillons d'un PNM ou PAM : `profondeur` échantillons par pixel dans le
+ * fichier, dont les nb_canaux premiers sont gardés (sans la transparence) */
+static int lire_echantillons_pnm(SourceOctets *lecture, ImagePNM *image, int profondeur,
+                                 unsigned int maximum, int ascii)
+{
+    int nb_canaux = image->type;
+    size_t nb_pixels = (size_t)image->largeur * image->hauteur;
+    size_t octets = maximum > 255 ? 2 : 1;
+    if (!ascii && (lecture->taille - lecture->position) / octets / profondeur < nb_pixels)
+        return DIF_ERR_FORMAT;
+    const unsigned char *p = lecture->donnees + lecture->position;
+    size_t index = 0;
+    for (size_t pixel = 0; pixel < nb_pixels; pixel++)
+        for (int canal = 0; canal < profondeur; canal++) {
+            unsigned int valeur;
+            if (ascii) {
+                int entier;
+                if (!lire_entier_pnm(lecture, &entier)) return DIF_ERR_FORMAT;
+                valeur = (unsigned int)entier;
+            } else {
+                valeur = octets == 2 ? (unsigned int)(p[0] << 8 | p[1]) : p[0];
+                p += octets;
+            }
+            if (canal < nb_canaux)
+                ranger_echantillon(image, index++, valeur, maximum);
+        }
+    return DIF_OK;
+}
+
+/* PNM binaire ou ASCII, gris ou couleur (en-tête lu comme par le codec) */
+static int lire_pnm_memoire(SourceOctets *lecture, ImagePNM *image) {
+    int largeur, hauteur, nb_canaux, maximum, ascii;
+    int err = lire_entete_pnm(lecture, &largeur, &hauteur, &nb_canaux, &maximum, &ascii);
+    if (err != DIF_OK) return err;
+    err = creer_image(image, largeur, hauteur, nb_canaux, (unsigned int)maximum);
+    if (err != DIF_OK) return err;
+    return lire_echantillons_pnm(lecture, image, nb_canaux, (unsigned int)maximum, ascii);
+}
+
+/* PAM : profondeur 1 ou 2 (gris, avec transparence), 3 ou 4 (RGB, avec
+ * transparence) ; le type de tuple n'est pas vérifié */
+static int lire_pam(SourceOctets *lecture, ImagePNM *image) {
+    int largeur = 0, hauteur = 0, profondeur = 0, maximum = 0;
+    char mot[16];
+    lecture->position = 2;
+    for (;;) {
+        int fin = lire_mot(lecture, mot, sizeof mot);
+        if (!mot[0]) return DIF_ERR_FORMAT;
+        if (!strcmp(mot, "ENDHDR")) break;   /* blanc unique avant les pixels */
+        int *champ = !strcmp(mot, "WIDTH") ? &largeur : !strcmp(mot, "HEIGHT") ? &hauteur
+                   : !strcmp(mot, "DEPTH") ? &profondeur : !strcmp(mot, "MAXVAL") ? &maximum : NULL;
+        if (champ) {
+            if (!lire_entier_pnm(lecture, champ)) return DIF_ERR_FORMAT;
+        } else if (fin != '\n') {
+            while (lecture->position < lecture->taille && lecture->donnees[lecture->position] != '\n')
+                lecture->position++;
+        }
+    }
+    if (profondeur < 1 || profondeur > 4 || maximum < 1 || maximum > 65535)
+        return DIF_ERR_FORMAT;
+    int err = creer_image(image, largeur, hauteur, profondeur >= 3 ? 3 : 1, (unsigned int)maximum);
+    if (err != DIF_OK) return err;
+    return lire_echantillons_pnm(lecture, image, profondeur, (unsigned int)maximum, 0);
+}
+
+/* ---------- BMP ---------- */
+
+/* Masque d'une composante des pixels de 16 ou 32 bits */
+typedef struct {
+    uint32_t masque;
+    int decalage;
+    uint32_t maximum;
+} MasqueBMP;
+
+static MasqueBMP preparer_masque(uint32_t masque) {
+    MasqueBMP resultat = { masque, 0, 0 };
+    if (!masque) return resultat;
+    while (!(masque >> resultat.decalage & 1)) resultat.decalage++;
+    resultat.maximum = masque >> resultat.decalage;
+    return resultat;
+}
+
+/* Composante d'un pixel selon son masque, ramenée sur 8 bits */
+static inline unsigned char composante_masque(uint32_t pixel, const MasqueBMP *masque) {
+    if (!masque->maximum) return 0;
+    uint32_t valeur = (pixel & masque->masque) >> masque->decalage;
+    if (masque->maximum == 255) return (unsigned char)valeur;
+    return (unsigned char)(((uint64_t)valeur * 255 + masque->maximum / 2) / masque->maximum);
+}
+
+/* BMP sans compression (BI_RGB) ou à masques (BI_BITFIELDS) : 1, 4 ou 8
+ * bits avec palette (gris si la palette l'est), 16, 24 ou 32 bits ; lignes
+ * de bas en haut, ou de haut en bas pour une hauteur négative */
+static int lire_bmp(SourceOctets *lecture, ImagePNM *image) {
+    const unsigned char *d = lecture->donnees;
+    if (lecture->taille < 54) return DIF_ERR_FORMAT;
+    uint32_t debut_pixels = lire32(d + 10), taille_entete = lire32(d + 14);
+    if (taille_entete < 40) return DIF_ERR_UNIMPLEMENTED;   /* en-tête OS/2 */
+    long largeur = (int32_t)lire32(d + 18), hauteur = (int32_t)lire32(d + 22);
+    int bits = lire16(d + 28);
+    uint32_t compression = lire32(d + 30), nb_couleurs = lire32(d + 46);
+    int descendant = hauteur < 0;
+    if (descendant) hauteur = -hauteur;
+
+    uint32_t masques[3] = { 0x7C00, 0x03E0, 0x001F };
+    if (bits == 32) {
+        masques[0] = 0xFF0000;
+        masques[1] = 0xFF00;
+        masques[2] = 0xFF;
+    }
+    if (compression == 3 && (bits == 16 || bits == 32)) {
+        if (lecture->taille < 14 + 40 + 12) return DIF_ERR_FORMAT;
+        for (int i = 0; i < 3; i++)
+            masques[i] = lire32(d + 14 + 40 + 4 * i);
+    } else if (compression != 0) {
+        return DIF_ERR_UNIMPLEMENTED;   /* RLE, JPEG ou PNG intégrés */
+    }
+    if (bits != 1 && bits != 4 && bits != 8 && bits != 16 && bits != 24 && bits != 32)
+        return DIF_ERR_UNIMPLEMENTED;
+
+    MasqueBMP composantes[3];
+    for (int i = 0; i < 3; i++)
+        composantes[i] = preparer_masque(masques[i]);
+    size_t debut_palette = (size_t)14 + taille_entete;
+    const unsigned char *palette = d + debut_palette;
+    int gris = 0;
+    if (bits <= 8) {
+        if (nb_couleurs == 0 || nb_couleurs > (1u << bits)) nb_couleurs = 1u << bits;
+        if (debut_palette > lecture->taille || (lecture->taille - debut_palette) / 4 < nb_couleurs)
+            return DIF_ERR_FORMAT;
+        gris = 1;
+        for (uint32_t i = 0; i < nb_couleurs && gris; i++)
+            gris = palette[4 * i] == palette[4 * i + 1] && palette[4 * i] == palette[4 * i + 2];
+    }
+    if (largeur <= 0 || largeur > 65535 || hauteur <= 0 || hauteur > 65535) return DIF_ERR_FORMAT;
+    size_t pas = ((size_t)largeur * bits + 31) / 32 * 4;
+    if (debut_pixels > lecture->taille || (lecture->taille - debut_pixels) / pas < (size_t)hauteur)
+        return DIF_ERR_FORMAT;
+    int err = creer_image(image, largeur, hauteur, gris ? 1 : 3, 255);
+    if (err != DIF_OK) return err;
+
+    for (long y = 0; y < hauteur; y++) {
+        const unsigned char *ligne = d + debut_pixels + (size_t)(descendant ? y : hauteur - 1 - y) * pas;
+        unsigned char *cible = image->donnees + (size_t)y * largeur * image->type;
+        for (long x = 0; x < largeur; x++) {
+            if (bits <= 8) {
+                size_t bit = (size_t)x * bits;
+                uint32_t index = (ligne[bit / 8] >> (8 - bits - bit % 8)) & ((1u << bits) - 1);
+                if (index >= nb_couleurs) index = 0;
+                const unsigned char *couleur = palette + 4 * index;
+                if (gris) {
+                    *cible++ = couleur[0];
+                } else {
+                    *cible++ = couleur[2];
+                    *cible++ = couleur[1];
+                    *cible++ = couleur[0];
+                }
+            } else if (bits == 24) {
+                const unsigned char *p = ligne + 3 * x;
+                *cible++ = p[2];
+                *cible++ = p[1];
+                *cible++ = p[0];
+            } else {
+                uint32_t pixel = bits == 16 ? lire16(ligne + 2 * x) : lire32(ligne + 4 * x);
+                for (int canal = 0; canal < 3; canal++)
+                    *cible++ = composante_masque(pixel, &composantes[canal]);
+            }
+        }
+    }
+    return DIF_OK;
+}
+
+/* ---------- TGA ---------- */
+
+/* Vrai si l'en-tête TGA (sans signature) est plausible */
+static int est_tga(const unsigned char *d, size_t taille) {
+    if (taille < 18 || d[1] > 1 || (d[17] & 0xC0)) return 0;
+    int type = d[2] & 7, bits = d[16];
+    if ((d[2] & ~8) < 1 || (d[2] & ~8) > 3 || lire16(d + 12) == 0 || lire16(d + 14) == 0)
+        return 0;
+    if (type == 1)
+        return d[1] == 1 && (bits == 8 || bits == 16) &&
+               (d[7] == 15 || d[7] == 16 || d[7] == 24 || d[7] == 32);
+    if (type == 2)
+        return bits == 15 || bits == 16 || bits == 24 || bits == 32;
+    return bits == 8 || bits == 16;
+}
+
+/* Couleur d'un pixel TGA de `octets` octets (BGR, BGRA ou ARGB 1555) */
+static inline void couleur_tga(const unsigned char *p, int octets, unsigned char rgb[3]) {
+    if (octets == 2) {
+        uint16_t pixel = lire16(p);
+        for (int canal = 0; canal < 3; canal++) {
+            unsigned int valeur = pixel >> (10 - 5 * canal) & 31;
+            rgb[canal] = (unsigned char)(valeur << 3 | valeur >> 2);
+        }
+    } else {
+        rgb[0] = p[2];
+        rgb[1] = p[1];
+        rgb[2] = p[0];
+    }
+}
+
+/* Pixels RLE décompressés dans `pixels` (paquets répétés ou bruts de 1 à
+ * 128 pixels) */
+static int decompresser_tga(SourceOctets *lecture, unsigned char *pixels, size_t nb_pixels, int octets) {
+    const unsigned char *d = lecture->donnees;
+    size_t position = lecture->position;
+    for (size_t pixel = 0; pixel < nb_pixels; ) {
+        if (position >= lecture->taille) return DIF_ERR_FORMAT;
+        int entete = d[position++];
+        size_t nombre = (size_t)(entete & 0x7F) + 1;
+        if (nombre > nb_pixels - pixel) return DIF_ERR_FORMAT;
+        size_t lus = (entete & 0x80) ? (size_t)octets : nombre * octets;
+        if (lecture->taille - position < lus) return DIF_ERR_FORMAT;
+        if (entete & 0x80)
+            for (size_t i = 0; i < nombre; i++)
+                memcpy(pixels + (pixel + i) * octets, d + position, (size_t)octets);
+        else
+            memcpy(pixels + pixel * octets, d + position, lus);
+        position += lus;
+        pixel += nombre;
+    }
+    return DIF_OK;
+}
+
+/* TGA brut ou RLE : couleurs indexées, RGB 15 à 32 bits, gris 8 bits (ou
+ * 16 avec transparence) ; origine en bas à gauche sauf indication contraire */
+static int lire_tga(SourceOctets *lecture, ImagePNM *image) {
+    const unsigned char *d = lecture->donnees;
+    int type = d[2] & 7, rle = d[2] & 8;
+    long largeur = lire16(d + 12), hauteur = lire16(d + 14);
+    int octets = (d[16] + 7) / 8;
+    size_t premiere = lire16(d + 3), nb_couleurs = lire16(d + 5);
+    int octets_couleur = (d[7] + 7) / 8;
+    const unsigned char *palette = d + 18 + d[0];
+    size_t taille_palette = d[1] ? nb_couleurs * octets_couleur : 0;
+    lecture->position = 18 + (size_t)d[0] + taille_palette;
+    if (lecture->position > lecture->taille) return DIF_ERR_FORMAT;
+
+    size_t nb_pixels = (size_t)largeur * hauteur;
+    unsigned char *decompresses = NULL;
+    const unsigned char *pixels = d + lecture->position;
+    if (rle) {
+        decompresses = malloc(nb_pixels * octets);
+        if (!decompresses) return DIF_ERR_ALLOC;
+        int err = decompresser_tga(lecture, decompresses, nb_pixels, octets);
+        if (err != DIF_OK) {
+            free(decompresses);
+            return err;
+        }
+        pixels = decompresses;
+    } else if ((lecture->taille - lecture->position) / octets < nb_pixels) {
+        return DIF_ERR_FORMAT;
+    }
+    int err = creer_image(image, largeur, hauteur, type == 3 ? 1 : 3, 255);
+    if (err != DIF_OK) {
+        free(decompresses);
+        return err;
+    }
+    int haut_en_bas = (d[17] & 0x20) != 0, droite_a_gauche = (d[17] & 0x10) != 0;
+    for (long y = 0; y < hauteur; y++) {
+        const unsigned char *ligne = pixels + (size_t)(haut_en_bas ? y : hauteur - 1 - y) * largeur * octets;
+        unsigned char *cible = image->donnees + (size_t)y * largeur * image->type;
+        for (long x = 0; x < largeur; x++) {
+            const unsigned char *p = ligne + (size_t)(droite_a_gauche ? largeur - 1 - x : x) * octets;
+            if (type == 3) {
+                *cible++ = p[0];
+                continue;
+            }
+            if (type == 1) {
+                size_t index = octets == 2 ? lire16(p) : p[0];
+                if (index >= premiere && index - premiere < nb_couleurs)
+                    couleur_tga(palette + (index - premiere) * octets_couleur, octets_couleur, cible);
+                else
+                    memset(cible, 0, 3);
+            } else {
+                couleur_tga(p, octets, cible);
+            }
+            cible += 3;
+        }
+    }
+    free(decompresses);
+    return DIF_OK;
+}
+
+/* Lecture d'une image PNM (P2, P3, P5, P6), PAM, BMP ou TGA reconnue à son
+ * contenu ; DIF_ERR_UNIMPLEMENTED pour un autre format (conversion externe) */
+int lire_image(const char *chemin, ImagePNM *image_sortie) {
+    unsigned char *donnees;
+    size_t taille;
+    int err = charger_fichier(chemin, &donnees, &taille);
+    if (err != DIF_OK) return err;
+    SourceOctets lecture = { donnees, taille, 0, NULL };
+    ImagePNM image = {0};
+    if (taille >= 2 && donnees[0] == 'P' && donnees[1] && strchr("2356", donnees[1]))
+        err = lire_pnm_memoire(&lecture, &image);
+    else if (taille >= 2 && donnees[0] == 'P' && donnees[1] == '7')
+        err = lire_pam(&lecture, &image);
+    else if (taille >= 2 && donnees[0] == 'B' && donnees[1] == 'M')
+        err = lire_bmp(&lecture, &image);
+    else if (est_tga(donnees, taille))
+        err = lire_tga(&lecture, &image);
+    else
+        err = DIF_ERR_UNIMPLEMENTED;
+    free(donnees);
+    if (err != DIF_OK) {
+        free(image.donnees);
+        return err;
+    }
+    *image_sortie = image;
+    return DIF_OK;
+}
@@ -0,0 +1,119 @@
+#include "codec_interne.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Codes de Huffman canoniques sur les 256 symboles (mode DIF_MODE_HUFFMAN) :
+ * longueurs calculées sur l'histogramme de l'image et limitées à
+ * DIF_BITS_LUT bits, pour que le décodage reste un seul accès table */
+
+typedef struct {
+    uint64_t poids;
+    int symbole;
+} FeuilleHuffman;
+
+static int comparer_feuilles(const void *a, const void *b) {
+    const FeuilleHuffman *x = a, *y = b;
+    if (x->poids != y->poids) return x->poids < y->poids ? -1 : 1;
+    return x->symbole - y->symbole;
+}
+
+/* Ajout d'une unité de longueur à chaque feuille contenue dans l'élément
+ * `index` de la liste du niveau `niveau` */
+static void compter_element(const int16_t references[][512], int niveau, int index,
+                            const FeuilleHuffman feuilles[256], uint8_t longueurs[256])
+{
+    int reference = references[niveau][index];
+    if (reference < 256) {
+        longueurs[feuilles[reference].symbole]++;
+        return;
+    }
+    compter_element(references, niveau - 1, 2 * (reference - 256), feuilles, longueurs);
+    compter_element(references, niveau - 1, 2 * (reference - 256) + 1, feuilles, longueurs);
+}
+
+/* Longueurs optimales limitées à DIF_BITS_LUT bits (package-merge) : au
+ * niveau k, les feuilles triées sont fusionnées avec les paires consécutives
+ * du niveau k - 1 ; les 2n - 2 premiers éléments du dernier niveau donnent
+ * la longueur de chaque feuille (nombre d'éléments qui la contiennent).
+ * Chaque symbole reçoit un code, même absent de l'histogramme (échantillonné). */
+void longueurs_huffman(const uint64_t histogramme[256], uint8_t longueurs[256]) {
+    FeuilleHuffman feuilles[256];
+    for (int symbole = 0; symbole < 256; symbole++) {
+        feuilles[symbole].poids = histogramme[symbole] + 1;
+        feuilles[symbole].symbole = symbole;
+    }
+    qsort(feuilles, 256, sizeof *feuilles, comparer_feuilles);
+
+    uint64_t poids[DIF_BITS_LUT][512];
+    int16_t references[DIF_BITS_LUT][512];   /* < 256 : feuille, sinon paire */
+    int taille = 256;
+    for (int i = 0; i < 256; i++) {
+        poids[0][i] = feuilles[i].poids;
+        references[0][i] = (int16_t)i;
+    }
+    for (int niveau = 1; niveau < DIF_BITS_LUT; niveau++) {
+        int nb_paires = taille / 2, feuille = 0, paire = 0;
+        taille = 0;
+        while (feuille < 256 || paire < nb_paires) {
+            uint64_t poids_paire = paire < nb_paires
+                                 ? poids[niveau - 1][2 * paire] + poids[niveau - 1][2 * paire + 1] : 0;
+            if (paire == nb_paires || (feuille < 256 && feuilles[feuille].poids <= poids_paire)) {
+                poids[niveau][taille] = feuilles[feuille].poids;
+                references[niveau][taille++] = (int16_t)feuille++;
+            } else {
+                poids[niveau][taille] = poids_paire;
+                references[niveau][taille++] = (int16_t)(256 + paire++);
+            }
+        }
+    }
+    memset(longueurs, 0, 256);
+    for (int index = 0; index < 2 * 256 - 2; index++)
+        compter_element(references, DIF_BITS_LUT - 1, index, feuilles, longueurs);
+}
+
+/* Codes canoniques, croissants par longueur puis par symbole. Erreur si les
+ * longueurs ne forment pas un code complet de 1 à DIF_BITS_LUT bits. */
+static int codes_canoniques(const uint8_t longueurs[256], uint16_t codes[256]) {
+    unsigned int nombre[DIF_BITS_LUT + 1] = {0};
+    for (int symbole = 0; symbole < 256; symbole++) {
+        if (longueurs[symbole] < 1 || longueurs[symbole] > DIF_BITS_LUT)
+            return DIF_ERR_FORMAT;
+        nombre[longueurs[symbole]]++;
+    }
+    unsigned int prochain[DIF_BITS_LUT + 1];
+    unsigned int code = 0;
+    for (int longueur = 1; longueur <= DIF_BITS_LUT; longueur++) {
+        code = (code + nombre[longueur - 1]) << 1;
+        prochain[longueur] = code;
+    }
+    if (code + nombre[DIF_BITS_LUT] != (1U << DIF_BITS_LUT))
+        return DIF_ERR_FORMAT;
+    for (int symbole = 0; symbole < 256; symbole++)
+        codes[symbole] = (uint16_t)prochain[longueurs[symbole]]++;
+    return DIF_OK;
+}
+
+/* Table d'encodage des codes de Huffman */
+int construire_codes_huffman(TableCodes *table, const uint8_t longueurs[256]) {
+    int err = codes_canoniques(longueurs, table->code);
+    if (err == DIF_OK)
+        memcpy(table->longueur, longueurs, 256);
+    return err;
+}
+
+/* Table de décodage : chaque code occupe les 2^(DIF_BITS_LUT - longueur)
+ * entrées qui commencent par lui */
+int construire_table_vlc_huffman(TableVLC *table, const uint8_t longueurs[256], int plages) {
+    uint16_t codes[256];
+    int err = codes_canoniques(longueurs, codes);
+    if (err != DIF_OK) return err;
+    for (int symbole = 0; symbole < 256; symbole++) {
+        int libres = DIF_BITS_LUT - longueurs[symbole];
+        EntreeVLC entree = { 0, (uint8_t)symbole, longueurs[symbole],
+                             delta_symbole((unsigned int)symbole, plages) };
+        EntreeVLC *debut = &table->entrees[(size_t)codes[symbole] << libres];
+        for (size_t k = 0; k < (size_t)1 << libres; k++)
+            debut[k] = entree;
+    }
+    return DIF_OK;
+}
@@ -0,0 +1,759 @@
+#include "codec_interne.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Noyaux octet par octet de l'encodeur et du décodeur : version scalaire de
+ * référence, versions SSE2 et AVX2 choisies à l'exécution selon le processeur */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DIF_NOYAUX_X86 1
+#endif
+
+/* Réduction d'amplitude (décalage de 1, 0 en mode sans perte), différence
+ * modulo 256 avec l'échantillon situé nb_canaux plus tôt et repliement
+ * pair/impair (donnees[-nb_canaux] doit être lisible) */
+static void replier_differences_scalaire(const uint8_t *donnees, size_t n, int nb_canaux, int decalage,
+                                         uint8_t *replies)
+{
+    for (size_t i = 0; i < n; i++) {
+        int difference = (int8_t)((donnees[i] >> decalage) - (donnees[i - nb_canaux] >> decalage));
+        replies[i] = (uint8_t)(((unsigned int)difference << 1) ^ (unsigned int)(difference >> 31));
+    }
+}
+
+/* Prédicteur MED (LOCO-I) : médiane de gauche, haut et gauche + haut - haut-gauche */
+static inline int predire_med_scalaire(int gauche, int haut, int haut_gauche) {
+    int minimum = gauche < haut ? gauche : haut;
+    int maximum = gauche < haut ? haut : gauche;
+    if (haut_gauche >= maximum) return minimum;
+    if (haut_gauche <= minimum) return maximum;
+    return gauche + haut - haut_gauche;
+}
+
+/* Résidus repliés (modulo 256) du prédicteur MED sur échantillons réduits ;
+ * ligne[-nb_canaux] et precedente[-nb_canaux] doivent être lisibles */
+static void replier_residus_med_scalaire(const uint8_t *ligne, const uint8_t *precedente, size_t n,
+                                         int nb_canaux, int decalage, uint8_t *replies)
+{
+    for (size_t i = 0; i < n; i++) {
+        int prediction = predire_med_scalaire(ligne[i - nb_canaux] >> decalage, precedente[i] >> decalage,
+                                              precedente[i - nb_canaux] >> decalage);
+        int residu = (int8_t)((ligne[i] >> decalage) - prediction);
+        replies[i] = (uint8_t)(((unsigned int)residu << 1) ^ (unsigned int)(residu >> 31));
+    }
+}
+
+/* Séquences : écarts repliés (modulo 256) avec l'échantillon co-localisé de
+ * l'image précédente, tous deux réduits de `decalage` bits */
+static void replier_ecarts_temporels_scalaire(const uint8_t *ligne, const uint8_t *reference, size_t n,
+                                              int decalage, uint8_t *replies)
+{
+    for (size_t i = 0; i < n; i++) {
+        int ecart = (int8_t)((ligne[i] >> decalage) - (reference[i] >> decalage));
+        replies[i] = (uint8_t)(((unsigned int)ecart << 1) ^ (unsigned int)(ecart >> 31));
+    }
+}
+
+/* Image différentielle : 255 - |4 delta|, limité à 0 */
+static void visualiser_deltas_scalaire(const int8_t *deltas, uint8_t *sortie, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int visualisation = 255 - abs(deltas[i] * 4);
+        sortie[i] = visualisation < 0 ? 0 : (uint8_t)visualisation;
+    }
+}
+
+/* Restauration : 2v limité à [0,255] */
+static void restaurer_valeurs_scalaire(const int32_t *valeurs, uint8_t *sortie, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t valeur = valeurs[i];
+        sortie[i] = valeur <= 0 ? 0 : valeur >= 128 ? 255 : (uint8_t)(valeur << 1);
+    }
+}
+
+/* Mode sans perte : octet de poids faible des valeurs (arithmétique modulo 256) */
+static void tronquer_valeurs_scalaire(const int32_t *valeurs, uint8_t *sortie, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        sortie[i] = (uint8_t)valeurs[i];
+}
+
+/* Échantillons sur 16 bits : différences modulo 65536 repliées sur 16 bits */
+static void replier_differences16_scalaire(const uint16_t *donnees, size_t n, int nb_canaux, int decalage,
+                                           uint16_t *replies)
+{
+    for (size_t i = 0; i < n; i++) {
+        int difference = (int16_t)((donnees[i] >> decalage) - (donnees[i - nb_canaux] >> decalage));
+        replies[i] = (uint16_t)(((unsigned int)difference << 1) ^ (unsigned int)(difference >> 31));
+    }
+}
+
+static void replier_residus_med16_scalaire(const uint16_t *ligne, const uint16_t *precedente, size_t n,
+                                           int nb_canaux, int decalage, uint16_t *replies)
+{
+    for (size_t i = 0; i < n; i++) {
+        int prediction = predire_med_scalaire(ligne[i - nb_canaux] >> decalage, precedente[i] >> decalage,
+                                              precedente[i - nb_canaux] >> decalage);
+        int residu = (int16_t)((ligne[i] >> decalage) - prediction);
+        replies[i] = (uint16_t)(((unsigned int)residu << 1) ^ (unsigned int)(residu >> 31));
+    }
+}
+
+static void replier_ecarts_temporels16_scalaire(const uint16_t *ligne, const uint16_t *reference,
+                                                size_t n, int decalage, uint16_t *replies)
+{
+    for (size_t i = 0; i < n; i++) {
+        int ecart = (int16_t)((ligne[i] >> decalage) - (reference[i] >> decalage));
+        replies[i] = (uint16_t)(((unsigned int)ecart << 1) ^ (unsigned int)(ecart >> 31));
+    }
+}
+
+/* Restauration sur 16 bits : 2v avec v limité à [0,32767], ou v modulo
+ * 65536 en mode sans perte */
+static void restaurer_valeurs16_scalaire(const int32_t *valeurs, uint16_t *sortie, size_t n, int decalage) {
+    if (!decalage) {
+        for (size_t i = 0; i < n; i++)
+            sortie[i] = (uint16_t)valeurs[i];
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        int32_t valeur = valeurs[i];
+        sortie[i] = valeur <= 0 ? 0 : valeur >= 32767 ? 65534 : (uint16_t)(valeur << 1);
+    }
+}
+
+/* Séparation de pixels RGB entrelacés en trois plans */
+static void separer_plans_scalaire(const uint8_t *entrelace, size_t nb_pixels, uint8_t *const plans[3]) {
+    for (size_t i = 0; i < nb_pixels; i++)
+        for (int canal = 0; canal < 3; canal++)
+            plans[canal][i] = entrelace[3 * i + canal];
+}
+
+/* Entrelacement de trois plans en pixels RGB */
+static void entrelacer_plans_scalaire(const uint8_t *const plans[3], size_t nb_pixels, uint8_t *entrelace) {
+    for (size_t i = 0; i < nb_pixels; i++)
+        for (int canal = 0; canal < 3; canal++)
+            entrelace[3 * i + canal] = plans[canal][i];
+}
+
+/* Décorrélation des canaux sur échantillons réduits : G, R - G + 64 et
+ * B - G + 64 modulo 128, rendus multipliés par 2 (octets pairs) pour être
+ * relus par les noyaux de repliement. Sur octets pairs, cela revient à
+ * x - g + 128 modulo 256 ; l'inverse est x + g + 128. Le vert n'est que
+ * masqué, ce qui permet de travailler sur place. Sans perte (décalage 0),
+ * les octets entiers, sans masque. */
+static void decorreler_couleurs_scalaire(const uint8_t *source, uint8_t *destination, size_t nb_pixels,
+                                         int decalage)
+{
+    uint8_t masque = (uint8_t)(0xFF << decalage);
+    for (size_t i = 0; i < 3 * nb_pixels; i += 3) {
+        uint8_t vert = source[i + 1] & masque;
+        destination[i] = (uint8_t)((source[i] & masque) - vert + 0x80);
+        destination[i + 1] = vert;
+        destination[i + 2] = (uint8_t)((source[i + 2] & masque) - vert + 0x80);
+    }
+}
+
+static void recorreler_couleurs_scalaire(uint8_t *pixels, size_t nb_pixels, int decalage) {
+    uint8_t masque = (uint8_t)(0xFF << decalage);
+    for (size_t i = 0; i < 3 * nb_pixels; i += 3) {
+        uint8_t vert = pixels[i + 1] & masque;
+        pixels[i] = (uint8_t)((pixels[i] & masque) + vert + 0x80);
+        pixels[i + 1] = vert;
+        pixels[i + 2] = (uint8_t)((pixels[i + 2] & masque) + vert + 0x80);
+    }
+}
+
+static void sommer_blocs_scalaire(const uint8_t *ligne, size_t nb_pixels, int nb_canaux, int facteur,
+                                  uint16_t *sommes, size_t pas_plan)
+{
+    for (size_t x = 0, bloc = 0; x < nb_pixels; bloc++) {
+        size_t fin = x + (size_t)facteur < nb_pixels ? x + (size_t)facteur : nb_pixels;
+        for (int canal = 0; canal < nb_canaux; canal++) {
+            unsigned int somme = 0;
+            for (size_t k = x; k < fin; k++)
+                somme += ligne[k * nb_canaux + canal];
+            sommes[canal * pas_plan + bloc] += (uint16_t)somme;
+        }
+        x = fin;
+    }
+}
+
+#ifdef DIF_NOYAUX_X86
+
+/* Position des canaux dans 48 octets (16 pixels) : rouge, bleu */
+static const int8_t masques_rouge[48] __attribute__((aligned(16))) = {
+    -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1,
+    0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0,
+    0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0,
+};
+static const int8_t masques_bleu[48] __attribute__((aligned(16))) = {
+    0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0,
+    0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0,
+    -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1,
+};
+
+/* x - g + 128 (sens = -1) ou x + g + 128 (sens = 1) sur rouge et bleu, le
+ * vert de chaque pixel étant relu un octet après le rouge et un avant le
+ * bleu. Le premier pixel et la fin sont traités en scalaire pour que les
+ * lectures décalées restent dans la ligne. */
+__attribute__((target("sse2")))
+static size_t correler_couleurs_sse2(const uint8_t *source, uint8_t *destination, size_t nb_pixels,
+                                     int sens, int decalage)
+{
+    const __m128i pair = _mm_set1_epi8((char)(0xFF << decalage));
+    const __m128i milieu = _mm_set1_epi8((char)0x80);
+    size_t i = 1;
+    for (; i + 16 < nb_pixels; i += 16) {
+        for (int r = 0; r < 3; r++) {
+            const uint8_t *p = source + 3 * i + 16 * r;
+            __m128i rouge = _mm_load_si128((const __m128i *)(masques_rouge + 16 * r));
+            __m128i bleu = _mm_load_si128((const __m128i *)(masques_bleu + 16 * r));
+            __m128i x = _mm_and_si128(_mm_loadu_si128((const __m128i *)p), pair);
+            __m128i vert = _mm_and_si128(_mm_or_si128(
+                _mm_and_si128(rouge, _mm_loadu_si128((const __m128i *)(p + 1))),
+                _mm_and_si128(bleu, _mm_loadu_si128((const __m128i *)(p - 1)))), pair);
+            __m128i couleur = sens < 0 ? _mm_sub_epi8(x, vert) : _mm_add_epi8(x, vert);
+            couleur = _mm_add_epi8(couleur, milieu);
+            __m128i canaux = _mm_or_si128(rouge, bleu);
+            _mm_storeu_si128((__m128i *)(destination + 3 * i + 16 * r),
+                             _mm_or_si128(_mm_and_si128(canaux, couleur), _mm_andnot_si128(canaux, x)));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+static void decorreler_couleurs_sse2(const uint8_t *source, uint8_t *destination, size_t nb_pixels,
+                                     int decalage)
+{
+    if (nb_pixels == 0) return;
+    decorreler_couleurs_scalaire(source, destination, 1, decalage);
+    size_t i = correler_couleurs_sse2(source, destination, nb_pixels, -1, decalage);
+    decorreler_couleurs_scalaire(source + 3 * i, destination + 3 * i, nb_pixels - i, decalage);
+}
+
+__attribute__((target("sse2")))
+static void recorreler_couleurs_sse2(uint8_t *pixels, size_t nb_pixels, int decalage) {
+    if (nb_pixels == 0) return;
+    recorreler_couleurs_scalaire(pixels, 1, decalage);
+    size_t i = correler_couleurs_sse2(pixels, pixels, nb_pixels, 1, decalage);
+    recorreler_couleurs_scalaire(pixels + 3 * i, nb_pixels - i, decalage);
+}
+
+/* Masques pshufb pour 16 pixels (48 octets, 3 registres) : octets du plan
+ * `canal` pris dans le registre `r` (-1 = octet mis à zéro) */
+static const int8_t masques_separation[3][3][16] __attribute__((aligned(16))) = {
+    { { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 } },
+    { { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 } },
+    { { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 } },
+};
+
+/* Octets du registre de sortie `r` pris dans le plan `canal` */
+static const int8_t masques_entrelacement[3][3][16] __attribute__((aligned(16))) = {
+    { { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+      { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+      { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 } },
+    { { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+      { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+      { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 } },
+    { { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+      { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+      { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 } },
+};
+
+__attribute__((target("sse2")))
+static inline __m128i masque(const int8_t octets[16]) {
+    return _mm_load_si128((const __m128i *)octets);
+}
+
+/* Sommes des blocs de `facteur` octets (2, 4 ou 8) d'un registre ajoutées
+ * aux 16 / facteur sommes suivantes : paires sur 16 bits, quadruplets par
+ * pmaddwd, octuplets par psadbw */
+__attribute__((target("sse2")))
+static inline void ajouter_blocs_sse2(__m128i octets, int facteur, uint16_t *sommes) {
+    if (facteur == 8) {
+        __m128i blocs = _mm_sad_epu8(octets, _mm_setzero_si128());
+        sommes[0] += (uint16_t)_mm_cvtsi128_si32(blocs);
+        sommes[1] += (uint16_t)_mm_extract_epi16(blocs, 4);
+        return;
+    }
+    __m128i paires = _mm_add_epi16(_mm_and_si128(octets, _mm_set1_epi16(0xFF)), _mm_srli_epi16(octets, 8));
+    if (facteur == 2) {
+        __m128i *destination = (__m128i *)sommes;
+        _mm_storeu_si128(destination, _mm_add_epi16(_mm_loadu_si128(destination), paires));
+        return;
+    }
+    __m128i quadruplets = _mm_madd_epi16(paires, _mm_set1_epi16(1));
+    quadruplets = _mm_packs_epi32(quadruplets, quadruplets);
+    __m128i *destination = (__m128i *)sommes;
+    _mm_storel_epi64(destination, _mm_add_epi16(_mm_loadl_epi64(destination), quadruplets));
+}
+
+/* Chargement de 16 (32) échantillons décalés de `decalage` bits (décalage
+ * et masque en registres, invariants de boucle) */
+__attribute__((target("sse2")))
+static inline __m128i charger_reduits_sse2(const uint8_t *octets, __m128i decalage, __m128i masque) {
+    return _mm_and_si128(_mm_srl_epi16(_mm_loadu_si128((const __m128i *)octets), decalage), masque);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i charger_reduits_avx2(const uint8_t *octets, __m128i decalage, __m256i masque) {
+    return _mm256_and_si256(_mm256_srl_epi16(_mm256_loadu_si256((const __m256i *)octets), decalage),
+                            masque);
+}
+
+/* Les différences sont prises modulo 256, ce qui les garde sur un octet
+ * (exactes dans [-127,127] pour des échantillons réduits) : tout le calcul
+ * se fait sur des octets, le repliement aussi (d+d) ^ (d<0) */
+__attribute__((target("sse2")))
+static void replier_differences_sse2(const uint8_t *donnees, size_t n, int nb_canaux, int decalage,
+                                     uint8_t *replies)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    const __m128i masque = _mm_set1_epi8((char)(0xFF >> decalage));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i difference = _mm_sub_epi8(charger_reduits_sse2(donnees + i, compte, masque),
+                                          charger_reduits_sse2(donnees + i - nb_canaux, compte, masque));
+        __m128i signe = _mm_cmpgt_epi8(zero, difference);
+        _mm_storeu_si128((__m128i *)(replies + i),
+                         _mm_xor_si128(_mm_add_epi8(difference, difference), signe));
+    }
+    replier_differences_scalaire(donnees + i, n - i, nb_canaux, decalage, replies + i);
+}
+
+/* Lignes en niveaux de gris par 16 pixels ; la couleur demande pshufb
+ * (niveau AVX2) et reste scalaire ici */
+__attribute__((target("sse2")))
+static void sommer_blocs_sse2(const uint8_t *ligne, size_t nb_pixels, int nb_canaux, int facteur,
+                              uint16_t *sommes, size_t pas_plan)
+{
+    size_t i = 0;
+    if (nb_canaux == 1)
+        for (; i + 16 <= nb_pixels; i += 16)
+            ajouter_blocs_sse2(_mm_loadu_si128((const __m128i *)(ligne + i)), facteur, sommes + i / facteur);
+    sommer_blocs_scalaire(ligne + i * nb_canaux, nb_pixels - i, nb_canaux, facteur,
+                          sommes + i / facteur, pas_plan);
+}
+
+/* MED = gauche + haut - haut-gauche limité à [min, max] de gauche et haut,
+ * calculé min + (max - haut-gauche) saturés puis limité à max : exact sur
+ * des octets entiers comme sur des échantillons réduits */
+__attribute__((target("sse2")))
+static void replier_residus_med_sse2(const uint8_t *ligne, const uint8_t *precedente, size_t n,
+                                     int nb_canaux, int decalage, uint8_t *replies)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    const __m128i masque = _mm_set1_epi8((char)(0xFF >> decalage));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i courant = charger_reduits_sse2(ligne + i, compte, masque);
+        __m128i gauche = charger_reduits_sse2(ligne + i - nb_canaux, compte, masque);
+        __m128i haut = charger_reduits_sse2(precedente + i, compte, masque);
+        __m128i haut_gauche = charger_reduits_sse2(precedente + i - nb_canaux, compte, masque);
+        __m128i minimum = _mm_min_epu8(gauche, haut);
+        __m128i maximum = _mm_max_epu8(gauche, haut);
+        __m128i prediction = _mm_min_epu8(_mm_adds_epu8(minimum, _mm_subs_epu8(maximum, haut_gauche)),
+                                          maximum);
+        __m128i residu = _mm_sub_epi8(courant, prediction);
+        __m128i signe = _mm_cmpgt_epi8(zero, residu);
+        _mm_storeu_si128((__m128i *)(replies + i),
+                         _mm_xor_si128(_mm_add_epi8(residu, residu), signe));
+    }
+    replier_residus_med_scalaire(ligne + i, precedente + i, n - i, nb_canaux, decalage, replies + i);
+}
+
+__attribute__((target("sse2")))
+static void replier_ecarts_temporels_sse2(const uint8_t *ligne, const uint8_t *reference, size_t n,
+                                          int decalage, uint8_t *replies)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    const __m128i masque = _mm_set1_epi8((char)(0xFF >> decalage));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i ecart = _mm_sub_epi8(charger_reduits_sse2(ligne + i, compte, masque),
+                                     charger_reduits_sse2(reference + i, compte, masque));
+        __m128i signe = _mm_cmpgt_epi8(zero, ecart);
+        _mm_storeu_si128((__m128i *)(replies + i), _mm_xor_si128(_mm_add_epi8(ecart, ecart), signe));
+    }
+    replier_ecarts_temporels_scalaire(ligne + i, reference + i, n - i, decalage, replies + i);
+}
+
+/* |d| par min non signé de d et -d, x4 saturé, puis 255 - x = ~x */
+__attribute__((target("sse2")))
+static void visualiser_deltas_sse2(const int8_t *deltas, uint8_t *sortie, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i uns = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i delta = _mm_loadu_si128((const __m128i *)(deltas + i));
+        __m128i absolu = _mm_min_epu8(delta, _mm_sub_epi8(zero, delta));
+        absolu = _mm_adds_epu8(absolu, absolu);
+        absolu = _mm_adds_epu8(absolu, absolu);
+        _mm_storeu_si128((__m128i *)(sortie + i), _mm_xor_si128(absolu, uns));
+    }
+    visualiser_deltas_scalaire(deltas + i, sortie + i, n - i);
+}
+
+/* Saturations successives : int32 -> int16, 2v saturé, int16 -> [0,255] */
+__attribute__((target("sse2")))
+static void restaurer_valeurs_sse2(const int32_t *valeurs, uint8_t *sortie, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i *v = (const __m128i *)(valeurs + i);
+        __m128i bas = _mm_packs_epi32(_mm_loadu_si128(v), _mm_loadu_si128(v + 1));
+        __m128i haut = _mm_packs_epi32(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3));
+        bas = _mm_adds_epi16(bas, bas);
+        haut = _mm_adds_epi16(haut, haut);
+        _mm_storeu_si128((__m128i *)(sortie + i), _mm_packus_epi16(bas, haut));
+    }
+    restaurer_valeurs_scalaire(valeurs + i, sortie + i, n - i);
+}
+
+/* Octet de poids faible : masque puis packs, sans saturation possible */
+__attribute__((target("sse2")))
+static void tronquer_valeurs_sse2(const int32_t *valeurs, uint8_t *sortie, size_t n) {
+    const __m128i octet = _mm_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i *v = (const __m128i *)(valeurs + i);
+        __m128i bas = _mm_packs_epi32(_mm_and_si128(_mm_loadu_si128(v), octet),
+                                      _mm_and_si128(_mm_loadu_si128(v + 1), octet));
+        __m128i haut = _mm_packs_epi32(_mm_and_si128(_mm_loadu_si128(v + 2), octet),
+                                       _mm_and_si128(_mm_loadu_si128(v + 3), octet));
+        _mm_storeu_si128((__m128i *)(sortie + i), _mm_packus_epi16(bas, haut));
+    }
+    tronquer_valeurs_scalaire(valeurs + i, sortie + i, n - i);
+}
+
+/* 16 bits : la différence modulo 65536 et le repliement tiennent dans des
+ * mots de 16 bits, (d+d) ^ (d >> 15) */
+__attribute__((target("sse2")))
+static void replier_differences16_sse2(const uint16_t *donnees, size_t n, int nb_canaux, int decalage,
+                                       uint16_t *replies)
+{
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i courant = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(donnees + i)), compte);
+        __m128i gauche = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(donnees + i - nb_canaux)), compte);
+        __m128i difference = _mm_sub_epi16(courant, gauche);
+        _mm_storeu_si128((__m128i *)(replies + i),
+                         _mm_xor_si128(_mm_add_epi16(difference, difference), _mm_srai_epi16(difference, 15)));
+    }
+    replier_differences16_scalaire(donnees + i, n - i, nb_canaux, decalage, replies + i);
+}
+
+/* SSE2 n'a pas de min/max non signés sur 16 bits : min(a, b) = a - (a -sat b)
+ * et max(a, b) = b + (a -sat b) */
+__attribute__((target("sse2")))
+static void replier_residus_med16_sse2(const uint16_t *ligne, const uint16_t *precedente, size_t n,
+                                       int nb_canaux, int decalage, uint16_t *replies)
+{
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i courant = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(ligne + i)), compte);
+        __m128i gauche = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(ligne + i - nb_canaux)), compte);
+        __m128i haut = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(precedente + i)), compte);
+        __m128i haut_gauche = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(precedente + i - nb_canaux)),
+                                            compte);
+        __m128i ecart = _mm_subs_epu16(gauche, haut);
+        __m128i minimum = _mm_sub_epi16(gauche, ecart);
+        __m128i maximum = _mm_add_epi16(haut, ecart);
+        __m128i gradient = _mm_adds_epu16(minimum, _mm_subs_epu16(maximum, haut_gauche));
+        __m128i prediction = _mm_sub_epi16(gradient, _mm_subs_epu16(gradient, maximum));
+        __m128i residu = _mm_sub_epi16(courant, prediction);
+        _mm_storeu_si128((__m128i *)(replies + i),
+                         _mm_xor_si128(_mm_add_epi16(residu, residu), _mm_srai_epi16(residu, 15)));
+    }
+    replier_residus_med16_scalaire(ligne + i, precedente + i, n - i, nb_canaux, decalage, replies + i);
+}
+
+__attribute__((target("sse2")))
+static void replier_ecarts_temporels16_sse2(const uint16_t *ligne, const uint16_t *reference, size_t n,
+                                            int decalage, uint16_t *replies)
+{
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i courant = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(ligne + i)), compte);
+        __m128i precedent = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(reference + i)), compte);
+        __m128i ecart = _mm_sub_epi16(courant, precedent);
+        _mm_storeu_si128((__m128i *)(replies + i),
+                         _mm_xor_si128(_mm_add_epi16(ecart, ecart), _mm_srai_epi16(ecart, 15)));
+    }
+    replier_ecarts_temporels16_scalaire(ligne + i, reference + i, n - i, decalage, replies + i);
+}
+
+/* Restauration 16 bits : packs signé puis 2v (v dans [0,32767]), ou les 16
+ * bits de poids faible étendus en signe pour que packs les garde tels quels */
+__attribute__((target("sse2")))
+static void restaurer_valeurs16_sse2(const int32_t *valeurs, uint16_t *sortie, size_t n, int decalage) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i bas = _mm_loadu_si128((const __m128i *)(valeurs + i));
+        __m128i haut = _mm_loadu_si128((const __m128i *)(valeurs + i + 4));
+        __m128i mots;
+        if (decalage) {
+            mots = _mm_max_epi16(_mm_packs_epi32(bas, haut), zero);
+            mots = _mm_slli_epi16(mots, 1);
+        } else {
+            mots = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(bas, 16), 16),
+                                   _mm_srai_epi32(_mm_slli_epi32(haut, 16), 16));
+        }
+        _mm_storeu_si128((__m128i *)(sortie + i), mots);
+    }
+    restaurer_valeurs16_scalaire(valeurs + i, sortie + i, n - i, decalage);
+}
+
+__attribute__((target("avx2")))
+static void replier_differences_avx2(const uint8_t *donnees, size_t n, int nb_canaux, int decalage,
+                                     uint8_t *replies)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    const __m256i masque = _mm256_set1_epi8((char)(0xFF >> decalage));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i difference = _mm256_sub_epi8(charger_reduits_avx2(donnees + i, compte, masque),
+                                             charger_reduits_avx2(donnees + i - nb_canaux, compte, masque));
+        __m256i signe = _mm256_cmpgt_epi8(zero, difference);
+        _mm256_storeu_si256((__m256i *)(replies + i),
+                            _mm256_xor_si256(_mm256_add_epi8(difference, difference), signe));
+    }
+    replier_differences_sse2(donnees + i, n - i, nb_canaux, decalage, replies + i);
+}
+
+__attribute__((target("avx2")))
+static void replier_residus_med_avx2(const uint8_t *ligne, const uint8_t *precedente, size_t n,
+                                     int nb_canaux, int decalage, uint8_t *replies)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    const __m256i masque = _mm256_set1_epi8((char)(0xFF >> decalage));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i courant = charger_reduits_avx2(ligne + i, compte, masque);
+        __m256i gauche = charger_reduits_avx2(ligne + i - nb_canaux, compte, masque);
+        __m256i haut = charger_reduits_avx2(precedente + i, compte, masque);
+        __m256i haut_gauche = charger_reduits_avx2(precedente + i - nb_canaux, compte, masque);
+        __m256i minimum = _mm256_min_epu8(gauche, haut);
+        __m256i maximum = _mm256_max_epu8(gauche, haut);
+        __m256i prediction = _mm256_min_epu8(
+            _mm256_adds_epu8(minimum, _mm256_subs_epu8(maximum, haut_gauche)), maximum);
+        __m256i residu = _mm256_sub_epi8(courant, prediction);
+        __m256i signe = _mm256_cmpgt_epi8(zero, residu);
+        _mm256_storeu_si256((__m256i *)(replies + i),
+                            _mm256_xor_si256(_mm256_add_epi8(residu, residu), signe));
+    }
+    replier_residus_med_sse2(ligne + i, precedente + i, n - i, nb_canaux, decalage, replies + i);
+}
+
+__attribute__((target("avx2")))
+static void replier_ecarts_temporels_avx2(const uint8_t *ligne, const uint8_t *reference, size_t n,
+                                          int decalage, uint8_t *replies)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i compte = _mm_cvtsi32_si128(decalage);
+    const __m256i masque = _mm256_set1_epi8((char)(0xFF >> decalage));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i ecart = _mm256_sub_epi8(charger_reduits_avx2(ligne + i, compte, masque),
+                                        charger_reduits_avx2(reference + i, compte, masque));
+        __m256i signe = _mm256_cmpgt_epi8(zero, ecart);
+        _mm256_storeu_si256((__m256i *)(replies + i),
+                            _mm256_xor_si256(_mm256_add_epi8(ecart, ecart), signe));
+    }
+    replier_ecarts_temporels_sse2(ligne + i, reference + i, n - i, decalage, replies + i);
+}
+
+__attribute__((target("avx2")))
+static void visualiser_deltas_avx2(const int8_t *deltas, uint8_t *sortie, size_t n) {
+    const __m256i uns = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i absolu = _mm256_abs_epi8(_mm256_loadu_si256((const __m256i *)(deltas + i)));
+        absolu = _mm256_adds_epu8(absolu, absolu);
+        absolu = _mm256_adds_epu8(absolu, absolu);
+        _mm256_storeu_si256((__m256i *)(sortie + i), _mm256_xor_si256(absolu, uns));
+    }
+    visualiser_deltas_sse2(deltas + i, sortie + i, n - i);
+}
+
+/* Les packs AVX2 travaillent par moitiés de 128 bits : une permutation des
+ * mots de 32 bits remet les octets dans l'ordre */
+__attribute__((target("avx2")))
+static void restaurer_valeurs_avx2(const int32_t *valeurs, uint8_t *sortie, size_t n) {
+    const __m256i ordre = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i *v = (const __m256i *)(valeurs + i);
+        __m256i bas = _mm256_packs_epi32(_mm256_loadu_si256(v), _mm256_loadu_si256(v + 1));
+        __m256i haut = _mm256_packs_epi32(_mm256_loadu_si256(v + 2), _mm256_loadu_si256(v + 3));
+        bas = _mm256_adds_epi16(bas, bas);
+        haut = _mm256_adds_epi16(haut, haut);
+        __m256i octets = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(bas, haut), ordre);
+        _mm256_storeu_si256((__m256i *)(sortie + i), octets);
+    }
+    restaurer_valeurs_sse2(valeurs + i, sortie + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void tronquer_valeurs_avx2(const int32_t *valeurs, uint8_t *sortie, size_t n) {
+    const __m256i ordre = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256i octet = _mm256_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i *v = (const __m256i *)(valeurs + i);
+        __m256i bas = _mm256_packs_epi32(_mm256_and_si256(_mm256_loadu_si256(v), octet),
+                                         _mm256_and_si256(_mm256_loadu_si256(v + 1), octet));
+        __m256i haut = _mm256_packs_epi32(_mm256_and_si256(_mm256_loadu_si256(v + 2), octet),
+                                          _mm256_and_si256(_mm256_loadu_si256(v + 3), octet));
+        __m256i octets = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(bas, haut), ordre);
+        _mm256_storeu_si256((__m256i *)(sortie + i), octets);
+    }
+    tronquer_valeurs_sse2(valeurs + i, sortie + i, n - i);
+}
+
+/* Les réarrangements d'octets demandent pshufb (SSSE3, inclus dans AVX2) :
+ * 16 pixels par registre de 128 bits, le niveau SSE2 garde la version scalaire */
+__attribute__((target("avx2")))
+static inline __m128i extraire_plan(const __m128i registres[3], int canal) {
+    return _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(registres[0], masque(masques_separation[canal][0])),
+                     _mm_shuffle_epi8(registres[1], masque(masques_separation[canal][1]))),
+        _mm_shuffle_epi8(registres[2], masque(masques_separation[canal][2])));
+}
+
+__attribute__((target("avx2")))
+static void separer_plans_avx2(const uint8_t *entrelace, size_t nb_pixels, uint8_t *const plans[3]) {
+    size_t i = 0;
+    for (; i + 16 <= nb_pixels; i += 16) {
+        const __m128i *source = (const __m128i *)(entrelace + 3 * i);
+        __m128i registres[3] = { _mm_loadu_si128(source), _mm_loadu_si128(source + 1),
+                                 _mm_loadu_si128(source + 2) };
+        for (int canal = 0; canal < 3; canal++)
+            _mm_storeu_si128((__m128i *)(plans[canal] + i), extraire_plan(registres, canal));
+    }
+    uint8_t *const reste[3] = { plans[0] + i, plans[1] + i, plans[2] + i };
+    separer_plans_scalaire(entrelace + 3 * i, nb_pixels - i, reste);
+}
+
+/* Pixels RGB séparés en plans dans les registres, chaque plan réduit comme
+ * une ligne en niveaux de gris */
+__attribute__((target("avx2")))
+static void sommer_blocs_avx2(const uint8_t *ligne, size_t nb_pixels, int nb_canaux, int facteur,
+                              uint16_t *sommes, size_t pas_plan)
+{
+    if (nb_canaux != 3) {
+        sommer_blocs_sse2(ligne, nb_pixels, nb_canaux, facteur, sommes, pas_plan);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 16 <= nb_pixels; i += 16) {
+        const __m128i *source = (const __m128i *)(ligne + 3 * i);
+        __m128i registres[3] = { _mm_loadu_si128(source), _mm_loadu_si128(source + 1),
+                                 _mm_loadu_si128(source + 2) };
+        for (int canal = 0; canal < 3; canal++)
+            ajouter_blocs_sse2(extraire_plan(registres, canal), facteur,
+                               sommes + canal * pas_plan + i / facteur);
+    }
+    sommer_blocs_scalaire(ligne + 3 * i, nb_pixels - i, 3, facteur, sommes + i / facteur, pas_plan);
+}
+
+__attribute__((target("avx2")))
+static void entrelacer_plans_avx2(const uint8_t *const plans[3], size_t nb_pixels, uint8_t *entrelace) {
+    size_t i = 0;
+    for (; i + 16 <= nb_pixels; i += 16) {
+        __m128i canaux[3] = { _mm_loadu_si128((const __m128i *)(plans[0] + i)),
+                              _mm_loadu_si128((const __m128i *)(plans[1] + i)),
+                              _mm_loadu_si128((const __m128i *)(plans[2] + i)) };
+        __m128i *destination = (__m128i *)(entrelace + 3 * i);
+        for (int r = 0; r < 3; r++) {
+            __m128i octets = _mm_or_si128(
+                _mm_or_si128(_mm_shuffle_epi8(canaux[0], masque(masques_entrelacement[r][0])),
+                             _mm_shuffle_epi8(canaux[1], masque(masques_entrelacement[r][1]))),
+                _mm_shuffle_epi8(canaux[2], masque(masques_entrelacement[r][2])));
+            _mm_storeu_si128(destination + r, octets);
+        }
+    }
+    const uint8_t *const reste[3] = { plans[0] + i, plans[1] + i, plans[2] + i };
+    entrelacer_plans_scalaire(reste, nb_pixels - i, entrelace + 3 * i);
+}
+
+#endif
+
+static const NoyauxDIF noyaux_scalaires = {
+    "scalaire", replier_differences_scalaire, replier_residus_med_scalaire,
+    replier_ecarts_temporels_scalaire, visualiser_deltas_scalaire, restaurer_valeurs_scalaire, tronquer_valeurs_scalaire,
+    separer_plans_scalaire, entrelacer_plans_scalaire,
+    decorreler_couleurs_scalaire, recorreler_couleurs_scalaire, sommer_blocs_scalaire,
+    replier_differences16_scalaire, replier_residus_med16_scalaire,
+    replier_ecarts_temporels16_scalaire, restaurer_valeurs16_scalaire
+};
+#ifdef DIF_NOYAUX_X86
+static const NoyauxDIF noyaux_sse2 = {
+    "sse2", replier_differences_sse2, replier_residus_med_sse2,
+    replier_ecarts_temporels_sse2, visualiser_deltas_sse2, restaurer_valeurs_sse2, tronquer_valeurs_sse2,
+    separer_plans_scalaire, entrelacer_plans_scalaire,
+    decorreler_couleurs_sse2, recorreler_couleurs_sse2, sommer_blocs_sse2,
+    replier_differences16_sse2, replier_residus_med16_sse2,
+    replier_ecarts_temporels16_sse2, restaurer_valeurs16_sse2
+};
+static const NoyauxDIF noyaux_avx2 = {
+    "avx2", replier_differences_avx2, replier_residus_med_avx2,
+    replier_ecarts_temporels_avx2, visualiser_deltas_avx2, restaurer_valeurs_avx2, tronquer_valeurs_avx2,
+    separer_plans_avx2, entrelacer_plans_avx2,
+    decorreler_couleurs_sse2, recorreler_couleurs_sse2, sommer_blocs_avx2,
+    replier_differences16_sse2, replier_residus_med16_sse2,
+    replier_ecarts_temporels16_sse2, restaurer_valeurs16_sse2
+};
+#endif
+
+/* Noyaux d'un niveau donné, NULL si le processeur ne le permet pas */
+const NoyauxDIF *noyaux_niveau(int niveau) {
+    switch (niveau) {
+    case DIF_NOYAUX_SCALAIRE:
+        return &noyaux_scalaires;
+#ifdef DIF_NOYAUX_X86
+    case DIF_NOYAUX_SSE2:
+        return __builtin_cpu_supports("sse2") ? &noyaux_sse2 : NULL;
+    case DIF_NOYAUX_AVX2:
+        return __builtin_cpu_supports("avx2") ? &noyaux_avx2 : NULL;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+static const NoyauxDIF *noyaux_choisis;
+static pthread_once_t noyaux_initialises = PTHREAD_ONCE_INIT;
+
+/* Meilleur niveau disponible, sauf si DIF_NOYAUX=scalaire|sse2|avx2 le limite */
+static void choisir_noyaux(void) {
+    static const char *noms[] = { "scalaire", "sse2", "avx2" };
+    int maximum = DIF_NOYAUX_AVX2;
+    const char *demande = getenv("DIF_NOYAUX");
+    for (int niveau = 0; demande && niveau <= DIF_NOYAUX_AVX2; niveau++)
+        if (strcmp(demande, noms[niveau]) == 0)
+            maximum = niveau;
+    for (int niveau = maximum; niveau >= DIF_NOYAUX_SCALAIRE && !noyaux_choisis; niveau--)
+        noyaux_choisis = noyaux_niveau(niveau);
+}
+
+const NoyauxDIF *noyaux_dif(void) {
+    pthread_once(&noyaux_initialises, choisir_noyaux);
+    return noyaux_choisis;
+}
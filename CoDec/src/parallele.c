@@ -0,0 +1,126 @@
+#include "codec_interne.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Pool de threads minimal : un lot de tâches indexées est distribué aux
+ * ouvriers, le thread appelant participe et attend la fin du lot */
+struct PoolThreads {
+    pthread_mutex_t verrou;
+    pthread_cond_t nouveau_lot;
+    pthread_cond_t lot_termine;
+    pthread_t *ouvriers;
+    int nb_ouvriers;
+    /* lot courant */
+    void (*tache)(void *contexte, int index);
+    void *contexte;
+    int nb_taches;
+    int prochaine;
+    int terminees;
+    unsigned long generation;
+    int arret;
+};
+
+/* Nombre de coeurs disponibles */
+int nombre_coeurs(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/* Exécute les tâches restantes du lot ; appelé verrou tenu, rendu verrou tenu */
+static void travailler(PoolThreads *pool) {
+    while (pool->prochaine < pool->nb_taches) {
+        int index = pool->prochaine++;
+        void (*tache)(void *, int) = pool->tache;
+        void *contexte = pool->contexte;
+        pthread_mutex_unlock(&pool->verrou);
+        tache(contexte, index);
+        pthread_mutex_lock(&pool->verrou);
+        if (++pool->terminees == pool->nb_taches)
+            pthread_cond_broadcast(&pool->lot_termine);
+    }
+}
+
+static void *boucle_ouvrier(void *argument) {
+    PoolThreads *pool = argument;
+    unsigned long generation_vue = 0;
+    pthread_mutex_lock(&pool->verrou);
+    for (;;) {
+        while (!pool->arret && pool->generation == generation_vue)
+            pthread_cond_wait(&pool->nouveau_lot, &pool->verrou);
+        if (pool->arret) break;
+        generation_vue = pool->generation;
+        travailler(pool);
+    }
+    pthread_mutex_unlock(&pool->verrou);
+    return NULL;
+}
+
+/* Création d'un pool de nb_threads threads (0 = nombre de coeurs) */
+PoolThreads *creer_pool(int nb_threads) {
+    if (nb_threads <= 0) nb_threads = nombre_coeurs();
+    PoolThreads *pool = calloc(1, sizeof *pool);
+    if (!pool) return NULL;
+    pthread_mutex_init(&pool->verrou, NULL);
+    pthread_cond_init(&pool->nouveau_lot, NULL);
+    pthread_cond_init(&pool->lot_termine, NULL);
+    /* le thread appelant compte comme un ouvrier */
+    if (nb_threads > 1) {
+        pool->ouvriers = malloc(sizeof(pthread_t) * (nb_threads - 1));
+        if (!pool->ouvriers) {
+            detruire_pool(pool);
+            return NULL;
+        }
+        for (int i = 0; i < nb_threads - 1; i++) {
+            if (pthread_create(&pool->ouvriers[i], NULL, boucle_ouvrier, pool) != 0)
+                break;
+            pool->nb_ouvriers++;
+        }
+    }
+    return pool;
+}
+
+/* Nombre total de threads du pool (appelant compris) */
+int taille_pool(const PoolThreads *pool) {
+    return pool->nb_ouvriers + 1;
+}
+
+/* Exécution de tache(contexte, i) pour i dans [0, nb_taches[ ; bloquant */
+void executer_pool(PoolThreads *pool, int nb_taches,
+                   void (*tache)(void *contexte, int index), void *contexte)
+{
+    if (nb_taches <= 0) return;
+    if (pool->nb_ouvriers == 0 || nb_taches == 1) {
+        for (int i = 0; i < nb_taches; i++)
+            tache(contexte, i);
+        return;
+    }
+    pthread_mutex_lock(&pool->verrou);
+    pool->tache = tache;
+    pool->contexte = contexte;
+    pool->nb_taches = nb_taches;
+    pool->prochaine = 0;
+    pool->terminees = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->nouveau_lot);
+    travailler(pool);
+    while (pool->terminees < pool->nb_taches)
+        pthread_cond_wait(&pool->lot_termine, &pool->verrou);
+    pthread_mutex_unlock(&pool->verrou);
+}
+
+/* Arrêt des ouvriers et libération du pool */
+void detruire_pool(PoolThreads *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->verrou);
+    pool->arret = 1;
+    pthread_cond_broadcast(&pool->nouveau_lot);
+    pthread_mutex_unlock(&pool->verrou);
+    for (int i = 0; i < pool->nb_ouvriers; i++)
+        pthread_join(pool->ouvriers[i], NULL);
+    free(pool->ouvriers);
+    pthread_cond_destroy(&pool->lot_termine);
+    pthread_cond_destroy(&pool->nouveau_lot);
+    pthread_mutex_destroy(&pool->verrou);
+    free(pool);
+}
@@ -0,0 +1,42 @@
+/* Outils communs aux benchmarks de décodage partiel (bench_regions,
+ * bench_vignettes) : chronomètre, tirages reproductibles et image de test */
+#ifndef BENCH_COMMUN_H
+#define BENCH_COMMUN_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned int graine = 12345;
+
+static unsigned int aleatoire(void) {
+    graine = graine * 1103515245u + 12345u;
+    return graine >> 16;
+}
+
+/* Image de test : dégradés et bruit, proche d'une photo numérisée ;
+ * échantillons uint16 natifs au-delà de 255 */
+static unsigned char *generer_image(int largeur, int hauteur, int nb_canaux, int valeur_max) {
+    size_t n = (size_t)largeur * hauteur * nb_canaux;
+    unsigned char *pixels = malloc(n * (valeur_max > 255 ? 2 : 1));
+    if (!pixels) return NULL;
+    size_t i = 0;
+    for (int y = 0; y < hauteur; y++)
+        for (int x = 0; x < largeur; x++)
+            for (int c = 0; c < nb_canaux; c++, i++) {
+                int bruit = (int)(aleatoire() % 9) - 4;
+                unsigned int v = (unsigned int)((x * (c + 1) + y) / 8 + bruit) % 256;
+                if (valeur_max > 255)
+                    ((uint16_t *)pixels)[i] = (uint16_t)((v * 257 + aleatoire() % 16) % (valeur_max + 1u));
+                else
+                    pixels[i] = (unsigned char)v;
+            }
+    return pixels;
+}
+
+#endif
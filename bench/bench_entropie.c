@@ -0,0 +1,96 @@
+/* Benchmark des deux codages entropiques : codes VLC à 4 niveaux contre codes
+ * de Huffman de l'image, avec et sans plages, sur un thread (taux de
+ * compression, débits d'encodage et de décodage, images décodées comparées) */
+#include "codec_interne.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPETITIONS 5
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Images de test : photo (canaux corrélés et bruit), texture grise,
+ * page de texte (aplats) */
+enum { IMAGE_PHOTO, IMAGE_TEXTURE, IMAGE_DOCUMENT };
+
+static void generer_image(unsigned char *pixels, int largeur, int hauteur, int nb_canaux, int type) {
+    unsigned int graine = 12345;
+    for (int y = 0; y < hauteur; y++)
+        for (int x = 0; x < largeur; x++) {
+            graine = graine * 1103515245u + 12345u;
+            int bruit = (int)((graine >> 16) % 7) - 3;
+            int fond = (x / 7 + y / 5) % 160 + 48;
+            for (int c = 0; c < nb_canaux; c++) {
+                int valeur;
+                if (type == IMAGE_PHOTO)
+                    valeur = fond + 12 * c + bruit;
+                else if (type == IMAGE_TEXTURE)
+                    valeur = (x * y / 64 + (int)((graine >> 20) % 17)) & 255;
+                else
+                    valeur = ((y / 24) % 2 && (x / 9 + y / 24) % 5 && (graine >> 28) % 3) ? 30 : 250;
+                *pixels++ = (unsigned char)(valeur < 0 ? 0 : valeur > 255 ? 255 : valeur);
+            }
+        }
+}
+
+static int mesurer(const char *nom, int largeur, int hauteur, int nb_canaux, int type) {
+    static const struct { const char *nom; unsigned int modes; } codages[] = {
+        { "vlc", 0 },
+        { "huffman", DIF_MODE_HUFFMAN },
+        { "vlc+plages", DIF_MODE_PLAGES },
+        { "huffman+plages", DIF_MODE_HUFFMAN | DIF_MODE_PLAGES },
+    };
+    size_t taille = (size_t)largeur * hauteur * nb_canaux;
+    unsigned char *image = malloc(taille), *reference = malloc(taille);
+    if (!image || !reference) return 0;
+    generer_image(image, largeur, hauteur, nb_canaux, type);
+
+    int ok = 1;
+    for (size_t k = 0; k < sizeof codages / sizeof codages[0]; k++) {
+        OptionsDIF options;
+        options_dif_defaut(&options);
+        options.nb_threads = 1;
+        options.hauteur_bande = DIF_HAUTEUR_BANDE_MODES;
+        options.modes = codages[k].modes;
+        dif_context *contexte = dif_context_creer(&options);
+        FormatImageDIF format = { largeur, hauteur, nb_canaux, 0, 0 };
+        TamponDIF dif = {0}, sortie = {0};
+
+        double t0 = secondes();
+        for (int r = 0; r < REPETITIONS && ok; r++)
+            ok = dif_encode_mem_ctx(contexte, image, &format, &dif) == DIF_OK;
+        double t1 = secondes();
+        for (int r = 0; r < REPETITIONS && ok; r++)
+            ok = dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &format, &sortie) == DIF_OK;
+        double t2 = secondes();
+
+        /* même image décodée quel que soit le codage ; mode retenu par l'encodeur */
+        if (ok && k == 0) memcpy(reference, sortie.donnees, taille);
+        ok = ok && memcmp(reference, sortie.donnees, taille) == 0;
+        unsigned int retenus = ok ? dif.donnees[12] : 0;
+        double mo = (double)taille * REPETITIONS / 1e6;
+        printf("%-9s %-15s taux : %6.2f %%   encodage : %7.1f Mo/s   decodage : %7.1f Mo/s%s  %s\n",
+               nom, codages[k].nom, 100.0 * dif.taille / taille, mo / (t1 - t0), mo / (t2 - t1),
+               retenus == codages[k].modes ? "" : "  (mode abandonne)", ok ? "ok" : "DIFFERENT");
+        free(dif.donnees);
+        free(sortie.donnees);
+        dif_context_detruire(contexte);
+    }
+    free(image);
+    free(reference);
+    return ok;
+}
+
+int main(void) {
+    int ok = 1;
+    ok &= mesurer("photo", 3000, 2000, 3, IMAGE_PHOTO);
+    ok &= mesurer("texture", 4096, 4096, 1, IMAGE_TEXTURE);
+    ok &= mesurer("document", 2480, 3508, 1, IMAGE_DOCUMENT);
+    return ok ? 0 : 1;
+}
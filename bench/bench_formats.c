@@ -0,0 +1,505 @@
+/* Lecteurs d'images de formats.c : chaque variante BMP, TGA, PAM et PNM
+ * (ASCII ou de valeur maximale quelconque) est écrite à partir d'une image
+ * de référence, relue par lire_image et comparée pixel à pixel, puis
+ * encodée sans perte et décodée (aller-retour DIF) ; débit de lecture des
+ * formats les plus courants sur une grande image */
+#include "codec_interne.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LARGEUR 13   /* impaire : bourrage des lignes BMP, octets partiels */
+#define HAUTEUR 7
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Contenu du fichier de test, construit en mémoire */
+typedef struct {
+    unsigned char *octets;
+    size_t taille;
+    size_t capacite;
+} Fichier;
+
+static void ajouter(Fichier *f, const void *octets, size_t n) {
+    if (f->taille + n > f->capacite) {
+        size_t capacite = f->capacite ? 2 * f->capacite : 4096;
+        while (capacite < f->taille + n) capacite *= 2;
+        unsigned char *agrandi = realloc(f->octets, capacite);
+        if (!agrandi) {
+            fprintf(stderr, "memoire insuffisante\n");
+            exit(1);
+        }
+        f->octets = agrandi;
+        f->capacite = capacite;
+    }
+    memcpy(f->octets + f->taille, octets, n);
+    f->taille += n;
+}
+
+static void ajouter8(Fichier *f, unsigned int valeur) {
+    unsigned char octet = (unsigned char)valeur;
+    ajouter(f, &octet, 1);
+}
+
+static void ajouter16(Fichier *f, unsigned int valeur) {
+    ajouter8(f, valeur);
+    ajouter8(f, valeur >> 8);
+}
+
+static void ajouter32(Fichier *f, uint32_t valeur) {
+    ajouter16(f, valeur & 0xFFFF);
+    ajouter16(f, valeur >> 16);
+}
+
+static void ajouter_texte(Fichier *f, const char *format, ...) {
+    char texte[256];
+    va_list arguments;
+    va_start(arguments, format);
+    int n = vsnprintf(texte, sizeof texte, format, arguments);
+    va_end(arguments);
+    ajouter(f, texte, (size_t)n);
+}
+
+/* Motif de référence : valeurs pseudo-aléatoires constantes par groupes de
+ * 3 pixels d'une ligne (plages pour le RLE TGA) */
+static unsigned int motif(int x, int y, int canal) {
+    unsigned int v = (unsigned int)(x / 3) * 2654435761u ^ (unsigned int)y * 40503u ^
+                     (unsigned int)canal * 977u;
+    v ^= v >> 13;
+    v *= 0x5BD1E995u;
+    return v ^ v >> 15;
+}
+
+/* Échantillon de valeur maximale `maximum` < 255 ramené sur 0..255 */
+static unsigned int sur_255(unsigned int valeur, unsigned int maximum) {
+    return (valeur * 255 + maximum / 2) / maximum;
+}
+
+static void creer_attendu(ImagePNM *attendu, int largeur, int hauteur, int nb_canaux, int valeur_max) {
+    attendu->largeur = (uint16_t)largeur;
+    attendu->hauteur = (uint16_t)hauteur;
+    attendu->type = (uint8_t)nb_canaux;
+    attendu->valeur_max = (uint16_t)valeur_max;
+    attendu->donnees = calloc((size_t)largeur * hauteur * nb_canaux, valeur_max > 255 ? 2 : 1);
+    if (!attendu->donnees) {
+        fprintf(stderr, "memoire insuffisante\n");
+        exit(1);
+    }
+}
+
+static void ranger(ImagePNM *attendu, int x, int y, int canal, unsigned int valeur) {
+    size_t index = ((size_t)y * attendu->largeur + x) * attendu->type + canal;
+    if (attendu->valeur_max > 255)
+        ((uint16_t *)attendu->donnees)[index] = (uint16_t)valeur;
+    else
+        attendu->donnees[index] = (unsigned char)valeur;
+}
+
+/* ---------- BMP ---------- */
+
+static void entete_bmp(Fichier *f, int largeur, int hauteur, int bits, int descendant,
+                       uint32_t compression, uint32_t nb_couleurs, size_t debut_pixels)
+{
+    size_t pas = ((size_t)largeur * bits + 31) / 32 * 4;
+    ajouter(f, "BM", 2);
+    ajouter32(f, (uint32_t)(debut_pixels + pas * hauteur));
+    ajouter32(f, 0);
+    ajouter32(f, (uint32_t)debut_pixels);
+    ajouter32(f, 40);
+    ajouter32(f, (uint32_t)largeur);
+    ajouter32(f, (uint32_t)(descendant ? -hauteur : hauteur));
+    ajouter16(f, 1);
+    ajouter16(f, (unsigned int)bits);
+    ajouter32(f, compression);
+    ajouter32(f, 0);
+    ajouter32(f, 2835);
+    ajouter32(f, 2835);
+    ajouter32(f, nb_couleurs);
+    ajouter32(f, 0);
+}
+
+/* BMP de 1, 4 ou 8 bits à palette de couleurs, ou de gris (lu en gris) */
+static void bmp_palette(Fichier *f, ImagePNM *attendu, int largeur, int hauteur, int bits,
+                        int gris, int descendant)
+{
+    int nb_couleurs = 1 << bits;
+    /* nombre de couleurs 0 (palette complète) pour 1 bit */
+    entete_bmp(f, largeur, hauteur, bits, descendant, 0, bits == 1 ? 0 : (uint32_t)nb_couleurs,
+               14 + 40 + 4 * (size_t)nb_couleurs);
+    unsigned char palette[256][3];
+    for (int k = 0; k < nb_couleurs; k++) {
+        if (gris) {
+            palette[k][0] = palette[k][1] = palette[k][2] = (unsigned char)(k * 255 / (nb_couleurs - 1));
+        } else {
+            palette[k][0] = (unsigned char)(k * 37 + 11);
+            palette[k][1] = (unsigned char)(k * 91 + 3);
+            palette[k][2] = (unsigned char)(k * 53 + 200);
+        }
+        ajouter8(f, palette[k][2]);
+        ajouter8(f, palette[k][1]);
+        ajouter8(f, palette[k][0]);
+        ajouter8(f, 0);
+    }
+    creer_attendu(attendu, largeur, hauteur, gris ? 1 : 3, 255);
+    size_t pas = ((size_t)largeur * bits + 31) / 32 * 4;
+    unsigned char *ligne = malloc(pas);
+    for (int r = 0; r < hauteur; r++) {
+        int y = descendant ? r : hauteur - 1 - r;
+        memset(ligne, 0, pas);
+        for (int x = 0; x < largeur; x++) {
+            unsigned int index = motif(x, y, 0) % (unsigned int)nb_couleurs;
+            size_t bit = (size_t)x * bits;
+            ligne[bit / 8] |= (unsigned char)(index << (8 - bits - bit % 8));
+            for (int canal = 0; canal < attendu->type; canal++)
+                ranger(attendu, x, y, canal, palette[index][canal]);
+        }
+        ajouter(f, ligne, pas);
+    }
+    free(ligne);
+}
+
+/* BMP de 16 ou 32 bits (masques par défaut, ou BI_BITFIELDS avec
+ * `masques`) et de 24 bits */
+static void bmp_direct(Fichier *f, ImagePNM *attendu, int largeur, int hauteur, int bits,
+                       const uint32_t *masques, int descendant)
+{
+    uint32_t defaut16[3] = { 0x7C00, 0x03E0, 0x001F }, defaut32[3] = { 0xFF0000, 0xFF00, 0xFF };
+    const uint32_t *choisis = masques ? masques : bits == 16 ? defaut16 : defaut32;
+    entete_bmp(f, largeur, hauteur, bits, descendant, masques ? 3 : 0, 0,
+               14 + 40 + (masques ? 12 : 0));
+    if (masques)
+        for (int i = 0; i < 3; i++)
+            ajouter32(f, masques[i]);
+    creer_attendu(attendu, largeur, hauteur, 3, 255);
+    size_t pas = ((size_t)largeur * bits + 31) / 32 * 4;
+    for (int r = 0; r < hauteur; r++) {
+        int y = descendant ? r : hauteur - 1 - r;
+        size_t ecrits = 0;
+        for (int x = 0; x < largeur; x++) {
+            if (bits == 24) {
+                for (int canal = 2; canal >= 0; canal--) {
+                    unsigned int valeur = motif(x, y, canal) & 255;
+                    ajouter8(f, valeur);
+                    ranger(attendu, x, y, canal, valeur);
+                }
+                ecrits += 3;
+                continue;
+            }
+            /* bits hors des masques à 1 : transparence ignorée */
+            uint32_t pixel = ~(choisis[0] | choisis[1] | choisis[2]);
+            for (int canal = 0; canal < 3; canal++) {
+                int decalage = 0;
+                while (!(choisis[canal] >> decalage & 1)) decalage++;
+                uint32_t maximum = choisis[canal] >> decalage;
+                uint32_t valeur = motif(x, y, canal) % (maximum + 1);
+                pixel = (pixel & ~choisis[canal]) | valeur << decalage;
+                ranger(attendu, x, y, canal, maximum == 255 ? valeur : sur_255(valeur, maximum));
+            }
+            if (bits == 16)
+                ajouter16(f, pixel & 0xFFFF);
+            else
+                ajouter32(f, pixel);
+            ecrits += (size_t)bits / 8;
+        }
+        for (; ecrits < pas; ecrits++)
+            ajouter8(f, 0);
+    }
+}
+
+/* ---------- TGA ---------- */
+
+/* Pixels `octets` par `octets` en paquets RLE : répétés quand deux pixels
+ * se suivent à l'identique, bruts sinon */
+static void compresser_tga(Fichier *f, const unsigned char *pixels, size_t nb_pixels, int octets) {
+    for (size_t i = 0; i < nb_pixels; ) {
+        size_t n = 1;
+        while (i + n < nb_pixels && n < 128 &&
+               !memcmp(pixels + (i + n) * octets, pixels + i * octets, (size_t)octets))
+            n++;
+        if (n > 1) {
+            ajouter8(f, 0x80 | (unsigned int)(n - 1));
+            ajouter(f, pixels + i * octets, (size_t)octets);
+        } else {
+            while (i + n < nb_pixels && n < 128 &&
+                   (i + n + 1 == nb_pixels ||
+                    memcmp(pixels + (i + n) * octets, pixels + (i + n + 1) * octets, (size_t)octets)))
+                n++;
+            ajouter8(f, (unsigned int)(n - 1));
+            ajouter(f, pixels + i * octets, n * octets);
+        }
+        i += n;
+    }
+}
+
+/* TGA indexé (type 1, palette de 24 bits), RGB de 15, 16, 24 ou 32 bits
+ * (type 2) ou gris (type 3), brut ou RLE ; `origine` : bits 0x10 (de droite
+ * à gauche) et 0x20 (de haut en bas) de l'octet de description */
+static void tga(Fichier *f, ImagePNM *attendu, int largeur, int hauteur, int type, int bits,
+                int rle, int origine)
+{
+    int octets = (bits + 7) / 8;
+    ajouter8(f, 2);                         /* identifiant de 2 octets */
+    ajouter8(f, type == 1);
+    ajouter8(f, (unsigned int)(type | (rle ? 8 : 0)));
+    ajouter16(f, 0);
+    ajouter16(f, type == 1 ? 256 : 0);
+    ajouter8(f, type == 1 ? 24 : 0);
+    ajouter16(f, 0);
+    ajouter16(f, 0);
+    ajouter16(f, (unsigned int)largeur);
+    ajouter16(f, (unsigned int)hauteur);
+    ajouter8(f, (unsigned int)bits);
+    ajouter8(f, (unsigned int)origine | (bits == 32 ? 8 : bits == 16 ? 1 : 0));
+    ajouter(f, "id", 2);
+    unsigned char palette[256][3];
+    if (type == 1)
+        for (int k = 0; k < 256; k++) {
+            palette[k][0] = (unsigned char)(k * 37 + 11);
+            palette[k][1] = (unsigned char)(k * 91 + 3);
+            palette[k][2] = (unsigned char)(k * 53 + 200);
+            ajouter8(f, palette[k][2]);
+            ajouter8(f, palette[k][1]);
+            ajouter8(f, palette[k][0]);
+        }
+    creer_attendu(attendu, largeur, hauteur, type == 3 ? 1 : 3, 255);
+    unsigned char *pixels = malloc((size_t)largeur * hauteur * octets), *p = pixels;
+    for (int r = 0; r < hauteur; r++)
+        for (int c = 0; c < largeur; c++) {
+            int y = (origine & 0x20) ? r : hauteur - 1 - r;
+            int x = (origine & 0x10) ? largeur - 1 - c : c;
+            if (type == 1) {
+                unsigned int index = motif(x, y, 0) & 255;
+                *p++ = (unsigned char)index;
+                for (int canal = 0; canal < 3; canal++)
+                    ranger(attendu, x, y, canal, palette[index][canal]);
+            } else if (type == 3) {
+                *p = (unsigned char)motif(x, y, 0);
+                ranger(attendu, x, y, 0, *p++);
+            } else if (octets == 2) {
+                unsigned int pixel = 0x8000;  /* bit de transparence ignoré */
+                for (int canal = 0; canal < 3; canal++) {
+                    unsigned int valeur = motif(x, y, canal) & 31;
+                    pixel |= valeur << (10 - 5 * canal);
+                    ranger(attendu, x, y, canal, valeur << 3 | valeur >> 2);
+                }
+                *p++ = (unsigned char)pixel;
+                *p++ = (unsigned char)(pixel >> 8);
+            } else {
+                for (int canal = 2; canal >= 0; canal--) {
+                    *p = (unsigned char)motif(x, y, canal);
+                    ranger(attendu, x, y, canal, *p++);
+                }
+                if (octets == 4) *p++ = 0x80;
+            }
+        }
+    if (rle)
+        compresser_tga(f, pixels, (size_t)largeur * hauteur, octets);
+    else
+        ajouter(f, pixels, (size_t)largeur * hauteur * octets);
+    free(pixels);
+}
+
+/* ---------- PAM et PNM ---------- */
+
+/* Échantillon de référence d'une image de valeur maximale `maximum` et sa
+ * valeur attendue après lecture */
+static unsigned int echantillon(int x, int y, int canal, unsigned int maximum, unsigned int *lu) {
+    unsigned int valeur = motif(x, y, canal) % (maximum + 1);
+    *lu = maximum < 255 ? sur_255(valeur, maximum) : valeur;
+    return valeur;
+}
+
+static void ajouter_echantillon(Fichier *f, unsigned int valeur, unsigned int maximum) {
+    if (maximum > 255) ajouter8(f, valeur >> 8);
+    ajouter8(f, valeur);
+}
+
+/* PAM de profondeur 1 à 4 (la transparence, 2 et 4, est ignorée) */
+static void pam(Fichier *f, ImagePNM *attendu, int largeur, int hauteur, int profondeur,
+                unsigned int maximum)
+{
+    static const char *const tuples[] = { "GRAYSCALE", "GRAYSCALE_ALPHA", "RGB", "RGB_ALPHA" };
+    ajouter_texte(f, "P7\nWIDTH %d\nHEIGHT %d\n# commentaire\nDEPTH %d\nMAXVAL %u\nTUPLTYPE %s\nENDHDR\n",
+                  largeur, hauteur, profondeur, maximum, tuples[profondeur - 1]);
+    int nb_canaux = profondeur >= 3 ? 3 : 1;
+    creer_attendu(attendu, largeur, hauteur, nb_canaux, maximum > 255 ? (int)maximum : 255);
+    for (int y = 0; y < hauteur; y++)
+        for (int x = 0; x < largeur; x++)
+            for (int canal = 0; canal < profondeur; canal++) {
+                unsigned int lu;
+                ajouter_echantillon(f, echantillon(x, y, canal, maximum, &lu), maximum);
+                if (canal < nb_canaux) ranger(attendu, x, y, canal, lu);
+            }
+}
+
+/* PNM ASCII (P2, P3) ou binaire (P5, P6), commentaires dans l'en-tête */
+static void pnm(Fichier *f, ImagePNM *attendu, int largeur, int hauteur, int nb_canaux,
+                unsigned int maximum, int ascii)
+{
+    ajouter_texte(f, "P%d\n# commentaire\n%d %d # fin de ligne\n%u\n",
+                  (ascii ? 2 : 5) + (nb_canaux == 3), largeur, hauteur, maximum);
+    creer_attendu(attendu, largeur, hauteur, nb_canaux, maximum > 255 ? (int)maximum : 255);
+    for (int y = 0; y < hauteur; y++) {
+        for (int x = 0; x < largeur; x++)
+            for (int canal = 0; canal < nb_canaux; canal++) {
+                unsigned int lu, valeur = echantillon(x, y, canal, maximum, &lu);
+                if (ascii)
+                    ajouter_texte(f, "%u ", valeur);
+                else
+                    ajouter_echantillon(f, valeur, maximum);
+                ranger(attendu, x, y, canal, lu);
+            }
+        if (ascii) ajouter_texte(f, "\n");
+    }
+}
+
+/* ---------- vérification ---------- */
+
+/* Lecture par lire_image du fichier `f` écrit sur disque ; DIF_ERR_IO si
+ * le fichier temporaire n'a pas pu être écrit */
+static int lire_fichier_test(const Fichier *f, ImagePNM *image) {
+    char chemin[] = "/tmp/bench_formats_XXXXXX";
+    int fd = mkstemp(chemin);
+    if (fd < 0) return DIF_ERR_IO;
+    int ecrit = write(fd, f->octets, f->taille) == (ssize_t)f->taille;
+    close(fd);
+    int err = ecrit ? lire_image(chemin, image) : DIF_ERR_IO;
+    remove(chemin);
+    return err;
+}
+
+static int memes_pixels(const ImagePNM *image, const ImagePNM *attendu) {
+    size_t taille = (size_t)attendu->largeur * attendu->hauteur * attendu->type *
+                    (attendu->valeur_max > 255 ? 2 : 1);
+    return image->largeur == attendu->largeur && image->hauteur == attendu->hauteur &&
+           image->type == attendu->type && image->valeur_max == attendu->valeur_max &&
+           !memcmp(image->donnees, attendu->donnees, taille);
+}
+
+/* Lecture comparée à l'image attendue, puis aller-retour DIF sans perte */
+static int verifier(dif_context *contexte, const char *nom, Fichier *f, ImagePNM *attendu) {
+    ImagePNM image = {0};
+    int err = lire_fichier_test(f, &image);
+    int lecture = err == DIF_OK && memes_pixels(&image, attendu);
+    int aller_retour = 0;
+    if (lecture) {
+        FormatImageDIF format = { image.largeur, image.hauteur, image.type, 0, 0, image.valeur_max };
+        TamponDIF dif = {0}, sortie = {0};
+        if (dif_encode_mem_ctx(contexte, image.donnees, &format, &dif) == DIF_OK &&
+            dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &format, &sortie) == DIF_OK) {
+            ImagePNM decode = { (uint16_t)format.largeur, (uint16_t)format.hauteur,
+                                (uint8_t)format.nb_canaux, sortie.donnees, image.valeur_max };
+            aller_retour = memes_pixels(&decode, attendu);
+        }
+        free(dif.donnees);
+        free(sortie.donnees);
+    }
+    printf("%-22s %6zu octets  lecture : %-9s aller-retour : %s\n", nom, f->taille,
+           err != DIF_OK ? "ERREUR" : lecture ? "ok" : "DIFFERENT",
+           aller_retour ? "ok" : lecture ? "DIFFERENT" : "-");
+    free(image.donnees);
+    free(attendu->donnees);
+    f->taille = 0;
+    return lecture && aller_retour;
+}
+
+/* Débit de lire_image (Mo/s de pixels lus) sur une grande image */
+static int mesurer(const char *nom, Fichier *f, ImagePNM *attendu, int repetitions) {
+    char chemin[] = "/tmp/bench_formats_XXXXXX";
+    int fd = mkstemp(chemin);
+    if (fd < 0) return 0;
+    int ok = write(fd, f->octets, f->taille) == (ssize_t)f->taille;
+    close(fd);
+    double t0 = secondes();
+    for (int r = 0; r < repetitions && ok; r++) {
+        ImagePNM image = {0};
+        ok = lire_image(chemin, &image) == DIF_OK && memes_pixels(&image, attendu);
+        free(image.donnees);
+    }
+    double t = secondes() - t0;
+    remove(chemin);
+    double mo = (double)attendu->largeur * attendu->hauteur * attendu->type * repetitions / 1e6;
+    printf("%-22s %5dx%-5d  lecture : %8.1f Mo/s  %s\n", nom, attendu->largeur, attendu->hauteur,
+           mo / t, ok ? "ok" : "DIFFERENT");
+    free(attendu->donnees);
+    f->taille = 0;
+    return ok;
+}
+
+int main(void) {
+    OptionsDIF options;
+    options_dif_defaut(&options);
+    options.modes = DIF_MODE_SANS_PERTE;
+    dif_context *contexte = dif_context_creer(&options);
+    if (!contexte) return 1;
+    Fichier f = {0};
+    ImagePNM attendu;
+    char nom[64];
+    int ok = 1;
+
+    for (int descendant = 0; descendant <= 1; descendant++) {
+        const char *sens = descendant ? "haut-bas" : "bas-haut";
+        static const int bits_palette[] = { 1, 4, 8 };
+        for (int i = 0; i < 3; i++)
+            for (int gris = 0; gris <= 1; gris++) {
+                bmp_palette(&f, &attendu, LARGEUR, HAUTEUR, bits_palette[i], gris, descendant);
+                snprintf(nom, sizeof nom, "bmp %d%s %s", bits_palette[i], gris ? " gris" : "", sens);
+                ok &= verifier(contexte, nom, &f, &attendu);
+            }
+        static const uint32_t masques16[3] = { 0xF800, 0x07E0, 0x001F };
+        static const uint32_t masques32[3] = { 0x000000FF, 0x0000FF00, 0x00FF0000 };
+        static const uint32_t masques32_10[3] = { 0x3FF00000, 0x000FFC00, 0x000003FF };
+        struct { int bits; const uint32_t *masques; const char *nom; } directs[] = {
+            { 16, NULL, "bmp 16" }, { 16, masques16, "bmp 16 565" }, { 24, NULL, "bmp 24" },
+            { 32, NULL, "bmp 32" }, { 32, masques32, "bmp 32 rgba" }, { 32, masques32_10, "bmp 32 10b" },
+        };
+        for (size_t i = 0; i < sizeof directs / sizeof directs[0]; i++) {
+            bmp_direct(&f, &attendu, LARGEUR, HAUTEUR, directs[i].bits, directs[i].masques, descendant);
+            snprintf(nom, sizeof nom, "%s %s", directs[i].nom, sens);
+            ok &= verifier(contexte, nom, &f, &attendu);
+        }
+    }
+
+    struct { int type, bits; } tgas[] = { { 1, 8 }, { 2, 15 }, { 2, 16 }, { 2, 24 }, { 2, 32 }, { 3, 8 } };
+    for (size_t i = 0; i < sizeof tgas / sizeof tgas[0]; i++)
+        for (int rle = 0; rle <= 1; rle++)
+            for (int origine = 0; origine <= 0x30; origine += 0x10) {
+                tga(&f, &attendu, LARGEUR, HAUTEUR, tgas[i].type, tgas[i].bits, rle, origine);
+                snprintf(nom, sizeof nom, "tga %d %d%s %s%s", tgas[i].type, tgas[i].bits,
+                         rle ? " rle" : "", origine & 0x20 ? "h" : "b", origine & 0x10 ? "d" : "g");
+                ok &= verifier(contexte, nom, &f, &attendu);
+            }
+
+    static const unsigned int maximums[] = { 1, 15, 255, 1000, 65535 };
+    for (int profondeur = 1; profondeur <= 4; profondeur++)
+        for (int i = 0; i < 5; i++) {
+            pam(&f, &attendu, LARGEUR, HAUTEUR, profondeur, maximums[i]);
+            snprintf(nom, sizeof nom, "pam %d max %u", profondeur, maximums[i]);
+            ok &= verifier(contexte, nom, &f, &attendu);
+        }
+    for (int ascii = 1; ascii >= 0; ascii--)
+        for (int nb_canaux = 1; nb_canaux <= 3; nb_canaux += 2)
+            for (int i = 0; i < 5; i++) {
+                pnm(&f, &attendu, LARGEUR, HAUTEUR, nb_canaux, maximums[i], ascii);
+                snprintf(nom, sizeof nom, "P%d max %u", (ascii ? 2 : 5) + (nb_canaux == 3), maximums[i]);
+                ok &= verifier(contexte, nom, &f, &attendu);
+            }
+
+    bmp_direct(&f, &attendu, 2048, 2048, 24, NULL, 0);
+    ok &= mesurer("bmp 24", &f, &attendu, 5);
+    tga(&f, &attendu, 2048, 2048, 2, 24, 1, 0);
+    ok &= mesurer("tga 24 rle", &f, &attendu, 5);
+    pnm(&f, &attendu, 1024, 1024, 3, 255, 1);
+    ok &= mesurer("P3", &f, &attendu, 3);
+
+    free(f.octets);
+    dif_context_detruire(contexte);
+    return ok ? 0 : 1;
+}
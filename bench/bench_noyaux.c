@@ -0,0 +1,171 @@
+/* Benchmark des noyaux vectoriels : chaque niveau disponible contre la
+ * version scalaire, sorties comparées octet à octet */
+#include "codec_interne.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TAILLE (1u << 22)
+#define REPETITIONS 50
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Entrées : échantillons bruités, deltas signés, valeurs hors de [0,127]
+ * comprises ; échantillons et valeurs sur 16 bits (TAILLE / 2 échantillons) */
+typedef struct {
+    uint8_t *echantillons;
+    int8_t *deltas;
+    int32_t *valeurs;
+    uint16_t *echantillons16;
+    int32_t *valeurs16;
+    uint8_t *sortie;
+    uint8_t *reference;
+} Donnees;
+
+static void generer(Donnees *d) {
+    unsigned int graine = 12345;
+    for (size_t i = 0; i < TAILLE; i++) {
+        graine = graine * 1103515245u + 12345u;
+        d->echantillons[i] = (uint8_t)(i / 64 + (graine >> 16) % 9);
+        d->deltas[i] = (int8_t)(graine >> 24);
+        d->valeurs[i] = (int32_t)((graine >> 8) % 400) - 100;
+        d->valeurs16[i] = (int32_t)((graine >> 4) % 140000) - 4000;
+        if (i < TAILLE / 2)
+            d->echantillons16[i] = (uint16_t)(i * 7 + (graine >> 16) % 600);
+    }
+    d->valeurs[0] = -2147483647 - 1;
+    d->valeurs[1] = 2147483647;
+}
+
+enum { REPLIER, REPLIER_SANS_PERTE, TEMPOREL, TEMPOREL_SANS_PERTE, VISUALISER, RESTAURER, TRONQUER,
+       REPLIER16, MED16, TEMPOREL16, RESTAURER16, RESTAURER16_SANS_PERTE, SOMMER2, SOMMER4, SOMMER8 };
+
+/* Ligne précédente des résidus MED sur 16 bits */
+#define DECALAGE_LIGNE16 4096
+/* Image précédente des écarts temporels */
+#define DECALAGE_IMAGE 65536
+
+static void executer(const NoyauxDIF *noyaux, int noyau, Donnees *d, int nb_canaux) {
+    switch (noyau) {
+    case REPLIER:
+    case REPLIER_SANS_PERTE:
+        noyaux->replier_differences(d->echantillons + nb_canaux, TAILLE - nb_canaux,
+                                    nb_canaux, noyau == REPLIER, d->sortie);
+        break;
+    case TEMPOREL:
+    case TEMPOREL_SANS_PERTE:
+        noyaux->replier_ecarts_temporels(d->echantillons + DECALAGE_IMAGE, d->echantillons,
+                                         TAILLE - DECALAGE_IMAGE, noyau == TEMPOREL, d->sortie);
+        break;
+    case VISUALISER:
+        noyaux->visualiser_deltas(d->deltas, d->sortie, TAILLE);
+        break;
+    case RESTAURER:
+        noyaux->restaurer_valeurs(d->valeurs, d->sortie, TAILLE);
+        break;
+    case TRONQUER:
+        noyaux->tronquer_valeurs(d->valeurs, d->sortie, TAILLE);
+        break;
+    case REPLIER16:
+        noyaux->replier_differences16(d->echantillons16 + nb_canaux, TAILLE / 2 - nb_canaux,
+                                      nb_canaux, 1, (uint16_t *)d->sortie);
+        break;
+    case MED16:
+        noyaux->replier_residus_med16(d->echantillons16 + nb_canaux + DECALAGE_LIGNE16,
+                                      d->echantillons16 + nb_canaux,
+                                      TAILLE / 2 - nb_canaux - DECALAGE_LIGNE16, nb_canaux, 0,
+                                      (uint16_t *)d->sortie);
+        break;
+    case TEMPOREL16:
+        noyaux->replier_ecarts_temporels16(d->echantillons16 + DECALAGE_IMAGE, d->echantillons16,
+                                           TAILLE / 2 - DECALAGE_IMAGE, 1, (uint16_t *)d->sortie);
+        break;
+    case SOMMER2:
+    case SOMMER4:
+    case SOMMER8: {
+        /* pixels en nombre quelconque (dernier bloc tronqué), sommes
+         * ajoutées d'un appel à l'autre (modulo 65536) */
+        int facteur = 2 << (noyau - SOMMER2);
+        size_t nb_pixels = TAILLE / nb_canaux - 5;
+        noyaux->sommer_blocs(d->echantillons, nb_pixels, nb_canaux, facteur, (uint16_t *)d->sortie,
+                             (nb_pixels + facteur - 1) / facteur);
+        break;
+    }
+    default:
+        noyaux->restaurer_valeurs16(d->valeurs16, (uint16_t *)d->sortie, TAILLE / 2,
+                                    noyau == RESTAURER16);
+        break;
+    }
+}
+
+/* Débit d'un noyau (Mo/s d'échantillons), sortie laissée dans d->sortie */
+static double mesurer(const NoyauxDIF *noyaux, int noyau, Donnees *d, int nb_canaux) {
+    executer(noyaux, noyau, d, nb_canaux);
+    double t0 = secondes();
+    for (int r = 0; r < REPETITIONS; r++)
+        executer(noyaux, noyau, d, nb_canaux);
+    return (double)TAILLE * REPETITIONS / 1e6 / (secondes() - t0);
+}
+
+int main(void) {
+    static const struct { const char *nom; int noyau; int nb_canaux; } tests[] = {
+        { "replier (gris)", REPLIER, 1 },
+        { "replier (couleur)", REPLIER, 3 },
+        { "replier sans perte", REPLIER_SANS_PERTE, 3 },
+        { "temporel", TEMPOREL, 1 },
+        { "temporel entier", TEMPOREL_SANS_PERTE, 1 },
+        { "visualiser", VISUALISER, 1 },
+        { "restaurer", RESTAURER, 1 },
+        { "tronquer", TRONQUER, 1 },
+        { "replier 16 bits", REPLIER16, 3 },
+        { "med 16 bits", MED16, 3 },
+        { "temporel 16 bits", TEMPOREL16, 1 },
+        { "restaurer 16 bits", RESTAURER16, 1 },
+        { "tronquer 16 bits", RESTAURER16_SANS_PERTE, 1 },
+        { "blocs 2 (gris)", SOMMER2, 1 },
+        { "blocs 8 (gris)", SOMMER8, 1 },
+        { "blocs 2 (couleur)", SOMMER2, 3 },
+        { "blocs 4 (couleur)", SOMMER4, 3 },
+    };
+    Donnees d = { malloc(TAILLE), malloc(TAILLE), malloc(TAILLE * sizeof(int32_t)),
+                  malloc(TAILLE), malloc(TAILLE * sizeof(int32_t)), malloc(TAILLE), malloc(TAILLE) };
+    if (!d.echantillons || !d.deltas || !d.valeurs || !d.echantillons16 || !d.valeurs16 ||
+        !d.sortie || !d.reference)
+        return 1;
+    generer(&d);
+    const NoyauxDIF *scalaires = noyaux_niveau(DIF_NOYAUX_SCALAIRE);
+    printf("noyaux retenus : %s\n", noyaux_dif()->nom);
+    int ok = 1;
+    for (size_t test = 0; test < sizeof tests / sizeof tests[0]; test++) {
+        int noyau = tests[test].noyau;
+        int nb_canaux = tests[test].nb_canaux;
+        memset(d.sortie, 0, TAILLE);
+        double reference = mesurer(scalaires, noyau, &d, nb_canaux);
+        memcpy(d.reference, d.sortie, TAILLE);
+        printf("%-18s scalaire : %8.1f Mo/s", tests[test].nom, reference);
+        for (int niveau = DIF_NOYAUX_SSE2; niveau <= DIF_NOYAUX_AVX2; niveau++) {
+            const NoyauxDIF *noyaux = noyaux_niveau(niveau);
+            if (!noyaux) continue;
+            memset(d.sortie, 0, TAILLE);
+            double debit = mesurer(noyaux, noyau, &d, nb_canaux);
+            int identique = memcmp(d.sortie, d.reference, TAILLE - 3) == 0;
+            ok &= identique;
+            printf("   %s : %8.1f Mo/s x%.1f %s", noyaux->nom, debit, debit / reference,
+                   identique ? "ok" : "DIFFERENT");
+        }
+        printf("\n");
+    }
+    free(d.echantillons);
+    free(d.deltas);
+    free(d.valeurs);
+    free(d.echantillons16);
+    free(d.valeurs16);
+    free(d.sortie);
+    free(d.reference);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+/* Benchmark des sorties couleur en 4K et 8K : décodage entrelacé contre
+ * décodage en plans séparés, et noyaux de séparation/entrelacement */
+#include "codec_interne.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Image de test : dégradés et bruit, proche d'une photo numérisée */
+static void generer_image(unsigned char *pixels, int largeur, int hauteur) {
+    unsigned int graine = 12345;
+    for (int y = 0; y < hauteur; y++)
+        for (int x = 0; x < largeur; x++)
+            for (int c = 0; c < 3; c++) {
+                graine = graine * 1103515245u + 12345u;
+                int bruit = (int)((graine >> 16) % 9) - 4;
+                *pixels++ = (unsigned char)(((x * (c + 1) + y) / 8 + bruit) & 255);
+            }
+}
+
+/* Débit d'un réarrangement d'une image complète (Mo/s d'échantillons) */
+static double mesurer_noyau(const NoyauxDIF *noyaux, int separer, unsigned char *entrelace,
+                            unsigned char *plan, size_t nb_pixels, int repetitions)
+{
+    unsigned char *plans[3] = { plan, plan + nb_pixels, plan + 2 * nb_pixels };
+    double t0 = secondes();
+    for (int r = 0; r < repetitions; r++) {
+        if (separer)
+            noyaux->separer_plans(entrelace, nb_pixels, plans);
+        else
+            noyaux->entrelacer_plans((const uint8_t *const *)plans, nb_pixels, entrelace);
+    }
+    return 3.0 * nb_pixels * repetitions / 1e6 / (secondes() - t0);
+}
+
+static int mesurer(const char *nom, int largeur, int hauteur, int repetitions) {
+    size_t nb_pixels = (size_t)largeur * hauteur;
+    size_t taille = 3 * nb_pixels;
+    unsigned char *image = malloc(taille), *plans = malloc(taille), *copie = malloc(taille);
+    if (!image || !plans || !copie) return 0;
+    generer_image(image, largeur, hauteur);
+
+    dif_context *contexte = dif_context_creer(NULL);
+    FormatImageDIF entrelace = { largeur, hauteur, 3, 0, 0 };
+    FormatImageDIF separe = { largeur, hauteur, 3, 0, 1 };
+    TamponDIF dif = {0}, sortie = {0}, sortie_plans = {0}, dif_plans = {0};
+    int ok = dif_encode_mem_ctx(contexte, image, &entrelace, &dif) == DIF_OK;
+
+    double t0 = secondes();
+    for (int r = 0; r < repetitions && ok; r++)
+        ok = dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &entrelace, &sortie) == DIF_OK;
+    double t1 = secondes();
+    for (int r = 0; r < repetitions && ok; r++)
+        ok = dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &separe, &sortie_plans) == DIF_OK;
+    double t2 = secondes();
+
+    /* plans décodés = plans de l'image entrelacée ; l'encodage depuis les
+     * plans redonne le même fichier */
+    if (ok) {
+        unsigned char *reference[3] = { plans, plans + nb_pixels, plans + 2 * nb_pixels };
+        noyaux_niveau(DIF_NOYAUX_SCALAIRE)->separer_plans(sortie.donnees, nb_pixels, reference);
+        ok = memcmp(plans, sortie_plans.donnees, taille) == 0 &&
+             dif_encode_mem_ctx(contexte, sortie_plans.donnees, &separe, &dif_plans) == DIF_OK;
+        FormatImageDIF format = separe;
+        TamponDIF tampon = { copie, 0, taille, NULL, NULL };
+        ok = ok && dif_decode_mem_ctx(contexte, dif_plans.donnees, dif_plans.taille,
+                                      &format, &tampon) == DIF_OK &&
+             memcmp(copie, sortie_plans.donnees, taille) == 0;
+    }
+    double mo = (double)taille * repetitions / 1e6;
+    printf("%-3s %5dx%-5d  decodage entrelace : %7.1f Mo/s   en plans : %7.1f Mo/s  %s\n",
+           nom, largeur, hauteur, mo / (t1 - t0), mo / (t2 - t1), ok ? "ok" : "DIFFERENT");
+
+    for (int niveau = DIF_NOYAUX_SCALAIRE; niveau <= DIF_NOYAUX_AVX2; niveau++) {
+        const NoyauxDIF *noyaux = noyaux_niveau(niveau);
+        if (!noyaux) continue;
+        printf("    %-9s separation : %8.1f Mo/s   entrelacement : %8.1f Mo/s\n", noyaux->nom,
+               mesurer_noyau(noyaux, 1, sortie.donnees, plans, nb_pixels, repetitions),
+               mesurer_noyau(noyaux, 0, copie, plans, nb_pixels, repetitions));
+        ok = ok && memcmp(copie, sortie.donnees, taille) == 0;
+    }
+
+    free(dif.donnees);
+    free(dif_plans.donnees);
+    free(sortie.donnees);
+    free(sortie_plans.donnees);
+    dif_context_detruire(contexte);
+    free(image);
+    free(plans);
+    free(copie);
+    return ok;
+}
+
+int main(void) {
+    int ok = 1;
+    ok &= mesurer("4K", 3840, 2160, 5);
+    ok &= mesurer("8K", 7680, 4320, 2);
+    return ok ? 0 : 1;
+}
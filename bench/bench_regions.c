@@ -0,0 +1,194 @@
+/* Benchmark du décodage de régions : chaque rectangle décodé par
+ * dif_decode_region_ctx est comparé au même rectangle découpé dans le
+ * décodage complet, pour des fichiers classiques et en bandes (rectangles
+ * à cheval sur les bandes), des sorties entrelacées, en plans séparés ou à
+ * pas élargi et des échantillons sur 16 bits ; les rectangles hors de
+ * l'image doivent être refusés. Gain d'une région sur le décodage complet
+ * d'une grande image. */
+#include "codec_interne.h"
+#include "bench_commun.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LARGEUR 301
+#define HAUTEUR 203
+#define HAUTEUR_BANDE 16
+#define NB_CHOISIS 10
+#define NB_ALEATOIRES 24
+
+/* Région décodée (au format `format`) identique au rectangle (x, y) de
+ * l'image complète, lignes contiguës */
+static int comparer_region(const unsigned char *complete, int largeur_complete, int nb_canaux,
+                           size_t octets, int x, int y, const FormatImageDIF *format,
+                           const unsigned char *region)
+{
+    size_t pas_complet = (size_t)largeur_complete * nb_canaux * octets;
+    int plans = format->plans && nb_canaux == 3;
+    for (int ligne = 0; ligne < format->hauteur; ligne++) {
+        const unsigned char *source = complete + (size_t)(y + ligne) * pas_complet +
+                                      (size_t)x * nb_canaux * octets;
+        if (!plans) {
+            if (memcmp(region + (size_t)ligne * format->pas, source,
+                       (size_t)format->largeur * nb_canaux * octets))
+                return 0;
+            continue;
+        }
+        for (int canal = 0; canal < 3; canal++) {
+            const unsigned char *plan = region + (size_t)canal * format->hauteur * format->pas +
+                                        (size_t)ligne * format->pas;
+            for (int colonne = 0; colonne < format->largeur; colonne++)
+                if (plan[colonne] != source[3 * colonne + canal]) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Un fichier encodé avec `options` : régions choisies et aléatoires dans
+ * chaque disposition de sortie, puis rectangles refusés */
+static int verifier(const char *nom, int nb_canaux, int valeur_max, const OptionsDIF *options) {
+    unsigned char *image = generer_image(LARGEUR, HAUTEUR, nb_canaux, valeur_max);
+    dif_context *contexte = dif_context_creer(options);
+    FormatImageDIF format = { LARGEUR, HAUTEUR, nb_canaux, 0, 0, valeur_max };
+    TamponDIF dif = {0}, complete = {0}, region = {0};
+    int ok = image && contexte && dif_encode_mem_ctx(contexte, image, &format, &dif) == DIF_OK;
+    FormatImageDIF format_complet = { 0 };
+    ok = ok && dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &format_complet, &complete) == DIF_OK;
+    size_t octets = valeur_max > 255 ? 2 : 1;
+
+    /* rectangles : image entière, coins, lignes de part et d'autre d'une
+     * limite de bande, plusieurs bandes, une bande exacte, dernière bande
+     * partielle, puis tirés au hasard */
+    int rectangles[NB_CHOISIS + NB_ALEATOIRES][4] = {
+        { 0, 0, LARGEUR, HAUTEUR }, { 0, 0, 1, 1 }, { LARGEUR - 1, HAUTEUR - 1, 1, 1 },
+        { 5, HAUTEUR_BANDE - 1, 40, 2 }, { 0, HAUTEUR_BANDE, LARGEUR, HAUTEUR_BANDE },
+        { 17, 10, 123, 3 * HAUTEUR_BANDE }, { LARGEUR - 30, HAUTEUR - 5, 30, 5 },
+        { 3, HAUTEUR - HAUTEUR_BANDE - 2, 7, HAUTEUR_BANDE + 2 }, { 100, 50, 1, 100 },
+        { 0, 2 * HAUTEUR_BANDE - 1, LARGEUR, 1 },
+    };
+    int nb_rectangles = NB_CHOISIS;
+    while (nb_rectangles < NB_CHOISIS + NB_ALEATOIRES) {
+        int *r = rectangles[nb_rectangles++];
+        r[0] = (int)(aleatoire() % LARGEUR);
+        r[1] = (int)(aleatoire() % HAUTEUR);
+        r[2] = 1 + (int)(aleatoire() % (unsigned int)(LARGEUR - r[0]));
+        r[3] = 1 + (int)(aleatoire() % (unsigned int)(HAUTEUR - r[1]));
+    }
+    /* dispositions de sortie : lignes contiguës, pas élargi, plans séparés
+     * (couleur 8 bits), plans à pas élargi */
+    struct { size_t marge; int plans; } sorties[] = { { 0, 0 }, { 6, 0 }, { 0, 1 }, { 10, 1 } };
+    int nb_sorties = nb_canaux == 3 && octets == 1 ? 4 : 2;
+    int nb_regions = 0;
+    for (int i = 0; i < nb_rectangles && ok; i++)
+        for (int s = 0; s < nb_sorties && ok; s++) {
+            const int *r = rectangles[i];
+            size_t octets_ligne = (size_t)r[2] * (sorties[s].plans ? 1 : nb_canaux) * octets;
+            FormatImageDIF demande = { 0, 0, 0, sorties[s].marge ? octets_ligne + sorties[s].marge : 0,
+                                       sorties[s].plans, 0 };
+            ok = dif_decode_region_ctx(contexte, dif.donnees, dif.taille, r[0], r[1], r[2], r[3],
+                                       &demande, &region) == DIF_OK &&
+                 demande.largeur == r[2] && demande.hauteur == r[3] &&
+                 comparer_region(complete.donnees, LARGEUR, nb_canaux, octets, r[0], r[1], &demande,
+                                 region.donnees);
+            if (!ok)
+                printf("  region (%d, %d) %dx%d, pas %zu%s : DIFFERENT\n", r[0], r[1], r[2], r[3],
+                       demande.pas, sorties[s].plans ? ", plans" : "");
+            nb_regions++;
+        }
+
+    /* rectangles hors de l'image, vides ou débordant (y compris par
+     * dépassement d'entier) */
+    static const int refuses[][4] = {
+        { -1, 0, 1, 1 }, { 0, -1, 1, 1 }, { 0, 0, 0, 1 }, { 0, 0, 1, 0 }, { 0, 0, -5, 1 },
+        { LARGEUR, 0, 1, 1 }, { 0, HAUTEUR, 1, 1 }, { LARGEUR - 10, 0, 11, 1 },
+        { 0, HAUTEUR - 1, 1, 2 }, { 1, 0, INT_MAX, 1 }, { 0, 1, 1, INT_MAX },
+        { INT_MAX, 0, 1, 1 }, { 0, INT_MIN, 1, 1 },
+    };
+    int nb_refus = (int)(sizeof refuses / sizeof refuses[0]);
+    for (int i = 0; i < nb_refus && ok; i++) {
+        FormatImageDIF demande = { 0 };
+        ok = dif_decode_region_ctx(contexte, dif.donnees, dif.taille, refuses[i][0], refuses[i][1],
+                                   refuses[i][2], refuses[i][3], &demande, &region) == DIF_ERR_FORMAT;
+        if (!ok)
+            printf("  region (%d, %d) %dx%d acceptee\n", refuses[i][0], refuses[i][1],
+                   refuses[i][2], refuses[i][3]);
+    }
+    if (ok && nb_canaux == 3 && octets == 2) {
+        /* pas de plans séparés sur 16 bits */
+        FormatImageDIF demande = { 0, 0, 0, 0, 1, 0 };
+        ok = dif_decode_region_ctx(contexte, dif.donnees, dif.taille, 0, 0, 8, 8,
+                                   &demande, &region) == DIF_ERR_UNIMPLEMENTED;
+    }
+
+    /* conteneur effectivement écrit : 0xD1FF/0xD3FF classique, sinon étendu */
+    int classique = dif.taille > 1 && (dif.donnees[1] & 0xF0) == 0xD0;
+    printf("%-28s %-9s %4d regions, %2d refus  %s\n", nom, classique ? "classique" : "bandes",
+           nb_regions, nb_refus, ok ? "ok" : "DIFFERENT");
+    free(image);
+    free(dif.donnees);
+    free(complete.donnees);
+    free(region.donnees);
+    dif_context_detruire(contexte);
+    return ok;
+}
+
+/* Décodage d'une région de 256 x 256 en bas à droite d'une grande image
+ * contre le décodage complet */
+static int mesurer(const char *nom, int largeur, int hauteur, const OptionsDIF *options, int repetitions) {
+    unsigned char *image = generer_image(largeur, hauteur, 3, 255);
+    dif_context *contexte = dif_context_creer(options);
+    FormatImageDIF format = { largeur, hauteur, 3, 0, 0, 0 };
+    TamponDIF dif = {0}, complete = {0}, region = {0};
+    int ok = image && contexte && dif_encode_mem_ctx(contexte, image, &format, &dif) == DIF_OK;
+    double t0 = secondes();
+    for (int r = 0; r < repetitions && ok; r++) {
+        FormatImageDIF demande = { 0 };
+        ok = dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &demande, &complete) == DIF_OK;
+    }
+    double t1 = secondes();
+    FormatImageDIF demande = { 0 };
+    for (int r = 0; r < repetitions && ok; r++)
+        ok = dif_decode_region_ctx(contexte, dif.donnees, dif.taille, largeur - 256, hauteur - 256,
+                                   256, 256, &demande, &region) == DIF_OK;
+    double t2 = secondes();
+    ok = ok && comparer_region(complete.donnees, largeur, 3, 1, largeur - 256, hauteur - 256,
+                               &demande, region.donnees);
+    printf("%-28s %5dx%-5d complet : %7.2f ms  region 256x256 : %7.2f ms  x%.1f  %s\n", nom,
+           largeur, hauteur, (t1 - t0) * 1e3 / repetitions, (t2 - t1) * 1e3 / repetitions,
+           (t1 - t0) / (t2 - t1), ok ? "ok" : "DIFFERENT");
+    free(image);
+    free(dif.donnees);
+    free(complete.donnees);
+    free(region.donnees);
+    dif_context_detruire(contexte);
+    return ok;
+}
+
+int main(void) {
+    OptionsDIF classique, bandes, med, sans_perte;
+    options_dif_defaut(&classique);
+    bandes = classique;
+    bandes.hauteur_bande = HAUTEUR_BANDE;
+    med = bandes;
+    med.modes = DIF_MODE_MED | DIF_MODE_HUFFMAN;
+    sans_perte = bandes;
+    sans_perte.modes = DIF_MODE_SANS_PERTE | DIF_MODE_DECORRELATION | DIF_MODE_PLAGES;
+    int ok = 1;
+    ok &= verifier("gris", 1, 255, &classique);
+    ok &= verifier("couleur", 3, 255, &classique);
+    ok &= verifier("gris 16 bits, sans -b", 1, 4095, &classique);
+    ok &= verifier("couleur 16 bits, sans -b", 3, 65535, &classique);
+    ok &= verifier("gris", 1, 255, &bandes);
+    ok &= verifier("couleur", 3, 255, &bandes);
+    ok &= verifier("couleur MED Huffman", 3, 255, &med);
+    ok &= verifier("couleur sans perte", 3, 255, &sans_perte);
+    ok &= verifier("gris 16 bits", 1, 4095, &bandes);
+    ok &= verifier("couleur 16 bits MED", 3, 65535, &med);
+
+    OptionsDIF grandes = classique;
+    grandes.hauteur_bande = 64;
+    ok &= mesurer("couleur classique", 2048, 2048, &classique, 3);
+    ok &= mesurer("couleur bandes de 64", 2048, 2048, &grandes, 3);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/* Benchmark des séquences : taille d'une séquence DIF (images prédites par
+ * la précédente) contre les mêmes images encodées séparément, débit du
+ * décodage dans l'ordre et coût d'un accès direct ; chaque image décodée
+ * de la séquence est comparée à son décodage séparé */
+#include "codec_interne.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NB_IMAGES 48
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Image `rang` d'une prise de vue fixe : décor texturé immobile, objet qui
+ * se déplace, léger bruit de capteur sur une image sur deux */
+static void generer_image(unsigned char *pixels, int largeur, int hauteur, int nb_canaux, int rang) {
+    unsigned int graine = 12345u + (unsigned int)rang;
+    for (int y = 0; y < hauteur; y++)
+        for (int x = 0; x < largeur; x++) {
+            graine = graine * 1103515245u + 12345u;
+            int bruit = rang % 2 ? (int)((graine >> 16) % 3) - 1 : 0;
+            int objet = x - 8 * rang > largeur / 4 && x - 8 * rang < largeur / 2 &&
+                        y > hauteur / 3 && y < 2 * hauteur / 3;
+            for (int c = 0; c < nb_canaux; c++) {
+                int valeur = objet ? 200 - 40 * c + (x + y) % 16
+                                   : ((x * 3 + c * 17) ^ (y * 5)) % 96 + 64 + bruit;
+                *pixels++ = (unsigned char)(valeur < 0 ? 0 : valeur > 255 ? 255 : valeur);
+            }
+        }
+}
+
+static int mesurer(const char *nom, int largeur, int hauteur, int nb_canaux, unsigned int modes) {
+    size_t taille = (size_t)largeur * hauteur * nb_canaux;
+    unsigned char *pixels = malloc(taille * NB_IMAGES);
+    const unsigned char *images[NB_IMAGES];
+    if (!pixels) return 0;
+    for (int i = 0; i < NB_IMAGES; i++) {
+        generer_image(pixels + i * taille, largeur, hauteur, nb_canaux, i);
+        images[i] = pixels + i * taille;
+    }
+    OptionsDIF options;
+    options_dif_defaut(&options);
+    options.modes = modes;
+    dif_context *contexte = dif_context_creer(&options);
+    FormatImageDIF format = { largeur, hauteur, nb_canaux, 0, 0, 0 };
+    TamponDIF sequence = {0}, dif = {0}, sortie = {0}, separee = {0};
+
+    /* images séparées : taille cumulée et décodages de référence */
+    size_t taille_separees = 0;
+    int ok = 1;
+    unsigned char *attendues = malloc(taille * NB_IMAGES);
+    for (int i = 0; i < NB_IMAGES && ok && attendues; i++) {
+        ok = dif_encode_mem_ctx(contexte, images[i], &format, &dif) == DIF_OK &&
+             dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &format, &separee) == DIF_OK;
+        if (ok) memcpy(attendues + i * taille, separee.donnees, taille);
+        taille_separees += dif.taille;
+    }
+    ok = ok && attendues;
+
+    double t0 = secondes();
+    ok = ok && dif_encode_sequence_ctx(contexte, images, NB_IMAGES, &format, &sequence) == DIF_OK;
+    double t1 = secondes();
+    for (int i = 0; i < NB_IMAGES && ok; i++)
+        ok = dif_decode_sequence_ctx(contexte, sequence.donnees, sequence.taille, i, &format, &sortie)
+             == DIF_OK && memcmp(sortie.donnees, attendues + i * taille, taille) == 0;
+    double t2 = secondes();
+    /* accès direct : de la dernière image vers la première */
+    for (int i = NB_IMAGES - 1; i >= 0 && ok; i -= 7)
+        ok = dif_decode_sequence_ctx(contexte, sequence.donnees, sequence.taille, i, &format, &sortie)
+             == DIF_OK && memcmp(sortie.donnees, attendues + i * taille, taille) == 0;
+    double t3 = secondes();
+
+    double mo = (double)taille * NB_IMAGES / 1e6;
+    printf("%-8s modes %02x  sequence : %6.2f %%  separees : %6.2f %%   encodage : %7.1f Mo/s   "
+           "decodage : %7.1f Mo/s   acces direct : %6.1f ms  %s\n",
+           nom, modes, 100.0 * sequence.taille / (taille * NB_IMAGES),
+           100.0 * taille_separees / (taille * NB_IMAGES), mo / (t1 - t0), mo / (t2 - t1),
+           1e3 * (t3 - t2) / ((NB_IMAGES + 6) / 7), ok ? "ok" : "DIFFERENT");
+    free(sequence.donnees);
+    free(dif.donnees);
+    free(sortie.donnees);
+    free(separee.donnees);
+    free(attendues);
+    free(pixels);
+    dif_context_detruire(contexte);
+    return ok;
+}
+
+int main(void) {
+    int ok = 1;
+    ok &= mesurer("couleur", 1280, 720, 3, 0);
+    ok &= mesurer("couleur", 1280, 720, 3, DIF_MODE_MED | DIF_MODE_DECORRELATION | DIF_MODE_PLAGES);
+    ok &= mesurer("couleur", 1280, 720, 3, DIF_MODE_HUFFMAN | DIF_MODE_PLAGES);
+    ok &= mesurer("gris", 1920, 1080, 1, DIF_MODE_SANS_PERTE);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+/* Benchmark des vignettes : chaque vignette de facteur 2, 4 ou 8 décodée par
+ * dif_decode_vignette_ctx (sorties entrelacées, à pas élargi ou en plans
+ * séparés) et par diftopnm_vignette_ctx est comparée à la moyenne arrondie
+ * des blocs de l'image décodée en entier, blocs tronqués aux bords compris,
+ * sur 8 et 16 bits ; débit d'une vignette contre le décodage complet. */
+#include "codec_interne.h"
+#include "bench_commun.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static unsigned int echantillon(const unsigned char *pixels, size_t index, int seize_bits) {
+    return seize_bits ? ((const uint16_t *)pixels)[index] : pixels[index];
+}
+
+/* Vignette de référence : moyenne arrondie de chaque bloc de
+ * facteur x facteur pixels de l'image complète, tronqué aux bords */
+static unsigned char *vignette_reference(const unsigned char *complete, int largeur, int hauteur,
+                                         int nb_canaux, int seize_bits, int facteur)
+{
+    int largeur_vignette = (largeur + facteur - 1) / facteur;
+    int hauteur_vignette = (hauteur + facteur - 1) / facteur;
+    unsigned char *vignette = malloc((size_t)largeur_vignette * hauteur_vignette * nb_canaux *
+                                     (seize_bits ? 2 : 1));
+    if (!vignette) return NULL;
+    size_t i = 0;
+    for (int by = 0; by < hauteur_vignette; by++)
+        for (int bx = 0; bx < largeur_vignette; bx++)
+            for (int canal = 0; canal < nb_canaux; canal++, i++) {
+                uint32_t somme = 0, effectif = 0;
+                for (int y = by * facteur; y < (by + 1) * facteur && y < hauteur; y++)
+                    for (int x = bx * facteur; x < (bx + 1) * facteur && x < largeur; x++, effectif++)
+                        somme += echantillon(complete, ((size_t)y * largeur + x) * nb_canaux + canal,
+                                             seize_bits);
+                uint32_t moyenne = (somme + effectif / 2) / effectif;
+                if (seize_bits)
+                    ((uint16_t *)vignette)[i] = (uint16_t)moyenne;
+                else
+                    vignette[i] = (unsigned char)moyenne;
+            }
+    return vignette;
+}
+
+/* Vignette décodée au format `format` (entrelacé ou en plans, pas
+ * quelconque) identique à la référence, lignes contiguës */
+static int comparer_vignette(const unsigned char *reference, int nb_canaux, int seize_bits,
+                             const FormatImageDIF *format, const unsigned char *vignette)
+{
+    size_t octets = seize_bits ? 2 : 1;
+    size_t pas_reference = (size_t)format->largeur * nb_canaux * octets;
+    int plans = format->plans && nb_canaux == 3;
+    for (int ligne = 0; ligne < format->hauteur; ligne++) {
+        const unsigned char *source = reference + (size_t)ligne * pas_reference;
+        if (!plans) {
+            if (memcmp(vignette + (size_t)ligne * format->pas, source, pas_reference)) return 0;
+            continue;
+        }
+        for (int canal = 0; canal < 3; canal++) {
+            const unsigned char *plan = vignette + (size_t)canal * format->hauteur * format->pas +
+                                        (size_t)ligne * format->pas;
+            for (int colonne = 0; colonne < format->largeur; colonne++)
+                if (plan[colonne] != source[3 * colonne + canal]) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Vignette écrite en PNM par diftopnm_vignette_ctx, relue par lire_pnm */
+static int verifier_fichier(dif_context *contexte, const TamponDIF *dif, int facteur,
+                            const unsigned char *reference, int largeur, int hauteur, int nb_canaux,
+                            int seize_bits)
+{
+    char chemin_dif[] = "/tmp/bench_vignettes_XXXXXX";
+    int fd = mkstemp(chemin_dif);
+    if (fd < 0) return 0;
+    int ok = write(fd, dif->donnees, dif->taille) == (ssize_t)dif->taille;
+    close(fd);
+    char chemin_pnm[64];
+    snprintf(chemin_pnm, sizeof chemin_pnm, "%s.pnm", chemin_dif);
+    ImagePNM image = {0};
+    ok = ok && diftopnm_vignette_ctx(contexte, chemin_dif, chemin_pnm, facteur) == DIF_OK &&
+         lire_pnm(chemin_pnm, &image) == DIF_OK;
+    FormatImageDIF format = { image.largeur, image.hauteur, image.type,
+                              (size_t)image.largeur * image.type * (seize_bits ? 2 : 1), 0, 0 };
+    ok = ok && image.largeur == (largeur + facteur - 1) / facteur &&
+         image.hauteur == (hauteur + facteur - 1) / facteur && image.type == nb_canaux &&
+         (image.valeur_max > 255) == seize_bits &&
+         comparer_vignette(reference, nb_canaux, seize_bits, &format, image.donnees);
+    free(image.donnees);
+    remove(chemin_dif);
+    remove(chemin_pnm);
+    return ok;
+}
+
+/* Une image encodée avec `options` : facteurs 2, 4 et 8 dans chaque
+ * disposition de sortie et par fichier, puis facteurs refusés */
+static int verifier(const char *nom, int largeur, int hauteur, int nb_canaux, int valeur_max,
+                    const OptionsDIF *options)
+{
+    unsigned char *image = generer_image(largeur, hauteur, nb_canaux, valeur_max);
+    dif_context *contexte = dif_context_creer(options);
+    FormatImageDIF format = { largeur, hauteur, nb_canaux, 0, 0, valeur_max };
+    TamponDIF dif = {0}, complete = {0}, vignette = {0};
+    int ok = image && contexte && dif_encode_mem_ctx(contexte, image, &format, &dif) == DIF_OK;
+    FormatImageDIF format_complet = { 0 };
+    ok = ok && dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &format_complet, &complete) == DIF_OK;
+    int seize_bits = valeur_max > 255;
+    size_t octets = seize_bits ? 2 : 1;
+
+    /* dispositions de sortie : lignes contiguës, pas élargi, plans séparés
+     * (couleur 8 bits), plans à pas élargi */
+    struct { size_t marge; int plans; } sorties[] = { { 0, 0 }, { 6, 0 }, { 0, 1 }, { 10, 1 } };
+    int nb_sorties = nb_canaux == 3 && !seize_bits ? 4 : 2;
+    for (int facteur = 2; facteur <= 8 && ok; facteur *= 2) {
+        unsigned char *reference = vignette_reference(complete.donnees, largeur, hauteur, nb_canaux,
+                                                      seize_bits, facteur);
+        ok = reference != NULL;
+        int largeur_vignette = (largeur + facteur - 1) / facteur;
+        for (int s = 0; s < nb_sorties && ok; s++) {
+            size_t octets_ligne = (size_t)largeur_vignette * (sorties[s].plans ? 1 : nb_canaux) * octets;
+            FormatImageDIF demande = { 0, 0, 0, sorties[s].marge ? octets_ligne + sorties[s].marge : 0,
+                                       sorties[s].plans, 0 };
+            ok = dif_decode_vignette_ctx(contexte, dif.donnees, dif.taille, facteur, &demande,
+                                         &vignette) == DIF_OK &&
+                 demande.largeur == largeur_vignette &&
+                 demande.hauteur == (hauteur + facteur - 1) / facteur &&
+                 comparer_vignette(reference, nb_canaux, seize_bits, &demande, vignette.donnees);
+            if (!ok)
+                printf("  facteur %d, pas %zu%s : DIFFERENT\n", facteur, demande.pas,
+                       sorties[s].plans ? ", plans" : "");
+        }
+        if (ok && !verifier_fichier(contexte, &dif, facteur, reference, largeur, hauteur,
+                                    nb_canaux, seize_bits)) {
+            printf("  facteur %d, fichier PNM : DIFFERENT\n", facteur);
+            ok = 0;
+        }
+        free(reference);
+    }
+
+    static const int refuses[] = { -2, 0, 1, 3, 6, 16 };
+    for (size_t i = 0; i < sizeof refuses / sizeof refuses[0] && ok; i++) {
+        FormatImageDIF demande = { 0 };
+        ok = dif_decode_vignette_ctx(contexte, dif.donnees, dif.taille, refuses[i], &demande,
+                                     &vignette) == DIF_ERR_FORMAT;
+        if (!ok) printf("  facteur %d accepte\n", refuses[i]);
+    }
+
+    printf("%-28s %4dx%-4d facteurs 2, 4, 8  %s\n", nom, largeur, hauteur, ok ? "ok" : "DIFFERENT");
+    free(image);
+    free(dif.donnees);
+    free(complete.donnees);
+    free(vignette.donnees);
+    dif_context_detruire(contexte);
+    return ok;
+}
+
+/* Vignette de facteur 8 d'une grande image contre le décodage complet */
+static int mesurer(const char *nom, int largeur, int hauteur, int repetitions) {
+    unsigned char *image = generer_image(largeur, hauteur, 3, 255);
+    dif_context *contexte = dif_context_creer(NULL);
+    FormatImageDIF format = { largeur, hauteur, 3, 0, 0, 0 };
+    TamponDIF dif = {0}, complete = {0}, vignette = {0};
+    int ok = image && contexte && dif_encode_mem_ctx(contexte, image, &format, &dif) == DIF_OK;
+    double t0 = secondes();
+    for (int r = 0; r < repetitions && ok; r++) {
+        FormatImageDIF demande = { 0 };
+        ok = dif_decode_mem_ctx(contexte, dif.donnees, dif.taille, &demande, &complete) == DIF_OK;
+    }
+    double t1 = secondes();
+    FormatImageDIF demande = { 0 };
+    for (int r = 0; r < repetitions && ok; r++)
+        ok = dif_decode_vignette_ctx(contexte, dif.donnees, dif.taille, 8, &demande, &vignette) == DIF_OK;
+    double t2 = secondes();
+    unsigned char *reference = ok ? vignette_reference(complete.donnees, largeur, hauteur, 3, 0, 8) : NULL;
+    ok = reference && comparer_vignette(reference, 3, 0, &demande, vignette.donnees);
+    printf("%-28s %5dx%-5d complet : %7.2f ms  vignette 1/8 : %7.2f ms  %s\n", nom, largeur, hauteur,
+           (t1 - t0) * 1e3 / repetitions, (t2 - t1) * 1e3 / repetitions, ok ? "ok" : "DIFFERENT");
+    free(reference);
+    free(image);
+    free(dif.donnees);
+    free(complete.donnees);
+    free(vignette.donnees);
+    dif_context_detruire(contexte);
+    return ok;
+}
+
+int main(void) {
+    OptionsDIF classique, bandes, med;
+    options_dif_defaut(&classique);
+    bandes = classique;
+    bandes.hauteur_bande = 12;   /* pas un multiple des facteurs : blocs à cheval sur deux bandes */
+    med = bandes;
+    med.modes = DIF_MODE_MED | DIF_MODE_HUFFMAN;
+    int ok = 1;
+    ok &= verifier("gris", 301, 203, 1, 255, &classique);
+    ok &= verifier("couleur", 301, 203, 3, 255, &classique);
+    ok &= verifier("couleur, bandes de 12", 301, 203, 3, 255, &bandes);
+    ok &= verifier("couleur MED Huffman", 301, 203, 3, 255, &med);
+    ok &= verifier("gris 16 bits", 301, 203, 1, 4095, &bandes);
+    ok &= verifier("couleur 16 bits", 301, 203, 3, 65535, &classique);
+    /* images plus petites qu'un bloc, bords seuls */
+    ok &= verifier("couleur, bloc partiel", 5, 3, 3, 255, &classique);
+    ok &= verifier("gris 16 bits, un pixel", 1, 1, 1, 1000, &classique);
+    ok &= verifier("couleur, une ligne", 257, 1, 3, 255, &bandes);
+    ok &= mesurer("couleur", 2048, 2048, 3);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/* Benchmark du décodeur VLC : ancien décodage bit à bit contre la table */
+#include "codec_interne.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Flux de l'ancien décodeur (un bit à la fois) */
+typedef struct {
+    const unsigned char *buffer;
+    size_t taille;
+    size_t position;
+    unsigned char accumulateur;
+    int bits_accumules;
+} FluxBits;
+
+static int lire_un_bit(FluxBits *flux, int *bit){
+    if (flux->bits_accumules == 0) {
+        if (flux->position >= flux->taille) return 0;
+        flux->accumulateur = flux->buffer[flux->position++];
+        flux->bits_accumules = 8;
+    }
+    *bit = (flux->accumulateur >> 7) & 1;
+    flux->accumulateur <<= 1;
+    flux->bits_accumules--;
+    return 1;
+}
+
+static int lire_n_bits(FluxBits *flux, int nombre, unsigned int *valeur){
+    *valeur = 0;
+    for (int i = 0, bit; i < nombre; i++) {
+        if (!lire_un_bit(flux, &bit)) return 0;
+        *valeur = (*valeur << 1) | bit;
+    }
+    return 1;
+}
+
+/* Chemin de référence : reprise de la boucle historique de diftopnm */
+static int decoder_bit_a_bit(const unsigned char *donnees, size_t taille,
+                             const uint8_t bits_niveaux[4], int8_t *deltas, size_t n)
+{
+    unsigned int decalages[4] = {0};
+    for (int niveau = 1; niveau < 4; niveau++)
+        decalages[niveau] = decalages[niveau-1] + (1U << bits_niveaux[niveau-1]);
+    FluxBits flux = { donnees, taille, 0, 0, 0 };
+    for (size_t i = 0; i < n; i++) {
+        int bit, niveau;
+        unsigned int val = 0;
+        if (!lire_un_bit(&flux, &bit)) return 0;
+        if (!bit) niveau = 0;
+        else {
+            if (!lire_un_bit(&flux, &bit)) return 0;
+            if (!bit) niveau = 1;
+            else {
+                if (!lire_un_bit(&flux, &bit)) return 0;
+                niveau = bit ? 3 : 2;
+            }
+        }
+        if (bits_niveaux[niveau] > 0 && !lire_n_bits(&flux, bits_niveaux[niveau], &val))
+            return 0;
+        deltas[i] = (int8_t)deplier_delta((unsigned char)(decalages[niveau] + val));
+    }
+    return 1;
+}
+
+/* Nouveau chemin : réservoir 64 bits + table de 2^11 entrées */
+static int decoder_table(const unsigned char *donnees, size_t taille,
+                         const TableVLC *table, int8_t *deltas, size_t n)
+{
+    LecteurBits lecteur;
+    initialiser_lecteur(&lecteur, donnees, taille);
+    for (size_t i = 0; i < n; i++)
+        deltas[i] = lire_symbole(&lecteur, table)->delta;
+    return !lecteur_depasse(&lecteur);
+}
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Image de test : dégradés et bruit, proche d'une photo numérisée */
+static int generer_image(const char *chemin, int largeur, int hauteur, int nb_canaux) {
+    FILE *f = fopen(chemin, "wb");
+    if (!f) return 0;
+    fprintf(f, "P%d\n%d %d\n255\n", nb_canaux == 1 ? 5 : 6, largeur, hauteur);
+    unsigned int graine = 12345;
+    for (int y = 0; y < hauteur; y++)
+        for (int x = 0; x < largeur; x++)
+            for (int c = 0; c < nb_canaux; c++) {
+                graine = graine * 1103515245u + 12345u;
+                int bruit = (int)((graine >> 16) % 9) - 4;
+                int v = ((x * (c + 1) + y) / 8 + bruit) & 255;
+                fputc(v, f);
+            }
+    fclose(f);
+    return 1;
+}
+
+static int mesurer(const char *nom, int largeur, int hauteur, int nb_canaux, int repetitions) {
+    char chemin_pnm[] = "/tmp/bench_vlc_XXXXXX";
+    int fd = mkstemp(chemin_pnm);
+    if (fd < 0) return 0;
+    close(fd);   /* l'image est écrite par son chemin */
+    char chemin_dif[64];
+    snprintf(chemin_dif, sizeof chemin_dif, "%s.dif", chemin_pnm);
+    if (!generer_image(chemin_pnm, largeur, hauteur, nb_canaux) ||
+        pnmtodif(chemin_pnm, chemin_dif) != DIF_OK) {
+        remove(chemin_pnm);
+        return 0;
+    }
+    remove(chemin_pnm);
+    FILE *f = fopen(chemin_dif, "rb");
+    if (!f) {
+        remove(chemin_dif);
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t taille_fichier = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *fichier = malloc(taille_fichier);
+    size_t lus = fichier ? fread(fichier, 1, taille_fichier, f) : 0;
+    fclose(f);
+    remove(chemin_dif);
+    if (lus != taille_fichier) {
+        free(fichier);
+        return 0;
+    }
+
+    size_t entete = 7 + 4 + (size_t)nb_canaux;
+    const uint8_t *bits_niveaux = fichier + 7;
+    size_t n = (size_t)largeur * hauteur * nb_canaux - nb_canaux;
+    int8_t *ref = malloc(n), *lut = malloc(n);
+    TableVLC table;
+    construire_table_vlc(&table, bits_niveaux, 0);
+
+    double t0 = secondes();
+    for (int r = 0; r < repetitions; r++)
+        decoder_bit_a_bit(fichier + entete, taille_fichier - entete, bits_niveaux, ref, n);
+    double t1 = secondes();
+    for (int r = 0; r < repetitions; r++)
+        decoder_table(fichier + entete, taille_fichier - entete, &table, lut, n);
+    double t2 = secondes();
+
+    int identique = memcmp(ref, lut, n) == 0;
+    double mo = (double)n * repetitions / 1e6;
+    printf("%-10s %5dx%-5d  bit a bit : %8.1f Mo/s   table : %8.1f Mo/s   x%.1f  %s\n",
+           nom, largeur, hauteur, mo / (t1 - t0), mo / (t2 - t1),
+           (t1 - t0) / (t2 - t1), identique ? "ok" : "DIFFERENT");
+    free(ref);
+    free(lut);
+    free(fichier);
+    return identique;
+}
+
+int main(void) {
+    int ok = 1;
+    ok &= mesurer("gris", 4096, 4096, 1, 3);
+    ok &= mesurer("couleur", 2048, 2048, 3, 3);
+    return ok ? 0 : 1;
+}
@@ -1,198 +1,739 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <time.h>
-#include "Codec/include/codec.h"
-
-/* ============================================================
- * Affiche l'aide
- * ============================================================ */
-static void afficher_aide(const char *prog){
-    printf("Usage: %s [options] entree sortie\n", prog);
-    printf("Options:\n");
-    printf("  -h   afficher cette aide\n");
-    printf("  -v   mode verbeux\n");
-    printf("  -t   afficher le temps d'execution\n");
-    printf("  -d   forcer le decodage DIF -> PNM\n");
-    printf("  -e   forcer l'encodage IMAGE -> DIF\n");
-    printf("  -r   generer aussi l'image differentielle (raw)\n");
-    printf("\n");
-}
-
-/* ============================================================
- * Retourne la taille d'un fichier
- * ============================================================ */
-static long taille_fichier(const char *chemin){
-    struct stat st;
-    if (stat(chemin, &st) != 0)
-        return -1;
-    return st.st_size;
-}
-
-/* ============================================================
- * Teste une extension
- * ============================================================ */
-static int a_extension(const char *nom, const char *ext){
-    size_t ln = strlen(nom);
-    size_t le = strlen(ext);
-    if (ln < le)
-        return 0;
-    return strcmp(nom + ln - le, ext) == 0;
-}
-
-/* ============================================================
- * Teste si le fichier est un PNM
- * ============================================================ */
-static int est_pnm(const char *nom){
-    return a_extension(nom, ".pgm") ||
-           a_extension(nom, ".ppm") ||
-           a_extension(nom, ".pnm");
-}
-
-int main(int argc, char *argv[]){
-    // options
-    int opt_verbose = 0;
-    int opt_temps = 0;
-    int opt_raw = 0;
-    int opt_force_decode = 0;
-    int opt_force_encode = 0;
-    // fichiers 
-    const char *fichier_entree = NULL;
-    const char *fichier_sortie = NULL;
-
-    /* ========================================================
-     * Lecture des arguments
-     * ======================================================== */
-    for (int i = 1; i < argc; i++) {
-        if (!strcmp(argv[i], "-h")) {
-            afficher_aide(argv[0]);
-            return 0;
-        }
-        else if (!strcmp(argv[i], "-v")) {
-            opt_verbose = 1;
-        }
-        else if (!strcmp(argv[i], "-t")) {
-            opt_temps = 1;
-        }
-        else if (!strcmp(argv[i], "-d")) {
-            opt_force_decode = 1;
-        }
-        else if (!strcmp(argv[i], "-e")) {
-            opt_force_encode = 1;
-        }
-        else if (!strcmp(argv[i], "-r")) {
-            opt_raw = 1;
-        }
-        else if (argv[i][0] == '-') {
-            fprintf(stderr, "Option inconnue : %s\n", argv[i]);
-            afficher_aide(argv[0]);
-            return 1;
-        }
-        else {
-            if (!fichier_entree)
-                fichier_entree = argv[i];
-            else if (!fichier_sortie)
-                fichier_sortie = argv[i];
-            else {
-                fprintf(stderr, "Trop d'arguments\n");
-                return 1;
-            }
-        }
-    }
-
-    /* ========================================================
-     * Verifications
-     * ======================================================== */
-    if (!fichier_entree || !fichier_sortie) {
-        fprintf(stderr, "Fichier d'entree ou de sortie manquant\n");
-        afficher_aide(argv[0]);
-        return 1;
-    }
-
-    if (opt_force_decode && opt_force_encode) {
-        fprintf(stderr, "Options -d et -e incompatibles\n");
-        return 1;
-    }
-
-    /* ========================================================
-     * MODE DECODAGE DIF -> PNM
-     * ======================================================== */
-    if (opt_force_decode || (!opt_force_encode && a_extension(fichier_entree, ".dif"))) {
-        if (opt_verbose)
-            printf("Decodage : %s -> %s\n", fichier_entree, fichier_sortie);
-        clock_t debut = clock();
-        int err = diftopnm(fichier_entree, fichier_sortie);
-        clock_t fin = clock();
-        if (err != DIF_OK) {
-            fprintf(stderr, "Erreur lors du decodage DIF (%d)\n", err);
-            return 1;
-        }
-        // image differentielle
-        if (opt_raw) {
-            char nom_raw[512];
-            snprintf(nom_raw, sizeof nom_raw, "%s_raw.pnm", fichier_sortie);
-            if (opt_verbose)
-                printf("Image differentielle : %s\n", nom_raw);
-            if (diftopnm_raw(fichier_entree, nom_raw) != DIF_OK) {
-                fprintf(stderr, "Erreur generation image differentielle\n");
-                return 1;
-            }
-        }
-        if (opt_temps) {
-            double t = (double)(fin - debut) / CLOCKS_PER_SEC;
-            printf("Temps de decodage : %.3f s\n", t);
-        }
-        if (opt_verbose)
-            printf("Decodage termine\n");
-    }
-
-    /* ========================================================
-     * MODE ENCODAGE IMAGE -> DIF
-     * ======================================================== */
-    else {
-        char fichier_pnm[256];
-        const char *entree_pnm = fichier_entree;
-        int pnm_temp = 0;
-        // conversion si besoin 
-        if (!est_pnm(fichier_entree)) {
-            snprintf(fichier_pnm, sizeof fichier_pnm, "tmp_convert.pnm");
-            char cmd[512];
-            snprintf(cmd, sizeof cmd,
-                     "convert \"%s\" \"%s\" 2>/dev/null",
-                     fichier_entree, fichier_pnm);
-            if (system(cmd) != 0) {
-                fprintf(stderr, "Conversion impossible\n");
-                return 1;
-            }
-            entree_pnm = fichier_pnm;
-            pnm_temp = 1;
-        }
-        long taille_in = taille_fichier(entree_pnm);
-        if (opt_verbose)
-            printf("Encodage : %s -> %s\n", entree_pnm, fichier_sortie);
-        clock_t debut = clock();
-        int err = pnmtodif(entree_pnm, fichier_sortie);
-        clock_t fin = clock();
-        if (err != DIF_OK) {
-            fprintf(stderr, "Erreur encodage PNM (%d)\n", err);
-            if (pnm_temp) remove(entree_pnm);
-            return 1;
-        }
-        long taille_out = taille_fichier(fichier_sortie);
-        if (opt_temps) {
-            double t = (double)(fin - debut) / CLOCKS_PER_SEC;
-            printf("Temps d'encodage : %.3f s\n", t);
-        }
-        if (taille_in > 0 && taille_out > 0) {
-            double ratio = 100.0 * taille_out / taille_in;
-            printf("Taille brute : %ld octets\n", taille_in);
-            printf("Taille DIF   : %ld octets\n", taille_out);
-            printf("Compression  : %.2f %%\n", ratio);
-        }
-        if (pnm_temp)
-            remove(entree_pnm);
-    }
-    return 0;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include <glob.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include "CoDec/include/codec.h"
+
+extern char **environ;
+
+/* ============================================================
+ * Affiche l'aide
+ * ============================================================ */
+static void afficher_aide(const char *prog){
+    printf("Usage: %s [options] entree sortie\n", prog);
+    printf("  entree ou sortie - : entree ou sortie standard (sens du codage\n");
+    printf("  deduit du premier octet de l'entree sans -d ni -e)\n");
+    printf("Options:\n");
+    printf("  -h   afficher cette aide\n");
+    printf("  -v   mode verbeux\n");
+    printf("  -t   afficher le temps d'execution\n");
+    printf("  -d   forcer le decodage DIF -> PNM\n");
+    printf("  -e   forcer l'encodage IMAGE -> DIF\n");
+    printf("  -r   generer aussi l'image differentielle (raw)\n");
+    printf("  -b N encoder en bandes independantes de N lignes (DIF etendu)\n");
+    printf("  -q   quantificateur fixe {1,2,4,8}, {2,4,8,16} sur 16 bits\n");
+    printf("       (defaut : adapte a l'image)\n");
+    printf("  -p   predicteur 2D MED (DIF etendu, bandes de 128 lignes sans -b)\n");
+    printf("  -c   couleur : code G, R-G et B-G (DIF etendu, sans effet en gris)\n");
+    printf("  -z   plages de deltas nuls codees par leur longueur (DIF etendu)\n");
+    printf("  -H   codes de Huffman adaptes a l'image (DIF etendu, sans effet avec -q)\n");
+    printf("  -s   sans perte : echantillons entiers, sans reduction d'amplitude\n");
+    printf("       (DIF etendu, sans effet de -z)\n");
+    printf("  -m N decoder une vignette reduite d'un facteur N (2, 4 ou 8)\n");
+    printf("  -j N nombre de threads pour les bandes, ou d'ouvriers en mode lot\n");
+    printf("       (defaut : nombre de coeurs)\n");
+    printf("  -l   mode lot : entree = dossier, motif (\"img/*.ppm\") ou - (liste\n");
+    printf("       de fichiers sur l'entree standard), sortie = dossier\n");
+    printf("  -S   sequence : a l'encodage, entree = dossier, motif ou - comme -l\n");
+    printf("       (images de memes dimensions, par ordre alphabetique), sortie =\n");
+    printf("       sequence DIF ; au decodage, sortie = motif avec un %%d remplace\n");
+    printf("       par le numero de l'image (\"img_%%04d.ppm\")\n");
+    printf("  -i N decoder seulement l'image N de la sequence (implique -S)\n");
+    printf("  -k N sequence : une image intra au moins toutes les N images\n");
+    printf("       (defaut : 32)\n");
+    printf("\n");
+}
+
+/* ============================================================
+ * Retourne la taille d'un fichier
+ * ============================================================ */
+static long taille_fichier(const char *chemin){
+    struct stat st;
+    if (!strcmp(chemin, "-") || stat(chemin, &st) != 0)
+        return -1;
+    return st.st_size;
+}
+
+/* ============================================================
+ * Horloge murale en secondes (le temps CPU additionne les threads)
+ * ============================================================ */
+static double maintenant(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ============================================================
+ * Teste une extension
+ * ============================================================ */
+static int a_extension(const char *nom, const char *ext){
+    size_t ln = strlen(nom);
+    size_t le = strlen(ext);
+    if (ln < le)
+        return 0;
+    return strcmp(nom + ln - le, ext) == 0;
+}
+
+/* ============================================================
+ * Teste si le fichier est un PNM
+ * ============================================================ */
+static int est_pnm(const char *nom){
+    return a_extension(nom, ".pgm") ||
+           a_extension(nom, ".ppm") ||
+           a_extension(nom, ".pnm");
+}
+
+/* ============================================================
+ * Conversion d'une image quelconque en PNM (ImageMagick)
+ * ============================================================ */
+/* convert est lance sans shell (chemins passes tels quels, sans quoting ni
+ * limite de longueur), ses erreurs vers /dev/null */
+static int convertir_en_pnm(const char *entree, const char *sortie){
+    char *const arguments[] = { "convert", (char *)entree, (char *)sortie, NULL };
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0)
+        return 0;
+    pid_t processus;
+    int lance = posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) == 0 &&
+                posix_spawnp(&processus, "convert", &actions, NULL, arguments, environ) == 0;
+    posix_spawn_file_actions_destroy(&actions);
+    if (!lance)
+        return 0;
+    int statut;
+    while (waitpid(processus, &statut, 0) < 0)
+        if (errno != EINTR)
+            return 0;
+    return WIFEXITED(statut) && WEXITSTATUS(statut) == 0;
+}
+
+/* Premier octet de l'entree standard, laisse en place (0xFF : DIF, 'P' : PNM) */
+static int premier_octet_entree(void){
+    int octet = getc(stdin);
+    if (octet != EOF)
+        ungetc(octet, stdin);
+    return octet;
+}
+
+/* Entree standard commencant par un PNM binaire (P5/P6), encode en flux ;
+ * les deux octets lus sont remis en place (la glibc accepte plusieurs octets
+ * remis par ungetc). -1 si un octet n'a pas pu etre remis */
+static int pnm_binaire_entree(void){
+    int premier = getc(stdin);
+    if (premier == EOF)
+        return 0;
+    int second = getc(stdin);
+    int binaire = premier == 'P' && (second == '5' || second == '6');
+    if ((second != EOF && ungetc(second, stdin) == EOF) || ungetc(premier, stdin) == EOF)
+        return -1;
+    return binaire;
+}
+
+/* Encodage en memoire d'une image lue par la bibliotheque, puis ecriture du DIF */
+static int encoder_image(dif_context *contexte, const ImagePNM *image, const char *sortie){
+    FormatImageDIF format = { image->largeur, image->hauteur, image->type, 0, 0, image->valeur_max };
+    TamponDIF dif = {0};
+    int err = dif_encode_mem_ctx(contexte, image->donnees, &format, &dif);
+    if (err == DIF_OK) {
+        int standard = !strcmp(sortie, "-");
+        FILE *fichier = standard ? stdout : fopen(sortie, "wb");
+        if (!fichier || fwrite(dif.donnees, 1, dif.taille, fichier) != dif.taille)
+            err = DIF_ERR_IO;
+        if (fichier && (standard ? fflush(fichier) : fclose(fichier)) != 0)
+            err = DIF_ERR_IO;
+        if (err != DIF_OK && !standard)
+            remove(sortie);
+    }
+    free(dif.donnees);
+    return err;
+}
+
+/* ============================================================
+ * Encodage d'une image quelconque vers DIF : PNM binaire encode en flux,
+ * PNM ASCII, PAM, BMP et TGA lus en memoire par la bibliotheque, autres
+ * formats convertis par ImageMagick dans un fichier temporaire propre au
+ * processus (et au fichier `index` du lot). Sur l'entree standard (-), seul
+ * un PNM binaire est encode en flux et il n'y a pas de conversion externe.
+ * taille_brute : taille du PNM equivalent
+ * ============================================================ */
+static int encoder_fichier(dif_context *contexte, const char *entree, const char *sortie,
+                           size_t index, long *taille_brute){
+    int standard = !strcmp(entree, "-");
+    int flux = standard ? pnm_binaire_entree() : est_pnm(entree);
+    if (flux < 0)
+        return DIF_ERR_IO;
+    if (flux) {
+        int err = pnmtodif_ctx(contexte, entree, sortie);
+        *taille_brute = taille_fichier(entree);
+        if (err != DIF_ERR_FORMAT || standard)
+            return err;
+    }
+    ImagePNM image;
+    int err = lire_image(entree, &image);
+    if (err == DIF_OK) {
+        err = encoder_image(contexte, &image, sortie);
+        *taille_brute = (long)image.largeur * image.hauteur * image.type * (image.valeur_max > 255 ? 2 : 1);
+        liberer_pnm(&image);
+        return err;
+    }
+    if (err != DIF_ERR_UNIMPLEMENTED || standard)
+        return err;
+    char temporaire[64];
+    snprintf(temporaire, sizeof temporaire, "tmp_convert_%ld_%zu.pnm", (long)getpid(), index);
+    if (!convertir_en_pnm(entree, temporaire)) {
+        remove(temporaire);
+        return DIF_ERR_IO;
+    }
+    err = pnmtodif_ctx(contexte, temporaire, sortie);
+    *taille_brute = taille_fichier(temporaire);
+    remove(temporaire);
+    return err;
+}
+
+/* ============================================================
+ * Mode lot : liste des fichiers a traiter
+ * ============================================================ */
+typedef struct {
+    char **chemins;
+    size_t nombre;
+    size_t capacite;
+} ListeFichiers;
+
+static int ajouter_fichier(ListeFichiers *liste, const char *chemin){
+    if (liste->nombre == liste->capacite) {
+        size_t capacite = liste->capacite ? 2 * liste->capacite : 64;
+        char **chemins = realloc(liste->chemins, capacite * sizeof *chemins);
+        if (!chemins)
+            return 0;
+        liste->chemins = chemins;
+        liste->capacite = capacite;
+    }
+    if (!(liste->chemins[liste->nombre] = strdup(chemin)))
+        return 0;
+    liste->nombre++;
+    return 1;
+}
+
+static void liberer_liste(ListeFichiers *liste){
+    for (size_t i = 0; i < liste->nombre; i++)
+        free(liste->chemins[i]);
+    free(liste->chemins);
+}
+
+static int comparer_chemins(const void *a, const void *b){
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* Fichiers reguliers d'un dossier, par ordre alphabetique */
+static int lister_dossier(ListeFichiers *liste, const char *dossier){
+    DIR *d = opendir(dossier);
+    if (!d)
+        return 0;
+    struct dirent *entree;
+    char chemin[4096];
+    int ok = 1;
+    while (ok && (entree = readdir(d))) {
+        struct stat st;
+        snprintf(chemin, sizeof chemin, "%s/%s", dossier, entree->d_name);
+        if (stat(chemin, &st) == 0 && S_ISREG(st.st_mode))
+            ok = ajouter_fichier(liste, chemin);
+    }
+    closedir(d);
+    qsort(liste->chemins, liste->nombre, sizeof *liste->chemins, comparer_chemins);
+    return ok;
+}
+
+/* Fichiers correspondant a un motif (glob) */
+static int lister_motif(ListeFichiers *liste, const char *motif){
+    glob_t resultat;
+    if (glob(motif, 0, NULL, &resultat) != 0)
+        return 0;
+    int ok = 1;
+    for (size_t i = 0; ok && i < resultat.gl_pathc; i++)
+        ok = ajouter_fichier(liste, resultat.gl_pathv[i]);
+    globfree(&resultat);
+    return ok;
+}
+
+/* Un chemin par ligne sur l'entree standard */
+static int lister_entree_standard(ListeFichiers *liste){
+    char ligne[4096];
+    while (fgets(ligne, sizeof ligne, stdin)) {
+        ligne[strcspn(ligne, "\r\n")] = '\0';
+        if (ligne[0] && !ajouter_fichier(liste, ligne))
+            return 0;
+    }
+    return 1;
+}
+
+/* Fichiers d'un dossier, d'un motif ou de la liste lue sur l'entree
+ * standard (-) */
+static int lister_fichiers(ListeFichiers *liste, const char *entree){
+    struct stat st;
+    if (!strcmp(entree, "-"))
+        return lister_entree_standard(liste);
+    if (stat(entree, &st) == 0 && S_ISDIR(st.st_mode))
+        return lister_dossier(liste, entree);
+    return lister_motif(liste, entree);
+}
+
+/* ============================================================
+ * Mode lot : file de travail partagee entre les ouvriers
+ * ============================================================ */
+typedef struct {
+    const ListeFichiers *liste;
+    const char *dossier_sortie;
+    int force_decode;
+    int force_encode;
+    int verbeux;
+    int facteur;                /* vignettes au decodage (1 : taille reelle) */
+    OptionsDIF options;         /* options d'encodage de chaque fichier */
+    pthread_mutex_t verrou;
+    size_t prochain;
+    int *erreurs;               /* code d'erreur par fichier */
+    long long octets_bruts;     /* PNM lus ou ecrits */
+    long long octets_dif;       /* DIF ecrits ou lus */
+} Lot;
+
+/* Nom de sortie : dossier de sortie + nom sans extension + nouvelle extension */
+static void nom_sortie(char *sortie, size_t taille, const char *dossier,
+                       const char *entree, const char *extension){
+    const char *nom = strrchr(entree, '/');
+    nom = nom ? nom + 1 : entree;
+    const char *point = strrchr(nom, '.');
+    int longueur = point && point != nom ? (int)(point - nom) : (int)strlen(nom);
+    snprintf(sortie, taille, "%s/%.*s%s", dossier, longueur, nom, extension);
+}
+
+/* Traitement d'un fichier du lot avec le contexte de l'ouvrier */
+static int traiter_fichier(Lot *lot, dif_context *contexte, size_t index,
+                           long *taille_brute, long *taille_dif){
+    const char *entree = lot->liste->chemins[index];
+    char sortie[4096];
+    int decode = lot->force_decode || (!lot->force_encode && a_extension(entree, ".dif"));
+    nom_sortie(sortie, sizeof sortie, lot->dossier_sortie, entree, decode ? ".pnm" : ".dif");
+    if (lot->verbeux)
+        printf("%s : %s -> %s\n", decode ? "Decodage" : "Encodage", entree, sortie);
+    if (decode) {
+        int err = lot->facteur > 1 ? diftopnm_vignette_ctx(contexte, entree, sortie, lot->facteur)
+                                   : diftopnm_ctx(contexte, entree, sortie);
+        *taille_dif = taille_fichier(entree);
+        *taille_brute = taille_fichier(sortie);
+        return err;
+    }
+    int err = encoder_fichier(contexte, entree, sortie, index, taille_brute);
+    *taille_dif = taille_fichier(sortie);
+    return err;
+}
+
+/* Un ouvrier prend le fichier suivant jusqu'a epuisement de la liste ;
+ * chaque ouvrier garde son contexte d'une image a l'autre */
+static void *ouvrier_lot(void *argument){
+    Lot *lot = argument;
+    OptionsDIF options = lot->options;
+    options.nb_threads = 1;
+    dif_context *contexte = dif_context_creer(&options);
+    for (;;) {
+        pthread_mutex_lock(&lot->verrou);
+        size_t index = lot->prochain++;
+        pthread_mutex_unlock(&lot->verrou);
+        if (index >= lot->liste->nombre)
+            break;
+        long taille_brute = 0, taille_dif = 0;
+        int err = contexte ? traiter_fichier(lot, contexte, index, &taille_brute, &taille_dif)
+                           : DIF_ERR_ALLOC;
+        pthread_mutex_lock(&lot->verrou);
+        lot->erreurs[index] = err;
+        if (err == DIF_OK) {
+            lot->octets_bruts += taille_brute;
+            lot->octets_dif += taille_dif;
+        }
+        pthread_mutex_unlock(&lot->verrou);
+    }
+    dif_context_detruire(contexte);
+    return NULL;
+}
+
+/* ============================================================
+ * Mode lot : encodage/decodage de tous les fichiers, bilan global
+ * ============================================================ */
+static int executer_lot(const char *entree, const char *dossier_sortie,
+                        const OptionsDIF *options, int force_decode, int force_encode,
+                        int facteur, int verbeux, int temps){
+    ListeFichiers liste = {0};
+    struct stat st;
+    int ok = lister_fichiers(&liste, entree);
+    if (!ok || liste.nombre == 0) {
+        fprintf(stderr, "Aucun fichier a traiter : %s\n", entree);
+        liberer_liste(&liste);
+        return 1;
+    }
+    if (stat(dossier_sortie, &st) != 0 && mkdir(dossier_sortie, 0777) != 0) {
+        fprintf(stderr, "Dossier de sortie impossible a creer : %s\n", dossier_sortie);
+        liberer_liste(&liste);
+        return 1;
+    }
+    int nb_ouvriers = options->nb_threads;
+    if (nb_ouvriers <= 0) {
+        long coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+        nb_ouvriers = coeurs > 0 ? (int)coeurs : 1;
+    }
+    if ((size_t)nb_ouvriers > liste.nombre)
+        nb_ouvriers = (int)liste.nombre;
+
+    Lot lot = { &liste, dossier_sortie, force_decode, force_encode, verbeux, facteur, *options,
+                PTHREAD_MUTEX_INITIALIZER, 0, calloc(liste.nombre, sizeof(int)), 0, 0 };
+    pthread_t *ouvriers = malloc((size_t)nb_ouvriers * sizeof *ouvriers);
+    if (!lot.erreurs || !ouvriers) {
+        fprintf(stderr, "Memoire insuffisante\n");
+        free(lot.erreurs);
+        free(ouvriers);
+        liberer_liste(&liste);
+        return 1;
+    }
+    double debut = maintenant();
+    int lances = 0;
+    for (; lances < nb_ouvriers; lances++)
+        if (pthread_create(&ouvriers[lances], NULL, ouvrier_lot, &lot) != 0)
+            break;
+    if (lances == 0)
+        ouvrier_lot(&lot);
+    for (int i = 0; i < lances; i++)
+        pthread_join(ouvriers[i], NULL);
+    double duree = maintenant() - debut;
+
+    size_t echecs = 0;
+    for (size_t i = 0; i < liste.nombre; i++) {
+        if (lot.erreurs[i] != DIF_OK) {
+            if (echecs++ == 0)
+                fprintf(stderr, "Echecs :\n");
+            fprintf(stderr, "  %s (erreur %d)\n", liste.chemins[i], lot.erreurs[i]);
+        }
+    }
+    printf("Fichiers traites : %zu (%zu reussis, %zu echecs) avec %d ouvriers\n",
+           liste.nombre, liste.nombre - echecs, echecs, lances ? lances : 1);
+    printf("Taille brute     : %lld octets\n", lot.octets_bruts);
+    printf("Taille DIF       : %lld octets\n", lot.octets_dif);
+    if (lot.octets_bruts > 0)
+        printf("Compression      : %.2f %%\n", 100.0 * lot.octets_dif / lot.octets_bruts);
+    if (temps)
+        printf("Temps total      : %.3f s\n", duree);
+    if (duree > 0)
+        printf("Debit            : %.1f Mo/s (%.1f fichiers/s)\n",
+               lot.octets_bruts / duree / 1e6, liste.nombre / duree);
+    free(ouvriers);
+    free(lot.erreurs);
+    liberer_liste(&liste);
+    return echecs ? 1 : 0;
+}
+
+/* ============================================================
+ * Sequence : encodage des images listees en une sequence DIF, ou
+ * decodage de toutes ses images (ou de l'image `index` si >= 0)
+ * ============================================================ */
+static int executer_sequence(const char *entree, const char *sortie, const OptionsDIF *options,
+                             int decode, int index, int verbeux, int temps, FILE *messages){
+    dif_context *contexte = dif_context_creer(options);
+    if (!contexte) {
+        fprintf(stderr, "Memoire insuffisante\n");
+        return 1;
+    }
+    double debut = maintenant();
+    if (decode) {
+        if (verbeux)
+            fprintf(messages, "Decodage de la sequence : %s -> %s\n", entree, sortie);
+        int err = index >= 0 ? diftopnm_image_sequence_ctx(contexte, entree, index, sortie)
+                             : diftopnm_sequence_ctx(contexte, entree, sortie);
+        double duree = maintenant() - debut;
+        dif_context_detruire(contexte);
+        if (err != DIF_OK) {
+            fprintf(stderr, "Erreur lors du decodage de la sequence (%d)\n", err);
+            return 1;
+        }
+        if (temps)
+            fprintf(messages, "Temps de decodage : %.3f s\n", duree);
+        return 0;
+    }
+    ListeFichiers liste = {0};
+    if (!lister_fichiers(&liste, entree) || liste.nombre == 0 || liste.nombre > 0x7FFFFFFF) {
+        fprintf(stderr, "Aucune image a encoder : %s\n", entree);
+        liberer_liste(&liste);
+        dif_context_detruire(contexte);
+        return 1;
+    }
+    if (verbeux)
+        fprintf(messages, "Encodage de la sequence : %zu images -> %s\n", liste.nombre, sortie);
+    int err = pnmtodif_sequence_ctx(contexte, (const char *const *)liste.chemins, (int)liste.nombre,
+                                    sortie);
+    double duree = maintenant() - debut;
+    dif_context_detruire(contexte);
+    long long taille_brute = 0;
+    for (size_t i = 0; i < liste.nombre && taille_brute >= 0; i++) {
+        long taille = taille_fichier(liste.chemins[i]);
+        taille_brute = taille > 0 ? taille_brute + taille : -1;
+    }
+    liberer_liste(&liste);
+    if (err != DIF_OK) {
+        fprintf(stderr, "Erreur encodage de la sequence (%d)\n", err);
+        return 1;
+    }
+    long taille_dif = taille_fichier(sortie);
+    if (temps)
+        fprintf(messages, "Temps d'encodage : %.3f s\n", duree);
+    if (taille_brute > 0 && taille_dif > 0) {
+        fprintf(messages, "Taille brute : %lld octets\n", taille_brute);
+        fprintf(messages, "Taille DIF   : %ld octets\n", taille_dif);
+        fprintf(messages, "Compression  : %.2f %%\n", 100.0 * taille_dif / taille_brute);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    // options
+    int opt_verbose = 0;
+    int opt_temps = 0;
+    int opt_raw = 0;
+    int opt_force_decode = 0;
+    int opt_force_encode = 0;
+    int opt_lot = 0;
+    int opt_facteur = 1;
+    int opt_sequence = 0;
+    int opt_image = -1;
+    OptionsDIF options;
+    options_dif_defaut(&options);
+    // fichiers 
+    const char *fichier_entree = NULL;
+    const char *fichier_sortie = NULL;
+
+    /* ========================================================
+     * Lecture des arguments
+     * ======================================================== */
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-h")) {
+            afficher_aide(argv[0]);
+            return 0;
+        }
+        else if (!strcmp(argv[i], "-v")) {
+            opt_verbose = 1;
+        }
+        else if (!strcmp(argv[i], "-t")) {
+            opt_temps = 1;
+        }
+        else if (!strcmp(argv[i], "-d")) {
+            opt_force_decode = 1;
+        }
+        else if (!strcmp(argv[i], "-e")) {
+            opt_force_encode = 1;
+        }
+        else if (!strcmp(argv[i], "-r")) {
+            opt_raw = 1;
+        }
+        else if (!strcmp(argv[i], "-l")) {
+            opt_lot = 1;
+        }
+        else if (!strcmp(argv[i], "-S")) {
+            opt_sequence = 1;
+        }
+        else if (!strcmp(argv[i], "-q")) {
+            options.quantificateur_fixe = 1;
+        }
+        else if (!strcmp(argv[i], "-p")) {
+            options.modes |= DIF_MODE_MED;
+        }
+        else if (!strcmp(argv[i], "-c")) {
+            options.modes |= DIF_MODE_DECORRELATION;
+        }
+        else if (!strcmp(argv[i], "-z")) {
+            options.modes |= DIF_MODE_PLAGES;
+        }
+        else if (!strcmp(argv[i], "-H")) {
+            options.modes |= DIF_MODE_HUFFMAN;
+        }
+        else if (!strcmp(argv[i], "-s")) {
+            options.modes |= DIF_MODE_SANS_PERTE;
+        }
+        else if (!strcmp(argv[i], "-m")) {
+            char *fin;
+            long valeur = (i + 1 < argc) ? strtol(argv[i + 1], &fin, 10) : -1;
+            if ((valeur != 2 && valeur != 4 && valeur != 8) || *fin != '\0') {
+                fprintf(stderr, "Valeur invalide pour -m (2, 4 ou 8)\n");
+                return 1;
+            }
+            opt_facteur = (int)valeur;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-i")) {
+            char *fin;
+            long valeur = (i + 1 < argc) ? strtol(argv[i + 1], &fin, 10) : -1;
+            if (valeur < 0 || valeur > 0x7FFFFFFF || *fin != '\0') {
+                fprintf(stderr, "Valeur invalide pour -i\n");
+                return 1;
+            }
+            opt_image = (int)valeur;
+            opt_sequence = 1;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "-j") || !strcmp(argv[i], "-k")) {
+            char *fin;
+            long valeur = (i + 1 < argc) ? strtol(argv[i + 1], &fin, 10) : -1;
+            if (valeur < 0 || valeur > 65535 || *fin != '\0') {
+                fprintf(stderr, "Valeur invalide pour %s\n", argv[i]);
+                return 1;
+            }
+            if (argv[i][1] == 'b')
+                options.hauteur_bande = (int)valeur;
+            else if (argv[i][1] == 'j')
+                options.nb_threads = (int)valeur;
+            else
+                options.intervalle_cles = (int)valeur;
+            i++;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Option inconnue : %s\n", argv[i]);
+            afficher_aide(argv[0]);
+            return 1;
+        }
+        else {
+            if (!fichier_entree)
+                fichier_entree = argv[i];
+            else if (!fichier_sortie)
+                fichier_sortie = argv[i];
+            else {
+                fprintf(stderr, "Trop d'arguments\n");
+                return 1;
+            }
+        }
+    }
+
+    /* ========================================================
+     * Verifications
+     * ======================================================== */
+    if (!fichier_entree || !fichier_sortie) {
+        fprintf(stderr, "Fichier d'entree ou de sortie manquant\n");
+        afficher_aide(argv[0]);
+        return 1;
+    }
+
+    if (opt_force_decode && opt_force_encode) {
+        fprintf(stderr, "Options -d et -e incompatibles\n");
+        return 1;
+    }
+
+    if (opt_facteur > 1 && opt_raw) {
+        fprintf(stderr, "Options -m et -r incompatibles\n");
+        return 1;
+    }
+
+    if (opt_sequence && (opt_lot || opt_raw || opt_facteur > 1)) {
+        fprintf(stderr, "Option -S incompatible avec -l, -r et -m\n");
+        return 1;
+    }
+
+    // sortie standard : les messages passent sur la sortie d'erreur
+    FILE *messages = stdout;
+    if (!opt_lot && !strcmp(fichier_sortie, "-")) {
+        if (opt_raw) {
+            fprintf(stderr, "Option -r incompatible avec la sortie standard\n");
+            return 1;
+        }
+        messages = stderr;
+    }
+
+    /* ========================================================
+     * MODE LOT
+     * ======================================================== */
+    if (opt_lot)
+        return executer_lot(fichier_entree, fichier_sortie, &options,
+                            opt_force_decode, opt_force_encode, opt_facteur, opt_verbose, opt_temps);
+
+    /* ========================================================
+     * MODE SEQUENCE
+     * ======================================================== */
+    if (opt_sequence) {
+        // sur l'entree standard, une sequence DIF commence par 0xFF (une
+        // liste de fichiers a encoder, par un chemin)
+        int decode = opt_force_decode || opt_image >= 0 ||
+                     (!opt_force_encode && (!strcmp(fichier_entree, "-")
+                                            ? premier_octet_entree() == 0xFF
+                                            : a_extension(fichier_entree, ".dif")));
+        return executer_sequence(fichier_entree, fichier_sortie, &options, decode, opt_image,
+                                 opt_verbose, opt_temps, messages);
+    }
+
+    /* ========================================================
+     * MODE DECODAGE DIF -> PNM
+     * ======================================================== */
+    int entree_standard = !strcmp(fichier_entree, "-");
+    if (opt_force_decode ||
+        (!opt_force_encode && (entree_standard ? premier_octet_entree() == 0xFF
+                                               : a_extension(fichier_entree, ".dif")))) {
+        char nom_raw[512];
+        snprintf(nom_raw, sizeof nom_raw, "%s_raw.pnm", fichier_sortie);
+        if (opt_verbose) {
+            fprintf(messages, "Decodage : %s -> %s\n", fichier_entree, fichier_sortie);
+            if (opt_raw)
+                fprintf(messages, "Image differentielle : %s\n", nom_raw);
+        }
+        // image reconstruite et image differentielle en un seul decodage
+        dif_context *contexte = dif_context_creer(&options);
+        double debut = maintenant();
+        int err = !contexte ? DIF_ERR_ALLOC
+                : opt_facteur > 1 ? diftopnm_vignette_ctx(contexte, fichier_entree, fichier_sortie,
+                                                          opt_facteur)
+                : diftopnm_et_raw_ctx(contexte, fichier_entree, fichier_sortie,
+                                      opt_raw ? nom_raw : NULL);
+        double fin = maintenant();
+        dif_context_detruire(contexte);
+        if (err != DIF_OK) {
+            fprintf(stderr, "Erreur lors du decodage DIF (%d)\n", err);
+            return 1;
+        }
+        if (opt_temps) {
+            double t = fin - debut;
+            fprintf(messages, "Temps de decodage : %.3f s\n", t);
+        }
+        if (opt_verbose)
+            fprintf(messages, "Decodage termine\n");
+    }
+
+    /* ========================================================
+     * MODE ENCODAGE IMAGE -> DIF
+     * ======================================================== */
+    else {
+        if (opt_verbose)
+            fprintf(messages, "Encodage : %s -> %s\n", fichier_entree, fichier_sortie);
+        long taille_in = 0;
+        dif_context *contexte = dif_context_creer(&options);
+        double debut = maintenant();
+        int err = contexte ? encoder_fichier(contexte, fichier_entree, fichier_sortie, 0, &taille_in)
+                           : DIF_ERR_ALLOC;
+        double fin = maintenant();
+        dif_context_detruire(contexte);
+        if (err != DIF_OK) {
+            fprintf(stderr, "Erreur encodage (%d)\n", err);
+            return 1;
+        }
+        long taille_out = taille_fichier(fichier_sortie);
+        if (opt_temps) {
+            double t = fin - debut;
+            fprintf(messages, "Temps d'encodage : %.3f s\n", t);
+            if (t > 0 && taille_in > 0)
+                fprintf(messages, "Debit d'encodage : %.1f Mo/s\n", taille_in / t / 1e6);
+        }
+        if (taille_in > 0 && taille_out > 0) {
+            double ratio = 100.0 * taille_out / taille_in;
+            fprintf(messages, "Taille brute : %ld octets\n", taille_in);
+            fprintf(messages, "Taille DIF   : %ld octets\n", taille_out);
+            fprintf(messages, "Compression  : %.2f %%\n", ratio);
+        }
+    }
+    return 0;
+}